@@ -0,0 +1,677 @@
+/*
+ * Pixel Bench scenario benchmarks
+ *
+ * Runs a set of parameterized scenarios on a headless Game and writes one
+ * JSON object per scenario (JSON lines) with per-phase timing statistics, so
+ * results from different engine versions can be compared.
+ *
+ * usage:
+ *   scenario_bench [--scenario NAME|all] [--entities N] [--frames N]
+ *                  [--casts N] [--churn N] [--depth N] [--seed N]
+ *                  [--out FILE] [--list]
+ *
+ * `texture_load` compares loading a BMP file, converted to the renderer's
+ * pixel format as texture creation would, with loading the same image as a
+ * cooked texture, raw and LZ4 compressed. LZ4 blocks are decompressed on the
+ * calling thread (`cooked_lz4_load`) and on as many threads as
+ * LoadCookedTexture() picks (`cooked_lz4_parallel_load`). Its files are
+ * written next to the executable and removed afterward.
+ */
+#include "pixbench/game.h"
+#include "pixbench/ecs.h"
+#include "pixbench/components.h"
+#include "pixbench/cooked_texture.h"
+#include "pixbench/engine_config.h"
+#include "pixbench/physics/physics.h"
+#include "pixbench/physics/type.h"
+#include "pixbench/utils/results.h"
+#include "pixbench/vector2.h"
+#include <SDL3/SDL_surface.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+#ifndef PIXBENCH_VERSION
+#define PIXBENCH_VERSION "unknown"
+#endif
+
+
+const float ARENA_WIDTH = 2560.0;
+const float ARENA_HEIGHT = 1440.0;
+
+
+class BenchParams {
+public:
+    std::string scenario = "all";
+    size_t entities = 1000;         //!< number of entities in the scene
+    size_t frames = 120;            //!< number of Game::Step() calls per scenario
+    size_t casts = 256;             //!< rayCast and circleCast calls per frame
+    size_t churn = 100;             //!< entities destroyed and spawned per frame
+    size_t depth = 64;              //!< length of each chain in hierarchy_deep
+    unsigned int seed = 1234;
+    std::string out_path;
+};
+
+
+/*
+ * Collects timing samples (in seconds) for each named phase.
+ */
+class ScenarioReport {
+public:
+    std::string scenario;
+    size_t entities = 0;
+    size_t frames = 0;
+    std::vector<std::pair<std::string, std::vector<double>>> phases;
+
+    void addSample(const std::string& phase, double seconds) {
+        for (auto& phase_samples : phases) {
+            if (phase_samples.first == phase) {
+                phase_samples.second.push_back(seconds);
+                return;
+            }
+        }
+        phases.push_back(std::make_pair(phase, std::vector<double>(1, seconds)));
+    }
+
+    void addFrameStats(const FrameStats& stats) {
+        addSample("init", stats.init_s);
+        addSample("update", stats.update_s);
+        addSample("fixed_update", stats.fixed_update_s);
+        addSample("late_update", stats.late_update_s);
+        addSample("pre_draw", stats.pre_draw_s);
+        addSample("frame", stats.frame_s);
+    }
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << "{\"bench\":\"pixbench\""
+            << ",\"version\":\"" << PIXBENCH_VERSION << "\""
+            << ",\"scenario\":\"" << scenario << "\""
+            << ",\"entities\":" << entities
+            << ",\"frames\":" << frames
+            << ",\"unit\":\"us\""
+            << ",\"phases\":[";
+
+        for (size_t i = 0; i < phases.size(); ++i) {
+            std::vector<double> samples = phases[i].second;
+            std::sort(samples.begin(), samples.end());
+
+            double total = 0.0;
+            for (double s : samples)
+                total += s;
+
+            const size_t n = samples.size();
+            if (i > 0)
+                out << ",";
+            out << "{\"name\":\"" << phases[i].first << "\""
+                << ",\"samples\":" << n
+                << ",\"mean\":" << 1e6 * total / n
+                << ",\"min\":" << 1e6 * samples[0]
+                << ",\"p50\":" << 1e6 * samples[n / 2]
+                << ",\"p95\":" << 1e6 * samples[std::min(n - 1, (n * 95) / 100)]
+                << ",\"max\":" << 1e6 * samples[n - 1]
+                << "}";
+        }
+        out << "]}";
+
+        return out.str();
+    }
+};
+
+
+/*
+ * Wall-clock stopwatch for timing the bench's own phases
+ */
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point m_start;
+public:
+    Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+    double elapsed() const {
+        return std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - m_start
+                ).count();
+    }
+};
+
+
+/*
+ * Moves its entity around and bounces it off the arena border
+ */
+class BenchMoverScript : public ScriptComponent {
+public:
+    Vector2 velocity = Vector2(40.0, 25.0);
+
+    Void FixedUpdate(double deltaTime_s, EntityManager* entityManager, EntityID self) override {
+        Transform* transform = entityManager->getEntityComponent<Transform>(self);
+        if ( !transform )
+            return ResultOK;
+
+        Vector2 position = transform->GlobalPosition() + velocity * deltaTime_s;
+        if (position.x < 0.0 || position.x > ARENA_WIDTH)
+            velocity.x = -velocity.x;
+        if (position.y < 0.0 || position.y > ARENA_HEIGHT)
+            velocity.y = -velocity.y;
+        transform->SetPosition(position);
+
+        return ResultOK;
+    }
+};
+
+
+Game* createHeadlessGame() {
+    Game* game = new Game();
+
+    GameConfig config = GameConfig();
+    config.game_title = "Pixel Bench - Benchmark";
+    config.headless = true;
+    config.window_width = 1280;
+    config.window_height = 720;
+    game->ApplyGameConfig(config);
+
+    Result<VoidResult, GameError> res = game->Initialize();
+    if ( res.isError() ) {
+        std::cerr << "Can't Initialize Game: "
+            << res.getErrResult()->err_message
+            << std::endl;
+        delete game;
+        return nullptr;
+    }
+
+    return game;
+}
+
+
+void destroyHeadlessGame(Game* game) {
+    game->OnExit();
+    delete game;
+}
+
+
+Vector2 randomPosition(std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist_x(0.0, ARENA_WIDTH);
+    std::uniform_real_distribution<float> dist_y(0.0, ARENA_HEIGHT);
+    return Vector2(dist_x(rng), dist_y(rng));
+}
+
+
+EntityID spawnSprite(EntityManager* ent_mgr, std::mt19937& rng) {
+    std::uniform_real_distribution<float> dist_depth(0.0, 100.0);
+
+    EntityID ent = ent_mgr->createEntity();
+    Transform* transform = ent_mgr->addComponentToEntity<Transform>(ent);
+    transform->SetPosition(randomPosition(rng));
+
+    Sprite* sprite = ent_mgr->addComponentToEntity<Sprite>(ent);
+    sprite->paused = true;
+    sprite->depth = dist_depth(rng);
+    sprite->setTargetSize(16.0, 16.0);
+
+    return ent;
+}
+
+
+EntityID spawnCollider(EntityManager* ent_mgr, std::mt19937& rng, size_t index, bool is_moving) {
+    EntityID ent = ent_mgr->createEntity();
+    Transform* transform = ent_mgr->addComponentToEntity<Transform>(ent);
+    transform->SetPosition(randomPosition(rng));
+
+    Collider* collider = nullptr;
+    switch (index % 4) {
+        case 0:
+            {
+            BoxCollider* box = ent_mgr->addComponentToEntity<BoxCollider>(ent);
+            box->setSize(16.0, 12.0);
+            collider = box;
+            break;
+            }
+        case 1:
+            {
+            CircleCollider* circle = ent_mgr->addComponentToEntity<CircleCollider>(ent);
+            circle->setRadius(8.0);
+            collider = circle;
+            break;
+            }
+        case 2:
+            {
+            CapsuleCollider* capsule = ent_mgr->addComponentToEntity<CapsuleCollider>(ent);
+            capsule->setSize(6.0, 12.0);
+            collider = capsule;
+            break;
+            }
+        default:
+            {
+            PolygonCollider* polygon_coll = ent_mgr->addComponentToEntity<PolygonCollider>(ent);
+            // hexagon, counter-clockwise in screen space (y pointing down)
+            Vector2 verts[6];
+            for (int i = 0; i < 6; ++i) {
+                verts[i] = Vector2(10.0*std::cos(-i*M_PI/3.0), 10.0*std::sin(-i*M_PI/3.0));
+            }
+            Polygon polygon;
+            polygon.setVertex(verts, 6);
+            polygon_coll->setPolygon(polygon);
+            collider = polygon_coll;
+            break;
+            }
+    }
+    collider->is_static = !is_moving;
+
+    if (is_moving) {
+        std::uniform_real_distribution<float> dist_speed(-60.0, 60.0);
+        BenchMoverScript* mover = ent_mgr->addComponentToEntity<BenchMoverScript>(ent);
+        mover->velocity = Vector2(dist_speed(rng), dist_speed(rng));
+    }
+
+    return ent;
+}
+
+
+Result<VoidResult, GameError> stepFrames(Game* game, const BenchParams& params, ScenarioReport* report) {
+    for (size_t f = 0; f < params.frames; ++f) {
+        auto res = game->Step(1.0/60.0);
+        if ( !res.isOk() )
+            return res;
+        report->addFrameStats(game->frameStats);
+    }
+    return ResultOK;
+}
+
+
+// ========================= Scenarios =========================
+
+
+Void scenarioSprites(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    for (size_t i = 0; i < params.entities; ++i)
+        spawnSprite(game->entityManager, rng);
+
+    return stepFrames(game, params, report);
+}
+
+
+Void scenarioColliders(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    for (size_t i = 0; i < params.entities; ++i)
+        spawnCollider(game->entityManager, rng, i, i % 2 == 0);
+
+    return stepFrames(game, params, report);
+}
+
+
+Void scenarioHierarchyDeep(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    EntityManager* ent_mgr = game->entityManager;
+    const size_t depth = std::max((size_t)1, params.depth);
+
+    EntityID parent;
+    for (size_t i = 0; i < params.entities; ++i) {
+        EntityID ent = ent_mgr->createEntity();
+        Transform* transform = ent_mgr->addComponentToEntity<Transform>(ent);
+        transform->SetPosition(randomPosition(rng));
+        transform->setLocalRotation(0.01);
+
+        if (i % depth != 0)
+            game->entityHierarchy.addChildToEntity(parent, ent);
+        parent = ent;
+    }
+
+    return stepFrames(game, params, report);
+}
+
+
+Void scenarioHierarchyWide(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    EntityManager* ent_mgr = game->entityManager;
+
+    EntityID root = ent_mgr->createEntity();
+    ent_mgr->addComponentToEntity<Transform>(root)->SetPosition(Vector2(100.0, 100.0));
+    for (size_t i = 1; i < params.entities; ++i) {
+        EntityID ent = ent_mgr->createEntity();
+        ent_mgr->addComponentToEntity<Transform>(ent)->SetPosition(randomPosition(rng));
+        game->entityHierarchy.addChildToEntity(root, ent);
+    }
+
+    return stepFrames(game, params, report);
+}
+
+
+Void scenarioTagChurn(Game* game, const BenchParams& params, ScenarioReport* report) {
+    EntityManager* ent_mgr = game->entityManager;
+    const size_t num_tags = 8;
+
+    std::vector<EntityID> entities;
+    std::vector<std::string> tags;
+    for (size_t i = 0; i < params.entities; ++i)
+        entities.push_back(ent_mgr->createEntity());
+    for (size_t t = 0; t < num_tags; ++t)
+        tags.push_back("bench_tag_" + std::to_string(t));
+
+    for (size_t f = 0; f < params.frames; ++f) {
+        Stopwatch add_watch;
+        for (size_t i = 0; i < entities.size(); ++i)
+            ent_mgr->tag.addTagToEntity(entities[i], tags[(i + f) % num_tags]);
+        report->addSample("tag_add", add_watch.elapsed());
+
+        Stopwatch query_watch;
+        size_t found = 0;
+        for (size_t t = 0; t < num_tags; ++t)
+            found += ent_mgr->tag.getEntitiesWithTag(tags[t]).size();
+        report->addSample("tag_query", query_watch.elapsed());
+
+        Stopwatch remove_watch;
+        for (size_t i = 0; i < entities.size(); ++i)
+            ent_mgr->tag.removeTagFromEntity(entities[i], tags[(i + f) % num_tags]);
+        report->addSample("tag_remove", remove_watch.elapsed());
+
+        if (found != entities.size())
+            return ResultError("tag_churn: tag query returned wrong entity count");
+
+        auto res = game->Step(1.0/60.0);
+        if ( !res.isOk() )
+            return res;
+        report->addFrameStats(game->frameStats);
+    }
+
+    return ResultOK;
+}
+
+
+Void scenarioSpawnChurn(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    EntityManager* ent_mgr = game->entityManager;
+    const size_t churn = std::min(params.churn, params.entities);
+
+    std::vector<EntityID> entities;
+    for (size_t i = 0; i < params.entities; ++i)
+        entities.push_back(spawnSprite(ent_mgr, rng));
+
+    for (size_t f = 0; f < params.frames; ++f) {
+        std::shuffle(entities.begin(), entities.end(), rng);
+
+        Stopwatch destroy_watch;
+        for (size_t i = 0; i < churn; ++i)
+            ent_mgr->destroyEntity(entities[entities.size() - 1 - i]);
+        report->addSample("destroy", destroy_watch.elapsed());
+        entities.resize(entities.size() - churn);
+
+        Stopwatch spawn_watch;
+        for (size_t i = 0; i < churn; ++i)
+            entities.push_back(spawnSprite(ent_mgr, rng));
+        report->addSample("spawn", spawn_watch.elapsed());
+
+        auto res = game->Step(1.0/60.0);
+        if ( !res.isOk() )
+            return res;
+        report->addFrameStats(game->frameStats);
+    }
+
+    return ResultOK;
+}
+
+
+Void scenarioCastStorm(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<float> dist_angle(0.0, 2.0*M_PI);
+    for (size_t i = 0; i < params.entities; ++i)
+        spawnCollider(game->entityManager, rng, i, false);
+
+    // first step to sync collider transforms
+    auto res = game->Step(1.0/60.0);
+    if ( !res.isOk() )
+        return res;
+
+    for (size_t f = 0; f < params.frames; ++f) {
+        RaycastHit hit;
+        size_t hits = 0;
+
+        Stopwatch ray_watch;
+        for (size_t c = 0; c < params.casts; ++c) {
+            const float angle = dist_angle(rng);
+            if (game->physics.rayCast(randomPosition(rng), Vector2(std::cos(angle), std::sin(angle)), 512.0, &hit))
+                ++hits;
+        }
+        report->addSample("raycast", ray_watch.elapsed());
+
+        Stopwatch circle_watch;
+        for (size_t c = 0; c < params.casts; ++c) {
+            const float angle = dist_angle(rng);
+            if (game->physics.circleCast(randomPosition(rng), Vector2(std::cos(angle), std::sin(angle)), 512.0, 8.0, &hit))
+                ++hits;
+        }
+        report->addSample("circlecast", circle_watch.elapsed());
+
+        res = game->Step(1.0/60.0);
+        if ( !res.isOk() )
+            return res;
+        report->addFrameStats(game->frameStats);
+    }
+
+    return ResultOK;
+}
+
+
+/*
+ * Pixel art like sheet: 16x16 sprites of a few flat colors from a shared
+ * palette on a transparent background
+ */
+SDL_Surface* createBenchSheet(std::mt19937& rng, int size) {
+    SDL_Surface* sheet = SDL_CreateSurface(size, size, SDL_PIXELFORMAT_ARGB8888);
+    if ( !sheet )
+        return nullptr;
+
+    std::uniform_int_distribution<uint32_t> dist_color(0, 0xffffff);
+    std::vector<uint32_t> sheet_palette(32);
+    for (auto& color : sheet_palette)
+        color = 0xff000000 | dist_color(rng);
+
+    std::uniform_int_distribution<size_t> dist_palette(0, sheet_palette.size() - 1);
+    std::uniform_int_distribution<int> dist_shape(2, 7);
+    for (int tile_y = 0; tile_y < size; tile_y += 16) {
+        for (int tile_x = 0; tile_x < size; tile_x += 16) {
+            const uint32_t palette[3] = {
+                sheet_palette[dist_palette(rng)], sheet_palette[dist_palette(rng)], sheet_palette[dist_palette(rng)]
+            };
+            const int radius = dist_shape(rng);
+            for (int y = 0; y < 16 && tile_y + y < size; ++y) {
+                uint32_t* row = (uint32_t*)((uint8_t*)sheet->pixels + (size_t)(tile_y + y) * sheet->pitch);
+                for (int x = 0; x < 16 && tile_x + x < size; ++x) {
+                    const int dx = x - 8, dy = y - 8;
+                    const int distance = std::abs(dx) + std::abs(dy);
+                    row[tile_x + x] = distance > radius + 3 ? 0 : palette[std::min(distance / (radius / 2 + 1), 2)];
+                }
+            }
+        }
+    }
+    return sheet;
+}
+
+
+Void scenarioTextureLoad(Game* game, const BenchParams& params, ScenarioReport* report) {
+    std::mt19937 rng(params.seed);
+    const std::string bmp_path = game->GetBasePath() + "bench_texture.bmp";
+    const std::string raw_path = game->GetBasePath() + "bench_texture_raw" COOKED_TEXTURE_EXTENSION;
+    const std::string lz4_path = game->GetBasePath() + "bench_texture_lz4" COOKED_TEXTURE_EXTENSION;
+
+    SDL_Surface* sheet = createBenchSheet(rng, 1024);
+    if ( !sheet )
+        return ResultError(std::string("Can't create the bench texture: ") + SDL_GetError());
+
+    // BMP files are usually saved without alpha, 24 bits per pixel
+    SDL_Surface* sheet_24 = SDL_ConvertSurface(sheet, SDL_PIXELFORMAT_BGR24);
+    const bool is_bmp_saved = sheet_24 && SDL_SaveBMP(sheet_24, bmp_path.c_str());
+    if (sheet_24)
+        SDL_DestroySurface(sheet_24);
+    auto res = CookTexture(sheet, std::vector<SDL_FRect>(), raw_path, CookedTextureCompression::NONE);
+    if (res.isOk())
+        res = CookTexture(sheet, std::vector<SDL_FRect>(), lz4_path, CookedTextureCompression::LZ4);
+    SDL_DestroySurface(sheet);
+    if ( !is_bmp_saved )
+        res = ResultError(std::string("Can't save the bench texture: ") + SDL_GetError());
+
+    for (size_t f = 0; res.isOk() && f < params.frames; ++f) {
+        Stopwatch bmp_watch;
+        SDL_Surface* surface = SDL_LoadBMP(bmp_path.c_str());
+        SDL_Surface* converted = surface ? SDL_ConvertSurface(surface, SDL_PIXELFORMAT_ARGB8888) : nullptr;
+        report->addSample("bmp_load", bmp_watch.elapsed());
+        if (surface)
+            SDL_DestroySurface(surface);
+        if ( !converted ) {
+            res = ResultError(std::string("Can't load the bench BMP: ") + SDL_GetError());
+            break;
+        }
+        SDL_DestroySurface(converted);
+
+        CookedTexture cooked;
+        Stopwatch raw_watch;
+        res = LoadCookedTexture(SDL_IOFromFile(raw_path.c_str(), "rb"), true, &cooked);
+        report->addSample("cooked_load", raw_watch.elapsed());
+        if ( !res.isOk() )
+            break;
+        SDL_DestroySurface(cooked.surface);
+
+        Stopwatch lz4_watch;
+        res = LoadCookedTexture(SDL_IOFromFile(lz4_path.c_str(), "rb"), true, &cooked, 1);
+        report->addSample("cooked_lz4_load", lz4_watch.elapsed());
+        if ( !res.isOk() )
+            break;
+        SDL_DestroySurface(cooked.surface);
+
+        Stopwatch lz4_parallel_watch;
+        res = LoadCookedTexture(SDL_IOFromFile(lz4_path.c_str(), "rb"), true, &cooked);
+        report->addSample("cooked_lz4_parallel_load", lz4_parallel_watch.elapsed());
+        if ( !res.isOk() )
+            break;
+        SDL_DestroySurface(cooked.surface);
+    }
+
+    std::remove(bmp_path.c_str());
+    std::remove(raw_path.c_str());
+    std::remove(lz4_path.c_str());
+    return res;
+}
+
+
+typedef Void (*ScenarioFunction)(Game*, const BenchParams&, ScenarioReport*);
+
+struct Scenario {
+    const char* name;
+    ScenarioFunction function;
+};
+
+const Scenario SCENARIOS[] = {
+    { "sprites",            scenarioSprites },
+    { "colliders",          scenarioColliders },
+    { "hierarchy_deep",     scenarioHierarchyDeep },
+    { "hierarchy_wide",     scenarioHierarchyWide },
+    { "tag_churn",          scenarioTagChurn },
+    { "spawn_churn",        scenarioSpawnChurn },
+    { "cast_storm",         scenarioCastStorm },
+    { "texture_load",       scenarioTextureLoad },
+};
+
+
+// ========================= Main =========================
+
+
+bool parseArgs(int argc, char* argv[], BenchParams* params, bool* list_only) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--list") {
+            *list_only = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for argument " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--scenario")        params->scenario = value;
+        else if (arg == "--entities")   params->entities = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--frames")     params->frames = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--casts")      params->casts = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--churn")      params->churn = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--depth")      params->depth = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--seed")       params->seed = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--out")        params->out_path = value;
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return false;
+        }
+    }
+
+    // leave room for the scenarios' extra entities
+    params->entities = std::min(params->entities, MAX_ENTITIES - 1);
+    params->frames = std::max((size_t)1, params->frames);
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    BenchParams params;
+    bool list_only = false;
+    if ( !parseArgs(argc, argv, &params, &list_only) )
+        return 2;
+
+    if (list_only) {
+        for (const Scenario& scenario : SCENARIOS)
+            std::cout << scenario.name << std::endl;
+        return 0;
+    }
+
+    std::ofstream out_file;
+    if ( !params.out_path.empty() ) {
+        out_file.open(params.out_path.c_str());
+        if ( !out_file ) {
+            std::cerr << "Can't open output file " << params.out_path << std::endl;
+            return 2;
+        }
+    }
+    std::ostream& out = params.out_path.empty() ? std::cout : out_file;
+
+    int ran = 0;
+    for (const Scenario& scenario : SCENARIOS) {
+        if (params.scenario != "all" && params.scenario != scenario.name)
+            continue;
+
+        Game* game = createHeadlessGame();
+        if ( !game )
+            return 1;
+
+        ScenarioReport report;
+        report.scenario = scenario.name;
+        report.entities = params.entities;
+        report.frames = params.frames;
+
+        Result<VoidResult, GameError> res = scenario.function(game, params, &report);
+        destroyHeadlessGame(game);
+        if ( !res.isOk() ) {
+            std::cerr << "Scenario " << scenario.name << " failed: "
+                << res.getErrResult()->err_message << std::endl;
+            return 1;
+        }
+
+        out << report.toJson() << std::endl;
+        ++ran;
+    }
+
+    if (ran == 0) {
+        std::cerr << "Unknown scenario " << params.scenario << ", use --list" << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+#ifndef ASSET_CACHE_HEADER
+#define ASSET_CACHE_HEADER
+
+
+#include "pixbench/asset_pack.h"
+#include "pixbench/audio.h"
+#include "pixbench/resource.h"
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_surface.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class AssetLoader;
+
+
+struct AssetCacheStats {
+    size_t texture_requests = 0;    //!< AssetCache::loadTexture() calls
+    size_t texture_hits = 0;        //!< requests served by an already loaded texture
+    size_t texture_loads = 0;       //!< files actually read
+    size_t live_textures = 0;       //!< unique textures still referenced
+    size_t texture_bytes = 0;       //!< estimate of live textures memory, 4 bytes per pixel
+
+    size_t texture_budget_bytes = 0;    //!< see AssetCache::setTextureBudget(), 0 for none
+    size_t resident_textures = 0;       //!< live textures with their pixels on the GPU
+    size_t resident_texture_bytes = 0;  //!< estimate of their memory, 4 bytes per pixel
+    size_t evicted_textures = 0;        //!< live textures currently freed to stay within the budget
+    size_t texture_evictions = 0;       //!< textures freed to stay within the budget
+    size_t texture_reloads = 0;         //!< evicted textures loaded again to be drawn
+
+    size_t audio_requests = 0;
+    size_t audio_hits = 0;
+    size_t audio_loads = 0;
+    size_t live_audio_clips = 0;
+    size_t audio_bytes = 0;         //!< decoded samples of live clips
+};
+
+
+/**
+ * Residency of a texture shared by AssetCache, see
+ * AssetCache::getTextureResidency().
+ */
+struct TextureResidency {
+    uint32_t id = 0;                //!< Res_SDL_Texture::id
+    std::string path;
+    size_t bytes = 0;               //!< estimate of its memory, 4 bytes per pixel
+    bool is_resident = false;       //!< pixels on the GPU, `false` once evicted or in headless mode
+    uint64_t frames_unused = 0;     //!< frames since it was last drawn, or loaded
+};
+
+
+/**
+ * Loads each texture and audio clip once, and hands out the same
+ * std::shared_ptr to every caller asking for it again.
+ *
+ * Assets are keyed by their normalized path and load parameters, so
+ * "assets/./player.bmp" and "assets/player.bmp" are the same texture, but
+ * the same file loaded with another scale mode or renderer is a different
+ * one. The cache only holds weak references: an asset is freed as usual once
+ * the last shared_ptr to it is released, and loaded again on the next
+ * request.
+ *
+ * With an AssetPack mounted, files under its root directory are read from
+ * the pack, other paths and files missing from it are still read from disk.
+ *
+ * With a texture budget set, textures that are still referenced but weren't
+ * drawn for a while are freed from the GPU, least recently drawn first,
+ * whenever the textures on the GPU outgrow the budget. They keep their size
+ * and frames, and are loaded again from their file when next drawn, in the
+ * background if a texture reloader is set (Game sets Game::assetLoader).
+ *
+ * Usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * auto texture = game->assets.loadTexture(
+ *         base_path + "assets/player.bmp",
+ *         game->renderContext->renderer
+ *         );
+ * auto clip_res = game->assets.loadAudioClip(base_path + "assets/jump.wav");
+ * ~~~~~~~~~~~~~~~~~~~~
+ */
+class AssetCache {
+private:
+    std::unordered_map<std::string, std::weak_ptr<Res_SDL_Texture>> m_textures;
+    std::unordered_map<std::string, std::weak_ptr<AudioClip>> m_audio_clips;
+    size_t m_textures_prune_size = 0;       //!< prune expired textures when the map grows past it
+    size_t m_audio_clips_prune_size = 0;
+    AssetCacheStats m_stats;
+    mutable std::mutex m_mutex;
+
+    size_t m_texture_budget_bytes = 0;
+    uint64_t m_texture_evict_after_frames = 1;
+    uint64_t m_frame = 0;                   //!< AssetCache::updateTextureResidency() calls
+    size_t m_resident_bytes_estimate = 0;   //!< misses textures freed by their owners, so only ever too high
+    uint64_t m_next_eviction_frame = 0;     //!< no texture can be evicted before it
+    AssetLoader* m_texture_reloader = nullptr;
+
+    AssetPack m_pack;
+    std::string m_pack_root;                //!< normalized, with a trailing '/'
+
+    void __pruneExpired();
+public:
+    AssetCache() = default;
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    /**
+     * Lexically normalize `path`: '\\' become '/', repeated separators and
+     * "." segments are removed and "dir/.." segments are collapsed.
+     */
+    static std::string normalizePath(const std::string& path);
+
+    /**
+     * Read the files under `root_dir` from the asset pack at `pack_path`, e.g.
+     * the executable base path for a pack of its "assets/" directory. Must
+     * be done once, before loading assets.
+     */
+    Result<VoidResult, GameError> mountPack(const std::string& pack_path, const std::string& root_dir);
+
+    bool isPackMounted() const { return m_pack.isOpen(); };
+
+    /**
+     * Stream over the packed file at `path`, read in place from the mounted
+     * pack, or null if it isn't packed.
+     */
+    SDL_IOStream* openPackedFile(const std::string& path) const;
+
+    /**
+     * Load the BMP file or cooked texture at `path`, from the mounted pack if
+     * it has it, with the cooked sprite sheet frames in `out__frames`.
+     * Returns null and sets `out__error` if it can't.
+     */
+    SDL_Surface* loadSurface(
+            const std::string& path,
+            std::vector<SDL_FRect>* out__frames = nullptr,
+            std::string* out__error = nullptr
+            ) const;
+
+    /**
+     * Mix_LoadWAV() the file at `path`, from the mounted pack if it has it.
+     */
+    Mix_Chunk* loadChunk(const std::string& path) const;
+
+    /**
+     * Key of a texture loaded from `path` with `renderer` and `scale_mode`.
+     */
+    static std::string textureKey(const std::string& path, SDL_Renderer* renderer, SDL_ScaleMode scale_mode);
+
+    /**
+     * The cached texture, or null if it isn't loaded. Counted as a request.
+     */
+    std::shared_ptr<Res_SDL_Texture> findTexture(
+            const std::string& path,
+            SDL_Renderer* renderer,
+            SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST
+            );
+
+    /**
+     * Share `texture`, loaded by the caller, with later requests. If another
+     * one was stored since AssetCache::findTexture(), that one is returned.
+     */
+    std::shared_ptr<Res_SDL_Texture> storeTexture(
+            const std::string& path,
+            SDL_Renderer* renderer,
+            SDL_ScaleMode scale_mode,
+            std::shared_ptr<Res_SDL_Texture> texture
+            );
+
+    /**
+     * Same as LoadSDLTexture(), but returns the already loaded texture for
+     * the same file, `renderer` and `scale_mode` if one is still alive.
+     * Failed loads are not cached.
+     */
+    std::shared_ptr<Res_SDL_Texture> loadTexture(
+            const std::string& path,
+            SDL_Renderer* renderer,
+            SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST
+            );
+
+    std::shared_ptr<AudioClip> findAudioClip(const std::string& path);
+    std::shared_ptr<AudioClip> storeAudioClip(const std::string& path, std::shared_ptr<AudioClip> clip);
+
+    /**
+     * Same as LoadAudioClip(), but returns the already loaded clip for the
+     * same file if one is still alive.
+     */
+    Result<std::shared_ptr<AudioClip>, std::string> loadAudioClip(const std::string& path);
+
+    /**
+     * Free the textures that weren't drawn for `evict_after_frames` frames
+     * (at least 1), least recently drawn first, while the textures on the
+     * GPU take more than `budget_bytes`. 0 for no budget, the default.
+     *
+     * Only draws recorded in a RenderSnapshot count as uses. Textures drawn
+     * directly with SDL, e.g. by CustomRenderable::Draw(), must be passed to
+     * AssetCache::useTexture() first.
+     */
+    void setTextureBudget(size_t budget_bytes, uint64_t evict_after_frames);
+
+    /**
+     * Load evicted textures again on the workers of `loader`, created with
+     * this cache, instead of when they are drawn. Null, the default, to load
+     * them on the spot.
+     */
+    void setTextureReloader(AssetLoader* loader);
+
+    /**
+     * Mark `texture` as drawn this frame, and load it again if it was
+     * evicted. With a texture reloader, `texture` stays empty until the
+     * reload is finished by AssetLoader::update(), draws skip it meanwhile.
+     * Main thread only.
+     */
+    void useTexture(Res_SDL_Texture* texture);
+
+    /**
+     * Create evicted `texture` again from `surface`, the pixels of its file,
+     * or give up on it if `surface` is null. Called by AssetLoader once a
+     * reload is done, main thread only.
+     */
+    void __finishTextureReload(Res_SDL_Texture* texture, SDL_Surface* surface, const std::string& error);
+
+    /**
+     * End the frame, evicting textures if over the budget. Called once per
+     * frame by Game after the frame is submitted. Main thread only.
+     */
+    void updateTextureResidency();
+
+    /**
+     * Request counters and the assets currently alive.
+     */
+    AssetCacheStats getStats();
+
+    /**
+     * Every live texture shared by the cache, least recently drawn first.
+     */
+    std::vector<TextureResidency> getTextureResidency();
+
+    /**
+     * Forget every cached asset, assets in use stay alive but won't be
+     * shared with later requests.
+     */
+    void clear();
+};
+
+
+#endif
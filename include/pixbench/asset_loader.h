@@ -0,0 +1,236 @@
+#ifndef ASSET_LOADER_HEADER
+#define ASSET_LOADER_HEADER
+
+
+#include "pixbench/asset_cache.h"
+#include "pixbench/audio.h"
+#include "pixbench/resource.h"
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_surface.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+class AssetLoader;
+
+
+enum class AssetLoadState {
+    PENDING,
+    LOADED,
+    FAILED,
+};
+
+
+/**
+ * Asset requested from an AssetLoader. Its state only changes during
+ * AssetLoader::update(), on the main thread.
+ */
+template <typename T>
+class AssetRequest {
+private:
+    friend class AssetLoader;
+
+    std::string m_path;
+    AssetLoadState m_state = AssetLoadState::PENDING;
+    std::shared_ptr<T> m_asset;
+    std::string m_error;
+    size_t m_request_count = 1;         //!< requests sharing this one
+    std::vector<std::function<void(const std::shared_ptr<AssetRequest<T>>&)>> m_callbacks;
+public:
+    AssetRequest(const std::string& path) : m_path(path) { };
+
+    const std::string& getPath() const { return m_path; };
+    AssetLoadState getState() const { return m_state; };
+    bool isDone() const { return m_state != AssetLoadState::PENDING; };
+
+    /**
+     * The loaded asset, null until the request is AssetLoadState::LOADED.
+     */
+    std::shared_ptr<T> get() const { return m_asset; };
+
+    const std::string& getError() const { return m_error; };
+};
+
+
+typedef std::shared_ptr<AssetRequest<Res_SDL_Texture>> TextureLoadHandle;
+typedef std::shared_ptr<AssetRequest<AudioClip>> AudioClipLoadHandle;
+typedef std::function<void(const TextureLoadHandle&)> TextureLoadCallback;
+typedef std::function<void(const AudioClipLoadHandle&)> AudioClipLoadCallback;
+
+
+/**
+ * Requests of the current loading batch, a batch starts with the first
+ * request made while nothing is pending.
+ */
+struct AssetLoadProgress {
+    size_t requested = 0;
+    size_t loaded = 0;
+    size_t failed = 0;
+
+    size_t getPending() const { return requested - loaded - failed; };
+
+    /**
+     * From 0.0 to 1.0, 1.0 when nothing was requested.
+     */
+    float getFraction() const {
+        return requested == 0 ? 1.0f : (float)(loaded + failed) / (float)requested;
+    };
+};
+
+
+/**
+ * Loads textures and audio clips without blocking the game.
+ *
+ * BMP files and cooked textures (see CookTexture()) are read and decoded on
+ * the loader's worker threads, highest priority first. What needs the
+ * renderer, creating the texture, is done by AssetLoader::update() on the
+ * main thread, which Game calls once per frame with
+ * GameConfig::asset_upload_budget_ms. Requests already in the AssetCache are
+ * done right away, and requesting a file that is still loading returns the
+ * same handle. Usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * TextureLoadHandle handle = game->assetLoader->loadTexture(
+ *         base_path + "assets/level_2.bmp",
+ *         SDL_ScaleMode::SDL_SCALEMODE_NEAREST,
+ *         10,
+ *         [sprite] (const TextureLoadHandle& handle) {
+ *             if (handle->getState() == AssetLoadState::LOADED)
+ *                 sprite->SetTexture(handle->get());
+ *         });
+ *
+ * float progress = game->assetLoader->getProgress().getFraction();
+ * ~~~~~~~~~~~~~~~~~~~~
+ */
+class AssetLoader {
+private:
+    enum class AssetKind {
+        TEXTURE,
+        AUDIO_CLIP,
+        TEXTURE_RELOAD,     //!< evicted AssetCache texture, not counted as a request
+    };
+
+    struct LoadJob {
+        int priority = 0;
+        uint64_t sequence = 0;              //!< request order, first requested first among equal priorities
+        AssetKind kind = AssetKind::TEXTURE;
+        std::string key;                    //!< of the pending request, see AssetCache
+        std::string path;
+        SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST;
+        TextureLoadHandle texture_request;
+        AudioClipLoadHandle audio_clip_request;
+        std::weak_ptr<Res_SDL_Texture> reload_texture;
+
+        // loaded on a worker
+        SDL_Surface* surface = nullptr;
+        std::vector<SDL_FRect> frames;
+        Mix_Chunk* chunk = nullptr;
+        std::string error;
+    };
+
+    /**
+     * Heap order of LoadJob, the top is the highest priority, oldest job.
+     */
+    static bool __isLowerPriority(const LoadJob& a, const LoadJob& b) {
+        if (a.priority != b.priority)
+            return a.priority < b.priority;
+        return a.sequence > b.sequence;
+    };
+
+    AssetCache* m_cache;
+    AssetCache m_loose_files;               //!< reads loose files when there is no `m_cache`
+    SDL_Renderer* m_renderer;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_loaded_cv;
+    bool m_stop_requested = false;
+
+    std::vector<LoadJob> m_load_queue;      //!< heaps, see AssetLoader::__isLowerPriority()
+    std::vector<LoadJob> m_upload_queue;
+    std::unordered_map<std::string, TextureLoadHandle> m_pending_textures;
+    std::unordered_map<std::string, AudioClipLoadHandle> m_pending_audio_clips;
+    uint64_t m_next_sequence = 0;
+    size_t m_pending_count = 0;
+    AssetLoadProgress m_progress;
+
+    void run();
+
+    /**
+     * Read and decode the file of `job`, on a worker, from the cache's
+     * AssetPack if it has it. See AssetCache::loadSurface().
+     */
+    void __load(LoadJob* job) const;
+
+    /**
+     * Create the asset of `job` and complete its request, on the main thread.
+     */
+    void __finish(LoadJob* job);
+
+    void __push(LoadJob job);
+    void __countRequest();
+    void __countDone(size_t request_count, bool is_loaded);
+    static void __releaseJob(LoadJob* job);
+public:
+    /**
+     * `cache`, which may be null, gets the loaded assets and is checked
+     * before loading. `renderer` is null in headless mode. At least one
+     * worker is started.
+     */
+    AssetLoader(AssetCache* cache, SDL_Renderer* renderer, size_t worker_count = 1);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    /**
+     * Start loading the BMP file or cooked texture at `path`, higher
+     * `priority` first.
+     * `on_done` is called on the main thread when the request is done,
+     * loaded or failed, right away if it is already cached.
+     */
+    TextureLoadHandle loadTexture(
+            const std::string& path,
+            SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST,
+            int priority = 0,
+            TextureLoadCallback on_done = nullptr
+            );
+
+    /**
+     * Same as AssetLoader::loadTexture(), for Mix_LoadWAV() clips.
+     */
+    AudioClipLoadHandle loadAudioClip(
+            const std::string& path,
+            int priority = 0,
+            AudioClipLoadCallback on_done = nullptr
+            );
+
+    /**
+     * Load evicted `texture` again, ahead of every request, see
+     * AssetCache::setTextureReloader(). Called by AssetCache::useTexture().
+     */
+    void __reloadTexture(const std::shared_ptr<Res_SDL_Texture>& texture);
+
+    /**
+     * Finish loaded requests on the calling (main) thread until
+     * `budget_s` seconds are spent. At least one is finished per call.
+     */
+    void update(double budget_s);
+
+    /**
+     * Block until every request is done, e.g. behind a loading screen.
+     */
+    void finishAll();
+
+    AssetLoadProgress getProgress();
+};
+
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef ASSET_PACK_HEADER
+#define ASSET_PACK_HEADER
+
+
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_iostream.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+#define ASSET_PACK_MAGIC "PXPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 64     //!< of the entries data, in bytes
+
+
+/*
+ * Asset pack file layout (host byte order, built for the machine it runs
+ * on, like replay files):
+ *
+ *     header:  char magic[4], uint32 version, uint32 entry_count,
+ *              uint32 slot_count, uint64 entries_offset, uint64 slots_offset,
+ *              uint64 names_offset
+ *     entries: entry_count AssetPackEntry
+ *     slots:   slot_count uint32, index + 1 of the entry whose name hash
+ *              starts probing there (linearly), 0 for an empty slot
+ *     names:   entry names, not null terminated
+ *     data:    entry contents, each starting at a multiple of
+ *              ASSET_PACK_ALIGNMENT
+ *
+ * Entry names are AssetCache::normalizePath() paths relative to the packed
+ * directory, e.g. "assets/player.bmp".
+ */
+
+
+struct AssetPackEntry {
+    uint64_t name_hash;
+    uint64_t offset;        //!< of the data, from the start of the file
+    uint64_t size;
+    uint32_t name_offset;   //!< from the start of the names
+    uint32_t name_length;
+};
+
+
+/**
+ * Read-only asset pack, memory-mapped for as long as it is open. Entries are
+ * read straight from the mapping through SDL_IOFromConstMem(), without
+ * opening or copying files.
+ *
+ * Packs are built with AssetPackWriter, or the `asset_packer` tool.
+ */
+class AssetPack {
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    const AssetPackEntry* m_entries = nullptr;
+    const uint32_t* m_slots = nullptr;
+    const char* m_names = nullptr;
+    uint32_t m_entry_count = 0;
+    uint32_t m_slot_count = 0;
+#ifdef _WIN32
+    void* m_file_handle = nullptr;
+    void* m_mapping_handle = nullptr;
+#endif
+
+    Result<VoidResult, GameError> __map(const std::string& path);
+    void __unmap();
+    Result<VoidResult, GameError> __readTableOfContents(const std::string& path);
+public:
+    AssetPack() = default;
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    /**
+     * FNV-1a hash of an entry name.
+     */
+    static uint64_t hashName(const std::string& name);
+
+    Result<VoidResult, GameError> open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; };
+
+    /**
+     * The entry named `name`, or null.
+     */
+    const AssetPackEntry* find(const std::string& name) const;
+
+    /**
+     * Data of `entry`, valid while the pack is open.
+     */
+    const uint8_t* getEntryData(const AssetPackEntry* entry) const { return m_data + entry->offset; };
+
+    /**
+     * Read-only stream over the entry named `name`, or null. The stream must
+     * be closed before the pack.
+     */
+    SDL_IOStream* openEntry(const std::string& name) const;
+
+    size_t getEntryCount() const { return m_entry_count; };
+};
+
+
+/**
+ * Builds an AssetPack file from loose files.
+ */
+class AssetPackWriter {
+private:
+    struct PendingEntry {
+        std::string name;
+        std::string file_path;
+    };
+
+    std::vector<PendingEntry> m_entries;
+    std::unordered_map<std::string, size_t> m_entry_indices;
+public:
+    /**
+     * Pack the file at `file_path` as `name`, normalized. A later file with
+     * the same name replaces it.
+     */
+    void addFile(const std::string& name, const std::string& file_path);
+
+    size_t getEntryCount() const { return m_entries.size(); };
+
+    Result<VoidResult, GameError> write(const std::string& pack_path);
+};
+
+
+#endif
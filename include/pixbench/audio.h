@@ -132,20 +132,33 @@ struct SDL_AudioDevice {
 
 
 class AudioContext {
+private:
+    bool m_is_headless{ false };
 public:
     SDL_AudioDeviceID audio_device{ 0 };
     SDL_AudioSpec audio_spec;
     MusicPlayer* music_player{ nullptr };
     int num_channel{ MIX_DEFAULT_CHANNELS };
     
+    /*
+     * Set `headless` to `true` to create a null audio backend, no audio
+     * device will be opened and AudioSystem won't call into SDL_mixer.
+     */
     AudioContext(
-            int num_channels
-            ) {
-        // Prepare audio spec
+            int num_channels,
+            bool headless = false
+            ) : m_is_headless(headless) {
+        // Prepare audio spec, the null backend times clips with it
         audio_spec.format = SDL_AUDIO_F32;
         audio_spec.channels = 2;
         audio_spec.freq = 44100;
 
+        if ( headless ) {
+            this->num_channel = num_channels;
+            music_player = new MusicPlayer();
+            return;
+        }
+
         // Open audio device
         // we determined default audio device here
         SDL_AudioDeviceID opened_device = SDL_OpenAudioDevice(
@@ -180,6 +193,13 @@ public:
         return this->num_channel;
     }
 
+    /*
+     * Returns `true` if this is a null audio backend (headless mode)
+     */
+    bool isHeadless() const {
+        return m_is_headless;
+    }
+
     void closeCurrentAudioDevice() {
         if ( !audio_device )
             return;
@@ -252,6 +272,9 @@ public:
  * return: Result::Ok containing std::shared_ptr<AudioClip> if the chunk is
  * successfuly loaded. Otherwise return Result::Err containing error message
  * as std::string
+ *
+ * The clip is decoded again on every call, `game->assets.loadAudioClip()`
+ * shares one clip per path, see AssetCache.
  */
 Result<std::shared_ptr<AudioClip>, std::string> LoadAudioClip(std::string clip_path);
 
@@ -0,0 +1,76 @@
+#ifndef COMMAND_BUFFER_HEADER
+#define COMMAND_BUFFER_HEADER
+
+
+#include "pixbench/entity.h"
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+
+class EntityManager;
+
+
+/**
+ * Entity changes recorded to be applied later, in recording order, with
+ * EntityCommandBuffer::playback().
+ *
+ * Parallel-safe scripts (see ScriptComponent::isParallelSafe()) must go
+ * through the buffer returned by EntityManager::getCommandBuffer() to create
+ * or destroy entities, add or remove components, or write to other
+ * entities' components.
+ *
+ * Usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * auto commands = entity_mgr->getCommandBuffer();
+ * commands->destroyEntity(self);
+ * commands->addComponent<Transform>(target, [] (Transform* transform) {
+ *     transform->x = 0.0;
+ * });
+ * ~~~~~~~~~~~~~~~~~~~~
+ */
+class EntityCommandBuffer {
+private:
+    std::vector<std::function<void(EntityManager*)>> m_commands;
+public:
+    /**
+     * Record any change, e.g. a write to another entity's component.
+     */
+    void defer(std::function<void(EntityManager*)> command) {
+        m_commands.push_back(command);
+    };
+
+    void destroyEntity(EntityID entity);
+
+    /**
+     * Create an entity on playback, `setup` is then called with its ID.
+     */
+    void createEntity(std::function<void(EntityManager*, EntityID)> setup);
+
+    /**
+     * Add component `T` to `entity` on playback, then call `setup` with it.
+     * Defined in ecs.h.
+     */
+    template<typename T>
+    void addComponent(EntityID entity, std::function<void(T*)> setup = nullptr);
+
+    /**
+     * Defined in ecs.h.
+     */
+    template<typename T>
+    void removeComponent(EntityID entity);
+
+    size_t size() const { return m_commands.size(); };
+    bool empty() const { return m_commands.empty(); };
+
+    /**
+     * Apply and clear the recorded commands. Commands recorded during the
+     * playback are applied too.
+     */
+    void playback(EntityManager* entity_mgr);
+
+    void clear() { m_commands.clear(); };
+};
+
+
+#endif
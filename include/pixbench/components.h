@@ -4,6 +4,7 @@
 
 #include "pixbench/audio.h"
 #include "pixbench/entity.h"
+#include "pixbench/event_registry.h"
 #include "pixbench/physics/type.h"
 #include "pixbench/utils/results.h"
 #include "pixbench/renderer.h"
@@ -17,6 +18,7 @@
 
 // ========== FORWARD DECLARATION ========== BEGIN
 class Game;
+class RenderSnapshot;
 
 /*
  * ! special case of forward declaration for system. Component idealy shouldn't
@@ -86,6 +88,21 @@ private:
     Vector2 globalPosition = Vector2::ZERO;
     double _last_parent_rotation = 0.0;
 
+    // state at the start of the last FixedUpdate step, for render interpolation
+    Vector2 previousGlobalPosition = Vector2::ZERO;
+    double previousRotation = 0.0;
+    bool m_has_previous_state = false;
+    // state at the end of the last FixedUpdate steps, differs once written
+    // outside of them
+    Vector2 fixedStepGlobalPosition = Vector2::ZERO;
+    double fixedStepRotation = 0.0;
+
+    /**
+     * `true` if the state is still the one FixedUpdate left, so it can be
+     * blended with the previous one.
+     */
+    bool isInterpolated();
+
 public:
     double rotation = 0.0;
     double localRotation = 0.0;
@@ -111,6 +128,44 @@ public:
     inline Vector2 LocalPosition() {return this->localPosition;};
     inline Vector2 GlobalPosition() {return this->globalPosition;};
 
+    /**
+     * Global position blended between the previous and the current
+     * FixedUpdate step, `alpha` = 0.0 is the previous step and 1.0 is the
+     * current one. Transforms written outside of FixedUpdate since the last
+     * step (e.g. moved in Update) aren't blended, their current position is
+     * returned.
+     */
+    Vector2 InterpolatedPosition(double alpha);
+
+    /**
+     * Rotation blended between the previous and the current FixedUpdate
+     * step, with the same exception as Transform::InterpolatedPosition().
+     */
+    double InterpolatedRotation(double alpha);
+
+    /**
+     * Drop the previous state so the next frame renders the current state
+     * as is, call this after teleporting an entity from FixedUpdate.
+     */
+    inline void resetInterpolation() { m_has_previous_state = false; };
+
+    /**
+     * Called by Game before each FixedUpdate step.
+     */
+    inline void __storePreviousState() {
+        this->previousGlobalPosition = this->globalPosition;
+        this->previousRotation = this->rotation;
+        this->m_has_previous_state = true;
+    }
+
+    /**
+     * Called by Game after the FixedUpdate steps of a frame.
+     */
+    inline void __storeFixedStepState() {
+        this->fixedStepGlobalPosition = this->globalPosition;
+        this->fixedStepRotation = this->rotation;
+    }
+
     const Vector2* __globalPosPtr() { return &globalPosition; }
     const Vector2* __localPosPtr() { return &localPosition; }
 
@@ -420,17 +475,28 @@ public:
         }
     };
 
+    /**
+     * Draw `region` of its texture, e.g. an image from a TextureAtlas.
+     * The target size is set to the region's size.
+     */
+    void SetTexture(const TextureRegion& region) {
+        this->texture = region.texture;
+        this->srect = region.rect;
+        this->drect.w = region.rect.w;
+        this->drect.h = region.rect.h;
+    };
+
     void SetSrcAndDstRectToCoverWholeTexture() {
         if (!this->texture) 
             return;
 
         this->srect.x = 0;
         this->srect.y = 0;
-        this->srect.w = this->texture->texture->w;
-        this->srect.h = this->texture->texture->h;
+        this->srect.w = this->texture->w;
+        this->srect.h = this->texture->h;
 
-        this->drect.w = this->texture->texture->w;
-        this->drect.h = this->texture->texture->h;
+        this->drect.w = this->texture->w;
+        this->drect.h = this->texture->h;
     }
 
     /*
@@ -443,13 +509,13 @@ public:
 
     int texture_width() {
         if (this->texture)
-            return texture->texture->w;
+            return texture->w;
         return 0;
     }
 
     int texture_height() {
         if (this->texture)
-            return texture->texture->h;
+            return texture->h;
         return 0;
     }
 
@@ -495,6 +561,13 @@ public:
 
     virtual void Init(Game* game, EntityManager* entityManager, EntityID self) { };
     virtual void Draw(RenderContext* renderContext, EntityManager* entity_mgr) { };
+
+    /**
+     * Record draw commands into `snapshot` instead of drawing directly.
+     * Return `false` (the default) to have Draw() called instead, which is
+     * not possible in pipelined mode, where the renderable is then skipped.
+     */
+    virtual bool DrawToSnapshot(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) { return false; };
 };
 
 
@@ -537,6 +610,7 @@ public:
     void __resetNeedSyncStatus();
     void __setIsPlaying(bool is_playing);
     void __setIsFinished(bool is_finished);
+    void __setPosition(double position_s);
 
     inline bool __isNeedToReplay() {
         return m_is_need_to_replay;
@@ -606,11 +680,30 @@ public:
         return CTAG_Script;
     };
 
+    /**
+     * Hide it with `static bool isParallelSafe() { return true; }` in a
+     * script type whose Update() only touches its own entity's components.
+     * ScriptSystem then updates its instances in parallel on Game::jobPool,
+     * any other entity change must go through
+     * `entityManager->getCommandBuffer()`. Other hooks still run serially.
+     */
+    static bool isParallelSafe() {
+        return false;
+    };
+
     virtual Void Init(Game* game, EntityManager* entityManager, EntityID self) { return ResultOK; };
     virtual Void Update(double deltaTime_s, EntityManager* entityManager, EntityID self) { return ResultOK; };
     virtual Void LateUpdate(double deltaTime_s, EntityManager* entityManager, EntityID self) { return ResultOK; };
     virtual Void FixedUpdate(double deltaTime_s, EntityManager* entityManager, EntityID self) { return ResultOK; };
     virtual Void Draw(RenderContext* renderContext, EntityManager* entity_mgr, EntityID self) { return ResultOK; };
+
+    /**
+     * Register the SDL event types handled by ScriptComponent::OnEvent(),
+     * called once when the script is added. Override it to only receive the
+     * events you need, e.g. `subscription->subscribe(SDL_EVENT_KEY_DOWN);`,
+     * by default the script receives every event.
+     */
+    virtual void SubscribeEvents(EventSubscription* subscription) { subscription->subscribeAll(); };
     virtual Void OnEvent(SDL_Event* event, EntityManager* entityManager, EntityID self) { return ResultOK; };
     virtual Void OnDestroy(EntityManager* entityManager, EntityID self) { return ResultOK; };
 };
@@ -0,0 +1,91 @@
+#ifndef COOKED_TEXTURE_HEADER
+#define COOKED_TEXTURE_HEADER
+
+
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_pixels.h>
+#include <SDL3/SDL_rect.h>
+#include <SDL3/SDL_surface.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+#define COOKED_TEXTURE_MAGIC "PXTX"
+#define COOKED_TEXTURE_VERSION 1
+#define COOKED_TEXTURE_EXTENSION ".pxtex"
+#define COOKED_TEXTURE_BLOCK_SIZE 65536     //!< target uncompressed bytes per block, whole rows
+#define COOKED_TEXTURE_PARALLEL_MIN_SIZE (1 << 20)  //!< uncompressed bytes from which blocks are decompressed in parallel
+#define COOKED_TEXTURE_MAX_DECODE_THREADS 4
+
+
+/*
+ * Cooked texture file layout (host byte order, like replay files):
+ *
+ *     header: char magic[4], uint32 version, uint32 width, uint32 height,
+ *             uint32 pixel_format (SDL_PixelFormat), uint32 pitch,
+ *             uint32 compression (CookedTextureCompression),
+ *             uint32 block_rows, uint32 block_count, uint32 frame_count
+ *     frames: frame_count SDL_FRect, sprite sheet frames
+ *     blocks: block_count uint32, stored size of each block
+ *     data:   the blocks, `block_rows` rows of pixels each (fewer for the
+ *             last one), LZ4 compressed or, if that didn't make them
+ *             smaller, stored as is
+ *
+ * Pixels are stored in the layout SDL_CreateSurface() gives `pixel_format`,
+ * so they are uploaded without conversion.
+ */
+
+
+enum class CookedTextureCompression : uint32_t {
+    NONE = 0,
+    LZ4 = 1,
+};
+
+
+/**
+ * Pixels and sprite sheet frames of a cooked texture.
+ */
+struct CookedTexture {
+    SDL_Surface* surface = nullptr;     //!< owned by the caller once loaded
+    std::vector<SDL_FRect> frames;
+};
+
+
+/**
+ * `true` if `path` ends with COOKED_TEXTURE_EXTENSION.
+ */
+bool IsCookedTexturePath(const std::string& path);
+
+/**
+ * Write the pixels of `surface`, converted to `pixel_format`, and `frames`
+ * to a cooked texture file at `path`. Pick the format the target renderer
+ * prefers, SDL_PIXELFORMAT_ARGB8888 for most.
+ */
+Result<VoidResult, GameError> CookTexture(
+        SDL_Surface* surface,
+        const std::vector<SDL_FRect>& frames,
+        const std::string& path,
+        CookedTextureCompression compression = CookedTextureCompression::LZ4,
+        SDL_PixelFormat pixel_format = SDL_PIXELFORMAT_ARGB8888
+        );
+
+/**
+ * Read a cooked texture from `stream`, closed afterward if `close_stream`.
+ *
+ * LZ4 blocks of textures of at least COOKED_TEXTURE_PARALLEL_MIN_SIZE bytes
+ * are decompressed on `decode_threads` threads, the calling one included:
+ * up to COOKED_TEXTURE_MAX_DECODE_THREADS by CPU cores if 0, and only the
+ * calling thread if 1. The extra threads are started for the call, so it
+ * is safe from any thread, AssetLoader workers included.
+ */
+Result<VoidResult, GameError> LoadCookedTexture(
+        SDL_IOStream* stream,
+        bool close_stream,
+        CookedTexture* out__cooked,
+        int decode_threads = 0
+        );
+
+
+#endif
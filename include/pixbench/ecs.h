@@ -1,14 +1,17 @@
 #ifndef ECS_HEADER
 #define ECS_HEADER
 
+#include "pixbench/command_buffer.h"
 #include "pixbench/components.h"
 #include "pixbench/entity.h"
 #include "pixbench/game.h"
 #include "pixbench/engine_config.h"
 #include "pixbench/hierarchy.h"
+#include "pixbench/script_batch.h"
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_rect.h>
 #include <SDL3/SDL_surface.h>
+#include <algorithm>
 #include <array>
 #include <bitset>
 #include <cstddef>
@@ -20,6 +23,7 @@
 #include <queue>
 #include <strings.h>
 #include <sys/types.h>
+#include <tuple>
 #include <typeinfo>
 #include <unordered_map>
 #include <utility>
@@ -31,10 +35,36 @@
  * multiple types of ComponentArray
  */
 class IComponentArray {
+protected:
+    /** entity ID of each index in the components array, NO_ENTITY for unused indexes */
+    EntityIDNumber m_index_to_entity[MAX_ENTITIES];
+    /** empty index at the end of the components array */
+    size_t m_last_empty_component_index = 0;
+    size_t m_component_count = 0;
+
 public:
+    static const EntityIDNumber NO_ENTITY = (EntityIDNumber)-1;
+
+    IComponentArray() {
+        std::fill(m_index_to_entity, m_index_to_entity + MAX_ENTITIES, NO_ENTITY);
+    }
+
     virtual ~IComponentArray() = default;
     virtual void handleEntityDestroyed(EntityIDNumber entity_id) = 0;
     virtual IComponent* getIComponentById(EntityIDNumber entity_id) = 0;
+
+    /**
+     * Number of components stored.
+     */
+    size_t size() const { return m_component_count; };
+
+    /**
+     * Upper bound of the used indexes in the components array, unused
+     * indexes below it have `__entityAtIndex() == NO_ENTITY`.
+     */
+    size_t __indexCount() const { return m_last_empty_component_index; };
+
+    EntityIDNumber __entityAtIndex(size_t index) const { return m_index_to_entity[index]; };
 };
 
 
@@ -48,18 +78,20 @@ public:
 template <typename T>
 class ComponentArray : public IComponentArray {
 private:
-    /** map of entity ID to index in m_components */
-    std::unordered_map<EntityIDNumber, size_t> m_entity_to_index_map;
-    /** map of index in m_components to entity ID */
-    std::unordered_map<size_t, EntityIDNumber> m_index_to_entity_map;
+    static const size_t NO_INDEX = (size_t)-1;
+
+    /** index in m_components of each entity ID, NO_INDEX if the entity doesn't have T */
+    size_t m_entity_to_index[MAX_ENTITIES];
     /** array of component objects */
     T m_components[MAX_ENTITIES];
     /** queue of empty indexes in the m_components */
     std::queue<size_t> m_empty_index_queue;
-    /** empty index at the end of the m_components array */
-    size_t m_last_empty_component_index = 0;
 
 public:
+    ComponentArray() {
+        std::fill(m_entity_to_index, m_entity_to_index + MAX_ENTITIES, NO_INDEX);
+    }
+
     /**
      * returns pointer of component T in the arrays of stored components.
      * If the entity doesn't have component T, it will return null pointer.
@@ -67,15 +99,22 @@ public:
      * **Note**: *this pointer can be invalid when component arrays grows.*
      */
     T* getComponentByEntityID(EntityIDNumber entity_id) {
-        auto index_pair = m_entity_to_index_map.find(entity_id);
-        if (index_pair != m_entity_to_index_map.end()) {
-            size_t component_index = index_pair->second;
+        const size_t component_index = m_entity_to_index[entity_id];
+        if (component_index != NO_INDEX) {
             return &m_components[component_index];
         }
 
         return nullptr;
     }
 
+    /**
+     * Component at `index` of the components array, see
+     * IComponentArray::__entityAtIndex().
+     */
+    T* __componentAtIndex(size_t index) {
+        return &m_components[index];
+    }
+
     IComponent* getIComponentById(EntityIDNumber entity_id) {
         return this->getComponentByEntityID(entity_id);
     }
@@ -101,8 +140,9 @@ public:
             m_last_empty_component_index++;
         }
 
-        m_entity_to_index_map[entity_id] = new_index;
-        m_index_to_entity_map[new_index] = entity_id;
+        m_entity_to_index[entity_id] = new_index;
+        m_index_to_entity[new_index] = entity_id;
+        ++m_component_count;
     }
 
     /**
@@ -111,9 +151,10 @@ public:
      */
     void removeComponentFromArray(EntityIDNumber entity_id) {
         
-        size_t component_index = m_entity_to_index_map[entity_id];
-        m_entity_to_index_map.erase(entity_id);
-        m_index_to_entity_map.erase(component_index);
+        size_t component_index = m_entity_to_index[entity_id];
+        m_entity_to_index[entity_id] = NO_INDEX;
+        m_index_to_entity[component_index] = NO_ENTITY;
+        --m_component_count;
 
         m_empty_index_queue.push(component_index);
     }
@@ -122,8 +163,7 @@ public:
      * Remove components from entity if the entity have the component
      */
     void handleEntityDestroyed(EntityIDNumber entity_id) override {
-        auto index_pair = m_entity_to_index_map.find(entity_id);
-        if (index_pair != m_entity_to_index_map.end()) {
+        if (m_entity_to_index[entity_id] != NO_INDEX) {
             this->removeComponentFromArray(entity_id);
         }
     }
@@ -139,10 +179,14 @@ private:
     std::map<size_t, ComponentType> m_index_to_component_type_map;
 
     std::vector<std::shared_ptr<IComponentArray>> m_component_arrays;
+    /** createScriptBatch<T>() of each component index, returns nullptr for non-script components */
+    std::vector<ScriptBatchFactory> m_script_batch_factories;
+    std::vector<ComponentTag> m_component_tags;     //!< tag of each component index
 
 public:
     std::function<void(ComponentTag, ComponentType, size_t)> component_registered_callback{ nullptr };
     std::function<void(ComponentTag, ComponentType, size_t, EntityID)> component_added_to_entity_callback{ nullptr };
+    std::function<void(ComponentTag, ComponentType, size_t, EntityID)> component_removed_from_entity_callback{ nullptr };
 
     template<typename T>
     void registerComponent() {
@@ -156,11 +200,14 @@ public:
 
             auto new_component_array = std::make_shared<ComponentArray<T>>();
             m_component_arrays.push_back(new_component_array);
+            m_script_batch_factories.push_back(&::createScriptBatch<T>);
+
+            T dummy_obj = T();
+            ComponentTag ctag = static_cast<IComponent*>(&dummy_obj)->getCTag();
+            m_component_tags.push_back(ctag);
 
             if (component_registered_callback)
             {
-                T dummy_obj = T();
-                ComponentTag ctag = static_cast<IComponent*>(&dummy_obj)->getCTag();
                 component_registered_callback(ctag, component_type, new_index);
             }
         }
@@ -213,13 +260,45 @@ public:
     }
 
     template<typename T>
-    void removeComponentFromEntity(EntityIDNumber entity_id) {
+    void removeComponentFromEntity(EntityID entity_id) {
+        ComponentType component_type = typeid(T).hash_code();
+
         std::shared_ptr<ComponentArray<T>> component_array = this->getComponentArray<T>();
         if (component_array != nullptr) {
-            component_array->removeComponentFromArray(entity_id);
+            // notify while the component still exists
+            T* component = component_array->getComponentByEntityID(entity_id.id);
+            if (component_removed_from_entity_callback && component) {
+                ComponentTag ctag = static_cast<IComponent*>(component)->getCTag();
+                size_t component_index = m_component_type_to_index_map[component_type];
+                component_removed_from_entity_callback(
+                        ctag, component_type, component_index,
+                        entity_id
+                        );
+            }
+
+            component_array->removeComponentFromArray(entity_id.id);
         }
     };
 
+    /**
+     * Call `callback` with every registered component, in index order, the
+     * same way as `component_registered_callback`.
+     */
+    void forEachRegisteredComponent(std::function<void(ComponentTag, ComponentType, size_t)> callback) {
+        for (size_t index=0; index<m_component_tags.size(); ++index)
+            callback(m_component_tags[index], m_index_to_component_type_map[index], index);
+    }
+
+    /**
+     * New IScriptBatch for the script component at `component_index`, owned
+     * by the caller. Returns nullptr if it isn't a script component.
+     */
+    IScriptBatch* createScriptBatch(size_t component_index) {
+        if (component_index >= m_script_batch_factories.size())
+            return nullptr;
+        return m_script_batch_factories[component_index]();
+    }
+
     template<typename T>
     T* getEntityComponent(EntityIDNumber entity_id){
         ComponentType component_type = typeid(T).hash_code();
@@ -271,6 +350,10 @@ struct ComponentDataPayload {
 };
 
 
+template<typename... Ts>
+class EntityQuery;
+
+
 /**
  * This class is the most important interface to the ECS system.
  * EntityManager stored and keep tracks of all entities, their components, and
@@ -292,6 +375,8 @@ private:
      */
     std::function<void(EntityID entity_id)> m_on_entity_destroyed_callback { nullptr };
 
+    EntityCommandBuffer m_command_buffer;   //!< returned by getCommandBuffer() outside of parallel jobs
+
 public:
 
     Game* game = nullptr;
@@ -328,6 +413,12 @@ public:
      */
     std::vector<EntityID> getUninitializedEntities();
 
+    /**
+     * `true` if there are entities whose Init function haven't been called
+     * yet, without copying the list.
+     */
+    bool hasUninitializedEntities() const { return !m_uninitialized_entities.empty(); };
+
     /**
      * Remove entity from uninitialized list
      */
@@ -355,6 +446,80 @@ public:
             std::function<void(ComponentTag, ComponentType, size_t, EntityID)>
             );
 
+    /**
+     * Set ComponentManager's `component_removed_from_entity_callback`, called
+     * before a component is removed with EntityManager::removeComponentFromEntity().
+     * Destroyed entities are reported with the OnEntityDestroyed callback instead.
+     */
+    void setComponentRemovedFromEntityCallback(
+            std::function<void(ComponentTag, ComponentType, size_t, EntityID)>
+            );
+
+    /**
+     * Typed query of the entities having all the components `Ts`, see
+     * EntityQuery. Defined after EntityQuery.
+     */
+    template<typename... Ts>
+    EntityQuery<Ts...> query();
+
+    /**
+     * Command buffer to defer entity changes to, see EntityCommandBuffer.
+     *
+     * Inside a parallel script job it's the job's own buffer, applied once
+     * the jobs are done. Otherwise it's EntityManager's buffer, applied by
+     * Game after each of the Update, FixedUpdate and LateUpdate cascades.
+     */
+    EntityCommandBuffer* getCommandBuffer();
+
+    /**
+     * Set the buffer returned by getCommandBuffer() on the calling thread,
+     * `nullptr` to restore the default one.
+     */
+    static void __setThreadCommandBuffer(EntityCommandBuffer* command_buffer);
+
+    /**
+     * Apply the commands of EntityManager's own command buffer.
+     */
+    void __playbackCommands() {
+        if ( !m_command_buffer.empty() )
+            m_command_buffer.playback(this);
+    }
+
+    /**
+     * Read more on `ComponentManager::forEachRegisteredComponent`
+     */
+    void __forEachRegisteredComponent(std::function<void(ComponentTag, ComponentType, size_t)> callback) {
+        m_component_manager->forEachRegisteredComponent(callback);
+    }
+
+    /**
+     * ComponentArray of `T`, registering `T` if needed, used by EntityQuery.
+     */
+    template<typename T>
+    ComponentArray<T>* __getComponentArray() {
+        m_component_manager->getComponentIndex<T>();
+        return m_component_manager->getComponentArray<T>().get();
+    }
+
+    /**
+     * EntityID of the active entity `entity_id`, and whether it has all the
+     * components of `component_mask`.
+     */
+    bool __matchEntity(EntityIDNumber entity_id, const std::bitset<MAX_COMPONENTS>& component_mask, EntityID* out__entity) const {
+        const EntityInfo& info = m_entities[entity_id];
+        if ( !info.active || (info.component_mask & component_mask) != component_mask )
+            return false;
+        *out__entity = info.entityid;
+        return true;
+    }
+
+    /**
+     * Read more on `ComponentManager::createScriptBatch`
+     */
+    IScriptBatch* __createScriptBatch(size_t component_index) {
+        return m_component_manager->createScriptBatch(component_index);
+    }
+
     void setOnEntityDestroyedCallback(
             std::function<void(EntityID entity_id)>
             );
@@ -453,7 +618,7 @@ public:
             return false;
         }
 
-        m_component_manager->removeComponentFromEntity<T>(entity.id);
+        m_component_manager->removeComponentFromEntity<T>(entity);
         m_entities[entity.id].component_mask[component_index] = false;
 
         return true;
@@ -509,6 +674,9 @@ public:
         this->m_unused_entity_queue.push(entity.id);
         // reset component mask
         this->m_entities[entity.id].component_mask.reset();
+        // reset tag mask, a freed tag index may be handed to another tag
+        // and the entity reusing this slot must not inherit it
+        this->m_entities[entity.id].tag_mask.reset();
     }
 
     /*
@@ -566,6 +734,116 @@ public:
 };
 
 
+template<size_t... Is>
+struct __IndexSequence {};
+
+template<size_t N, size_t... Is>
+struct __MakeIndexSequence : __MakeIndexSequence<N - 1, N - 1, Is...> {};
+
+template<size_t... Is>
+struct __MakeIndexSequence<0, Is...> {
+    typedef __IndexSequence<Is...> type;
+};
+
+
+/**
+ * Typed query of the entities that have all the components `Ts`.
+ *
+ * EntityQuery::forEach() walks the component array of the rarest of `Ts`
+ * in storage order, and calls a function with the entity and pointers to
+ * its components, without any virtual call per entity. Usage:
+ * ~~~~~~~~~~~~~~~~{.cpp}
+ * entity_mgr->query<Transform, Velocity>().forEach(
+ *         [&] (EntityID entity, Transform* transform, Velocity* velocity) {
+ *             transform->SetLocalPosition(transform->LocalPosition() + velocity->value * dt);
+ *         });
+ * ~~~~~~~~~~~~~~~~
+ * Entities must not be created or destroyed, nor components of `Ts` added
+ * or removed, during forEach(), use EntityManager::getCommandBuffer().
+ */
+template<typename... Ts>
+class EntityQuery {
+private:
+    EntityManager* m_entity_mgr;
+    std::bitset<MAX_COMPONENTS> m_component_mask;
+    std::tuple<ComponentArray<Ts>*...> m_arrays;
+    IComponentArray* m_driver_array = nullptr;      //!< smallest of m_arrays
+
+    template<typename F, size_t... Is>
+    void __forEach(F& func, __IndexSequence<Is...>) {
+        const size_t index_count = m_driver_array->__indexCount();
+        for (size_t index=0; index<index_count; ++index) {
+            const EntityIDNumber entity_id = m_driver_array->__entityAtIndex(index);
+            if (entity_id == IComponentArray::NO_ENTITY)
+                continue;
+
+            EntityID entity;
+            if ( !m_entity_mgr->__matchEntity(entity_id, m_component_mask, &entity) )
+                continue;
+
+            func(entity, std::get<Is>(m_arrays)->getComponentByEntityID(entity_id)...);
+        }
+    }
+
+public:
+    EntityQuery(EntityManager* entity_mgr)
+        :
+        m_entity_mgr(entity_mgr),
+        m_arrays(entity_mgr->__getComponentArray<Ts>()...)
+    {
+        m_component_mask.reset();
+        const size_t component_indexes[] = { entity_mgr->getComponentIndex<Ts>()... };
+        IComponentArray* arrays[] = { entity_mgr->__getComponentArray<Ts>()... };
+        for (size_t i=0; i<sizeof...(Ts); ++i) {
+            m_component_mask.set(component_indexes[i]);
+            if ( !m_driver_array || arrays[i]->size() < m_driver_array->size() )
+                m_driver_array = arrays[i];
+        }
+    }
+
+    /**
+     * Call `func(EntityID, Ts*...)` for each matching entity.
+     */
+    template<typename F>
+    void forEach(F func) {
+        this->__forEach(func, typename __MakeIndexSequence<sizeof...(Ts)>::type());
+    }
+
+    /**
+     * Number of matching entities.
+     */
+    size_t count() {
+        size_t matches = 0;
+        this->forEach([&matches] (EntityID, Ts*...) { ++matches; });
+        return matches;
+    }
+};
+
+
+template<typename... Ts>
+EntityQuery<Ts...> EntityManager::query() {
+    return EntityQuery<Ts...>(this);
+}
+
+
+template<typename T>
+void EntityCommandBuffer::addComponent(EntityID entity, std::function<void(T*)> setup) {
+    m_commands.push_back([entity, setup] (EntityManager* entity_mgr) {
+            T* component = entity_mgr->addComponentToEntity<T>(entity);
+            if (component && setup)
+                setup(component);
+            });
+}
+
+
+template<typename T>
+void EntityCommandBuffer::removeComponent(EntityID entity) {
+    m_commands.push_back([entity] (EntityManager* entity_mgr) {
+            entity_mgr->removeComponentFromEntity<T>(entity);
+            });
+}
+
+
 /**
  * Usage example:
  * ~~~~~~~~~~~~~~~~{.cpp}
@@ -712,7 +990,6 @@ public:
             // Unpack the template parameters into an initializer list
             std::array<size_t, sizeof...(Types)> component_ids = { entity_mgr->getComponentIndex<Types>() ... };
             for (int i = 0; i < sizeof...(Types); i++) {
-                std::cout << "++> i:" << i << " " << component_ids[i] << std::endl;
                 component_mask.set(component_ids[i]);
             }
         }
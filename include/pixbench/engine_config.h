@@ -45,10 +45,55 @@ const size_t AUDIO_NUM_CHANNELS = 8;
 
 
 
+/*
+ * SCRIPTS
+ */
+/* Instances of a parallel-safe script type per job of Game::jobPool, also the
+ * granularity of its command buffers. Fixed so the order of the deferred
+ * commands doesn't depend on the number of threads.
+ * */
+const size_t SCRIPT_PARALLEL_CHUNK_SIZE = 256;
+
+
+
+/*
+ * RENDERING
+ */
+/* Width and height, in tiles, of the chunks a TileMapLayer is split into.
+ * Each chunk's static tiles are baked once into a vertex buffer that is drawn
+ * as a whole when the chunk is visible.
+ * */
+const int TILEMAP_CHUNK_SIZE = 16;
+
+/* Cell size, in scene units, of the grid RenderingSystem culls renderables
+ * with. Renderables larger than a cell are tested against the camera every
+ * frame, so this should be above the size of most sprites.
+ * */
+const float RENDER_GRID_CELL_SIZE = 256.0f;
+
+/* Maximum width and height, in pixels, of a TextureAtlas page. 2048 is
+ * supported by every SDL renderer backend.
+ * */
+const int TEXTURE_ATLAS_PAGE_SIZE = 2048;
+
+
+
+/*
+ * TIMERS
+ */
+/* Resolution of Game::timers, delays are rounded up to whole ticks. */
+const double TIMER_WHEEL_TICK_S = 0.001;
+
+
+
 /*
  * PHYSICS
  */
-const size_t FIXED_UPDATE_RATE = 60;
+/* Number of FixedUpdate steps per second. Rendering interpolates Transform
+ * between the last two steps, so this can stay well below the display's
+ * refresh rate.
+ * */
+const size_t FIXED_UPDATE_RATE = 30;
 const size_t MAX_POLYGON_VERTEX = 16;
 
 #define RAYCAST_AABBOX_MARGIN 4
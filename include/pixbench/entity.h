@@ -42,6 +42,7 @@ class EntityTagAPI {
 private:
     std::unordered_map<std::string, int> m_tag_to_index_map;
     std::string m_index_to_tag_array[MAX_TAGS];
+    std::vector<int> m_free_tag_indices;            //!< indices of removed tags, reused before tag_index_counter
     EntityManager* m_entity_manager = nullptr;
     EntityInfo* m_ent_mgr_entities = nullptr;       //!< entityManager's m_entities
     int tag_index_counter = 0;
@@ -0,0 +1,139 @@
+#ifndef EVENT_REGISTRY_HEADER
+#define EVENT_REGISTRY_HEADER
+
+
+#include <SDL3/SDL_stdinc.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Handed to ISystem::SubscribeEvents() and ScriptComponent::SubscribeEvents()
+ * to register the SDL event types (`SDL_EventType`) the subscriber handles.
+ * Subscribers only get their OnEvent called for those types.
+ */
+class EventSubscription {
+public:
+    virtual ~EventSubscription() {};
+
+    /**
+     * Receive events of `event_type`.
+     */
+    virtual void subscribe(Uint32 event_type) = 0;
+
+    /**
+     * Receive every event, this is the default for subscribers that don't
+     * override SubscribeEvents.
+     */
+    virtual void subscribeAll() = 0;
+};
+
+
+/**
+ * Subscribers per SDL event type, dispatching an event only walks the
+ * subscribers of its type instead of broadcasting it.
+ *
+ * Subscribers of a type are kept in subscription order, subscribers of every
+ * type (EventRegistry::subscribeAll) are merged in that order too.
+ */
+template<typename Subscriber>
+class EventRegistry {
+public:
+    struct Entry {
+        size_t sequence;
+        Subscriber subscriber;
+    };
+
+    /**
+     * EventSubscription registering a single subscriber into this registry.
+     */
+    class Subscription : public EventSubscription {
+    private:
+        EventRegistry* m_registry;
+        Subscriber m_subscriber;
+    public:
+        Subscription(EventRegistry* registry, const Subscriber& subscriber)
+            : m_registry(registry), m_subscriber(subscriber) {};
+
+        void subscribe(Uint32 event_type) override {
+            m_registry->subscribe(event_type, m_subscriber);
+        };
+
+        void subscribeAll() override {
+            m_registry->subscribeAll(m_subscriber);
+        };
+    };
+
+private:
+    std::unordered_map<Uint32, std::vector<Entry>> m_by_type;
+    std::vector<Entry> m_all_types;     //!< subscribers of every event type
+    size_t m_next_sequence = 0;
+
+    static void insertOrdered(std::vector<Entry>& entries, const Entry& entry) {
+        // almost always appended at the end
+        auto it = entries.end();
+        while (it != entries.begin() && (it - 1)->sequence > entry.sequence)
+            --it;
+        entries.insert(it, entry);
+    }
+
+public:
+    void subscribe(Uint32 event_type, const Subscriber& subscriber) {
+        Entry entry = { m_next_sequence++, subscriber };
+
+        auto type_entries = m_by_type.find(event_type);
+        if (type_entries == m_by_type.end()) {
+            // a type's list also holds the subscribers of every type
+            type_entries = m_by_type.insert(std::make_pair(event_type, m_all_types)).first;
+        }
+        insertOrdered(type_entries->second, entry);
+    }
+
+    void subscribeAll(const Subscriber& subscriber) {
+        Entry entry = { m_next_sequence++, subscriber };
+
+        m_all_types.push_back(entry);
+        for (auto& type_entries : m_by_type)
+            insertOrdered(type_entries.second, entry);
+    }
+
+    /**
+     * Remove every subscription of subscribers for which `predicate` returns
+     * `true`.
+     */
+    template<typename Predicate>
+    void unsubscribeIf(Predicate predicate) {
+        auto remove_from = [&predicate](std::vector<Entry>& entries) {
+            size_t kept = 0;
+            for (size_t i=0; i<entries.size(); ++i) {
+                if ( !predicate(entries[i].subscriber) )
+                    entries[kept++] = entries[i];
+            }
+            entries.resize(kept);
+        };
+
+        remove_from(m_all_types);
+        for (auto& type_entries : m_by_type)
+            remove_from(type_entries.second);
+    }
+
+    void clear() {
+        m_by_type.clear();
+        m_all_types.clear();
+        m_next_sequence = 0;
+    }
+
+    /**
+     * Subscribers of `event_type`, in subscription order.
+     */
+    const std::vector<Entry>& subscribersOf(Uint32 event_type) const {
+        auto type_entries = m_by_type.find(event_type);
+        if (type_entries == m_by_type.end())
+            return m_all_types;
+        return type_entries->second;
+    }
+};
+
+
+#endif
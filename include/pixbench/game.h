@@ -2,13 +2,20 @@
 #define GAME_HEADER
 
 
+#include "pixbench/asset_cache.h"
+#include "pixbench/asset_loader.h"
+#include "pixbench/event_registry.h"
 #include "pixbench/gameconfig.h"
 #include "pixbench/hierarchy.h"
+#include "pixbench/input.h"
+#include "pixbench/timers.h"
 #include "pixbench/physics/physics.h"
 #include "pixbench/renderer.h"
 #include "pixbench/audio.h"
 #include <SDL3/SDL_log.h>
+#include <SDL3/SDL_events.h>
 #include <SDL3/SDL_render.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,10 +24,35 @@
 struct ComponentDataPayload;
 struct EntityID;
 class EntityManager;
+class FramePipeline;
 class ISystem;
+class JobPool;
+class RenderSnapshot;
+class ReplayPlayer;
+class ReplayRecorder;
 class ScriptSystem;
 
 
+/**
+ * Wall-clock time (in seconds) spent in each phase of the last
+ * Game::Itterate() call. `draw_s` and `present_s` stay zero in headless mode.
+ */
+struct FrameStats {
+    double init_s = 0.0;
+    double update_s = 0.0;
+    double fixed_update_s = 0.0;
+    int fixed_update_steps = 0;
+    double fixed_update_dropped_s = 0.0;    //!< game time skipped because of GameConfig::fixed_update_max_steps
+    double late_update_s = 0.0;
+    double pre_draw_s = 0.0;
+    double draw_s = 0.0;
+    double present_s = 0.0;
+    double asset_upload_s = 0.0;            //!< finishing Game::assetLoader requests
+    double texture_residency_s = 0.0;       //!< evicting Game::assets textures over GameConfig::texture_budget_mb
+    double frame_s = 0.0;
+};
+
+
 /**
  * Game object contains all contexts and manages everything related to the
  * running of the game. Game object also the one that pass SDL event and
@@ -32,15 +64,133 @@ private:
     GameConfig gameConfig;
     //!< basepath of the executable
     std::string basePath;
+    //!< when `true`, game time only moves forward with Game::AdvanceClock()
+    bool m_use_external_clock = false;
+    //!< current time of the external clock
+    double m_external_clock_ns = 0;
+    //!< game time not yet consumed by FixedUpdate steps
+    double m_fixed_update_accumulator_s = 0.0;
+    //!< a component was added since the last Initialize cascade
+    bool m_has_added_components = false;
+
+    /**
+     * Store the current Transform state of every entity as its previous
+     * state, called before each FixedUpdate step.
+     */
+    void storePreviousTransforms();
+
+    /**
+     * Store the current Transform state of every entity as the one left by
+     * FixedUpdate, called after the FixedUpdate steps of a frame. Only
+     * Transforms still in that state are interpolated.
+     */
+    void storeFixedStepTransforms();
+
+    /**
+     * Stable sort `ecs_systems` by SystemSchedule::priority, if needed.
+     */
+    void sortSystemsByPriority();
+
+    //!< systems from Game::RegisterSystem(), added to `ecs_systems` between frames
+    std::vector<std::shared_ptr<ISystem>> m_pending_systems;
+
+    /**
+     * Move `m_pending_systems` to `ecs_systems`, at the start of a frame so
+     * phases never iterate a growing `ecs_systems`.
+     */
+    void addPendingSystems();
+
+    //!< systems by the SDL event types they subscribed to
+    EventRegistry<ISystem*> m_system_event_registry;
+    //!< `ecs_systems` changed since the registry was built
+    bool m_is_system_event_registry_dirty = true;
+    size_t m_system_event_registry_size = 0;
+
+    /**
+     * Rebuild `m_system_event_registry` from ISystem::SubscribeEvents(), in
+     * `ecs_systems` order.
+     */
+    void subscribeSystemsEvents();
+
+    //!< draw commands of the current frame, serial mode only
+    RenderSnapshot* m_render_snapshot = nullptr;
+    //!< simulation thread and double-buffered snapshots, pipelined mode only
+    FramePipeline* m_pipeline = nullptr;
+    //!< set when GameConfig::replay_record_path is set
+    ReplayRecorder* m_replay_recorder = nullptr;
+    //!< set when GameConfig::replay_path is set
+    ReplayPlayer* m_replay_player = nullptr;
+    std::vector<SDL_Event> m_replay_events;     //!< events of the replayed frame
+
+    /**
+     * Apply `--record <file>` and `--replay <file>` from
+     * Game::SetCommandLineArguments() to `gameConfig`.
+     */
+    void applyCommandLineArguments();
+
+    /**
+     * Pass `event` to the systems subscribed to its type.
+     */
+    Result<VoidResult, GameError> dispatchEvent(SDL_Event *event);
+
+    /**
+     * Finish loaded Game::assetLoader requests within
+     * GameConfig::asset_upload_budget_ms, on the main thread while no
+     * simulation runs.
+     */
+    void finishAssetLoads(FrameStats* stats);
+
+    /**
+     * Initialize, Update, FixedUpdate and LateUpdate cascades.
+     */
+    Result<VoidResult, GameError> runSimulation(FrameStats* stats);
+
+    /**
+     * PreDraw cascade (visibility and ordering).
+     */
+    Result<VoidResult, GameError> runPreDraw(FrameStats* stats);
+
+    /**
+     * Clear `snapshot` and let every system record its draw commands.
+     */
+    Result<VoidResult, GameError> recordDraw(RenderSnapshot* snapshot);
+
+    /**
+     * Clear the screen, submit `snapshot`, optionally call the Draw cascade,
+     * and present. Main thread only.
+     */
+    Result<VoidResult, GameError> submitFrame(RenderSnapshot* snapshot, bool call_systems_draw, FrameStats* stats);
+
+    /**
+     * Game::Itterate() for GameConfig::pipelined_rendering.
+     */
+    Result<VoidResult, GameError> itteratePipelined();
+
+    /**
+     * Game::Itterate() without pipelining.
+     */
+    Result<VoidResult, GameError> itterateSerial();
+
+    /**
+     * Game::Itterate() for GameConfig::replay_path: feed the next recorded
+     * frame's events and delta time, quit at the end of the replay.
+     */
+    Result<VoidResult, GameError> itterateReplay();
 public:
     const char* title;                          //!< game title
     RenderContext* renderContext;               //!< global render context
     AudioContext* audioContext;                 //!< global audio context
     EntityManager* entityManager = nullptr;     //!< global entityManager, created when Game::Initialize() were called
+    JobPool* jobPool = nullptr;                 //!< worker threads for parallel-safe scripts, created when Game::Initialize() were called
+    AssetLoader* assetLoader = nullptr;         //!< background texture and audio loading, created when Game::Initialize() were called
 
     PhysicsAPI physics;
     HierarchyAPI entityHierarchy;
+    Input input;                                //!< input snapshot of the current frame and action mapping
+    TimerWheel timers;                          //!< delayed and repeating callbacks, fired after the Update cascade
+    AssetCache assets;                          //!< shared textures and audio clips, loaded once per path
 
+    std::shared_ptr<ISystem> renderingSystem = nullptr; //!< rendering system
     std::shared_ptr<ISystem> hierarchySystem = nullptr; //!< hierarchy system
     std::shared_ptr<ISystem> physicsSystem = nullptr;
     std::shared_ptr<ISystem> scriptSystem = nullptr;    //!< script system
@@ -49,7 +199,9 @@ public:
     double lastTicksU__ns = 0;                  //!< used to keep tracks of game Update ticks
     double lastTicksFU__ns = 0;                 //!< used to keep tracks of game FixedUpdate ticks
     double lastTicksLU__ns = 0;                 //!< used to keep tracks of game LateUpdate ticks
-    bool isRunning = false;                     //!< Reflecting the status of whether the game is currently running or not
+    std::atomic<bool> isRunning{ false };       //!< Reflecting the status of whether the game is currently running or not
+    double fixedUpdateAlpha = 1.0;              //!< progress towards the next FixedUpdate step (0.0 to 1.0), used for render interpolation
+    FrameStats frameStats;                      //!< per-phase timings of the last Game::Itterate() call
     
     /**
      * Game constructor, usage:
@@ -92,6 +244,28 @@ public:
      */
     Result<VoidResult, GameError> Initialize();
 
+    /**
+     * Add a user system to `ecs_systems`, after Game::Initialize(), e.g. in
+     * InitializeGame(). `phases` are the SystemPhase flags of the phases it
+     * runs in, and systems run in ascending `priority` (engine systems have
+     * priority 0) within each phase.
+     *
+     * The system joins `ecs_systems` at the start of the next frame, so it
+     * is safe to call from a system's callbacks. It then receives
+     * OnComponentRegistered() for the components registered so far, then
+     * Initialize(). Usage:
+     * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+     * game->RegisterSystem(std::make_shared<MovementSystem>(), SYSTEM_PHASE_UPDATE, -10);
+     * ~~~~~~~~~~~~~~~~~~~~
+     * In a system, EntityManager::query() gives typed access to the entities
+     * having a set of components.
+     */
+    Result<VoidResult, GameError> RegisterSystem(
+            std::shared_ptr<ISystem> system,
+            unsigned int phases,
+            int priority = 0
+            );
+
     /**
      * Called by SDL_AppIterate callback
      * This function will call Init, Update, LateUpdate, FixedUpdate, PreDraw,
@@ -99,6 +273,64 @@ public:
      */
     Result<VoidResult, GameError> Itterate();
 
+    /**
+     * Handle `events`, run the simulation cascades and PreDraw, then record
+     * the frame into `snapshot`. Called by FramePipeline on the simulation
+     * thread in pipelined mode.
+     */
+    Result<VoidResult, GameError> SimulateFrame(
+            std::vector<SDL_Event>& events,
+            RenderSnapshot* snapshot,
+            FrameStats* stats
+            );
+
+    /**
+     * Advance the external clock by `delta_time_s` and then call
+     * Game::Itterate(). Used to drive a headless game as fast as the CPU
+     * allows, usage:
+     * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+     * while (game->isRunning) {
+     *     auto res = game->Step(1.0/60.0);
+     *     if ( !res.isOk() )
+     *         break;
+     * }
+     * ~~~~~~~~~~~~~~~~~~~~
+     */
+    Result<VoidResult, GameError> Step(double delta_time_s);
+
+    /**
+     * Use external clock instead of SDL_GetTicksNS() as game time source.
+     * This is enabled by default in headless mode.
+     */
+    void SetExternalClock(bool enabled) { m_use_external_clock = enabled; };
+
+    /**
+     * Move the external clock forward by `delta_time_s` seconds.
+     */
+    void AdvanceClock(double delta_time_s) { m_external_clock_ns += delta_time_s*1000000000.0; };
+
+    /**
+     * Current game time in nanoseconds, either from the external clock or from
+     * SDL_GetTicksNS().
+     */
+    double GetTicksNS();
+
+    /**
+     * Returns `true` if the game runs without window, renderer and audio device.
+     */
+    bool IsHeadless() { return gameConfig.headless; };
+
+    /**
+     * Returns `true` if the game replays a replay file, see GameConfig::replay_path.
+     */
+    bool IsReplaying() { return m_replay_player != nullptr; };
+
+    /**
+     * Keep the command line arguments, applied to the GameConfig by
+     * Game::Initialize(). Called by SDL_AppInit.
+     */
+    static void SetCommandLineArguments(int argc, char* argv[]);
+
     /**
      * Callback called when a new Component type is registered to ComponentManager
      *
@@ -113,6 +345,13 @@ public:
      */
     void OnComponentAddedToEntity(ComponentDataPayload component_payload, EntityID entity_id);
 
+    /**
+     * Callback called before a Component is removed from an entity
+     *
+     * Read more on: `EntityManager::setComponentRemovedFromEntityCallback`
+     */
+    void OnComponentRemovedFromEntity(ComponentDataPayload component_payload, EntityID entity_id);
+
     /**
      * Callback called when an entity will be destroyed.
      *
@@ -121,6 +360,10 @@ public:
 
     /**
      * Called by SDL_AppEvent callback to pass down event to all registered systems.
+     * In pipelined mode the event is queued and handled on the simulation
+     * thread at the start of the next frame.
+     *
+     * Mouse coordinates of `event` are converted to render coordinates.
      */
     Result<VoidResult, GameError> OnEvent(SDL_Event *event);
 
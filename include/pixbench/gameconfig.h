@@ -3,6 +3,7 @@
 
 #include "pixbench/utils/utils.h"
 #include <SDL3/SDL_render.h>
+#include <cstdint>
 #include <string>
 
 
@@ -13,6 +14,44 @@ public:
 
     bool enable_joystick_and_gamepad = true;
 
+    bool headless = false;  //!< no window, renderer or audio device, time is driven with Game::Step()
+
+    int fixed_update_max_steps = 5;         //!< maximum FixedUpdate steps per frame, the rest of the lag is dropped
+    bool render_interpolation_enabled = true;   //!< render Transform interpolated between the last two FixedUpdate steps
+
+    /* Simulate frame N+1 on a worker thread while the main thread submits
+     * frame N. Systems, scripts and events then run off the main thread, so
+     * they must not call SDL render functions (e.g. create textures), and
+     * CustomRenderable must implement DrawToSnapshot(). Textures they release
+     * are destroyed on the main thread after the next present. Ignored in
+     * headless mode.
+     * */
+    bool pipelined_rendering = false;
+
+    int job_pool_threads = -1;              //!< worker threads of Game::jobPool, -1 for one less than the CPU cores
+    int asset_loader_threads = 1;           //!< worker threads of Game::assetLoader reading and decoding files
+    double asset_upload_budget_ms = 2.0;    //!< main thread time per frame spent finishing Game::assetLoader requests
+    /* Asset pack built with the `asset_packer` tool, relative to the
+     * executable base path. Game::assets then reads the files under the base
+     * path from it. Empty reads loose files, e.g. during development.
+     * */
+    std::string asset_pack_path = "";
+    /* GPU memory for the textures of Game::assets. Past it, the textures not
+     * drawn for `texture_evict_after_frames` frames are freed, least recently
+     * drawn first, and loaded again when next drawn. 0 for no budget.
+     * */
+    double texture_budget_mb = 0.0;
+    int texture_evict_after_frames = 300;
+
+    uint32_t random_seed = 0;               //!< seed of GenerateRandomUInt32(), 0 keeps the default seed
+    std::string replay_record_path = "";    //!< record events and frame times to this replay file
+    /* Replay this file instead of handling live input: the game runs headless
+     * with the recorded seed and frame times, as fast as possible, then logs
+     * frame time statistics and quits. Also set with the `--replay <file>`
+     * command line argument (`--record <file>` for recording).
+     * */
+    std::string replay_path = "";
+
     bool render_vsync_enabled = true;
     Color render_clear_color = Color::GetBlack();
 
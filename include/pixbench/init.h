@@ -58,6 +58,11 @@ Game* CreateGame();
  *                 m_game->Quit();
  *         }
  * 
+ *         void SubscribeEvents(EventSubscription *subscription) override {
+ *             subscription->subscribe(SDL_EVENT_QUIT);
+ *             subscription->subscribe(SDL_EVENT_KEY_DOWN);
+ *         }
+ * 
  *         void OnEvent(SDL_Event *event, EntityManager *entityManager, EntityID self) override {
  *             if (event->type == SDL_EVENT_QUIT) {
  *                 quitTheGame();
@@ -80,6 +85,7 @@ void InitializeGame(Game*);
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>
 #include "pixbench/game.h"
+#include "pixbench/utils/logger.h"
 #include <SDL3/SDL_error.h>
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_init.h>
@@ -106,16 +112,19 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     *appstate = new AppState;
     AppState& state = *static_cast<AppState*>(*appstate);
 
+    // --record <file> / --replay <file>
+    Game::SetCommandLineArguments(argc, argv);
+
     Game* game = CreateGame();
     if ( !game ) {
-        std::cout << "Game::CreateGame return NULL. Quiting now." << std::endl;
+        PIXBENCH_LOG_ERROR("Game::CreateGame return NULL. Quiting now.");
         return SDL_APP_FAILURE;
     }
 
     state.game = game;
     InitializeGame(game);
 
-    std::cout << "App initialization completed" << std::endl;
+    PIXBENCH_LOG_INFO("App initialization completed");
     return SDL_APP_CONTINUE;
 }
 
@@ -169,7 +178,7 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
     /* SDL will clean up the window/renderer, but deleting game will
      * also explicitly free window and renrerer.*/
-    std::cout << "SDL_AppQuit called" << std::endl;
+    PIXBENCH_LOG_DEBUG("SDL_AppQuit called");
     AppState& state = *static_cast<AppState*>(appstate);
 
     if (result == SDL_APP_FAILURE && state.game && state.game->renderContext) {
@@ -184,10 +193,10 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
     if ( state.game )
         state.game->OnExit();
 
-    std::cout << "deleting game" << std::endl;
+    PIXBENCH_LOG_DEBUG("deleting game");
     if ( state.game )
         delete state.game;
-    std::cout << "game deleted" << std::endl;
+    PIXBENCH_LOG_DEBUG("game deleted");
 }
 
 #endif
@@ -0,0 +1,204 @@
+#ifndef INPUT_HEADER
+#define INPUT_HEADER
+
+
+#include "pixbench/renderer.h"
+#include "pixbench/vector2.h"
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_gamepad.h>
+#include <SDL3/SDL_mouse.h>
+#include <SDL3/SDL_scancode.h>
+#include <SDL3/SDL_stdinc.h>
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+#define INPUT_MAX_GAMEPADS 4
+
+
+/**
+ * State of keyboard, mouse and gamepads for one frame.
+ *
+ * Built by Input from the SDL events received before the frame, then left
+ * untouched while the frame is simulated, so it can be read from any thread
+ * during that time. It's a plain value, copy it to keep it (e.g. for
+ * recording and replaying input).
+ *
+ * `*_pressed` and `*_released` are edges: only set on the frame the key or
+ * button went down or up.
+ */
+class InputSnapshot {
+public:
+    Uint64 frame = 0;                   //!< number of frames since the game started
+    bool quit_requested = false;        //!< SDL_EVENT_QUIT received during this frame
+
+    std::bitset<SDL_SCANCODE_COUNT> keys_down;
+    std::bitset<SDL_SCANCODE_COUNT> keys_pressed;
+    std::bitset<SDL_SCANCODE_COUNT> keys_released;
+
+    Uint32 mouse_buttons_down = 0;      //!< SDL_BUTTON_MASK() bits
+    Uint32 mouse_buttons_pressed = 0;
+    Uint32 mouse_buttons_released = 0;
+    Vector2 mouse_screen_position;      //!< in render (screen) coordinates
+    Vector2 mouse_position;             //!< in scene space, see screenToSceneSpace()
+    Vector2 mouse_motion;               //!< screen space motion during this frame
+    Vector2 mouse_wheel;                //!< wheel scroll during this frame
+
+    SDL_JoystickID gamepad_ids[INPUT_MAX_GAMEPADS] = { 0 };     //!< 0 for an empty slot
+    std::bitset<SDL_GAMEPAD_BUTTON_COUNT> gamepad_buttons_down[INPUT_MAX_GAMEPADS];
+    std::bitset<SDL_GAMEPAD_BUTTON_COUNT> gamepad_buttons_pressed[INPUT_MAX_GAMEPADS];
+    std::bitset<SDL_GAMEPAD_BUTTON_COUNT> gamepad_buttons_released[INPUT_MAX_GAMEPADS];
+    float gamepad_axes[INPUT_MAX_GAMEPADS][SDL_GAMEPAD_AXIS_COUNT] = {};            //!< normalized to [-1.0, 1.0]
+    float gamepad_axes_previous[INPUT_MAX_GAMEPADS][SDL_GAMEPAD_AXIS_COUNT] = {};   //!< axes of the previous frame
+
+    bool isKeyDown(SDL_Scancode scancode) const { return keys_down[scancode]; };
+    bool isKeyPressed(SDL_Scancode scancode) const { return keys_pressed[scancode]; };
+    bool isKeyReleased(SDL_Scancode scancode) const { return keys_released[scancode]; };
+
+    /**
+     * `button` is one of SDL_BUTTON_LEFT, SDL_BUTTON_MIDDLE, ...
+     */
+    bool isMouseButtonDown(Uint8 button) const { return mouse_buttons_down & SDL_BUTTON_MASK(button); };
+    bool isMouseButtonPressed(Uint8 button) const { return mouse_buttons_pressed & SDL_BUTTON_MASK(button); };
+    bool isMouseButtonReleased(Uint8 button) const { return mouse_buttons_released & SDL_BUTTON_MASK(button); };
+
+    /**
+     * `slot` is the gamepad number in connection order, from 0 to
+     * INPUT_MAX_GAMEPADS - 1.
+     */
+    bool isGamepadButtonDown(size_t slot, SDL_GamepadButton button) const { return gamepad_buttons_down[slot][button]; };
+    bool isGamepadButtonPressed(size_t slot, SDL_GamepadButton button) const { return gamepad_buttons_pressed[slot][button]; };
+    bool isGamepadButtonReleased(size_t slot, SDL_GamepadButton button) const { return gamepad_buttons_released[slot][button]; };
+    float gamepadAxis(size_t slot, SDL_GamepadAxis axis) const { return gamepad_axes[slot][axis]; };
+    bool isGamepadConnected(size_t slot) const { return gamepad_ids[slot] != 0; };
+
+    /**
+     * Clear the edges (pressed/released), mouse motion and wheel.
+     */
+    void clearEdges();
+};
+
+
+enum InputBindingTag {
+    IBIND_Key,
+    IBIND_MouseButton,
+    IBIND_GamepadButton,
+    IBIND_GamepadAxisPositive,
+    IBIND_GamepadAxisNegative,
+};
+
+
+struct InputBinding {
+    InputBindingTag tag;
+    int code;                   //!< scancode, mouse button, gamepad button or gamepad axis
+    float deadzone = 0.0f;      //!< axis bindings only
+};
+
+
+typedef size_t InputActionID;
+
+
+/**
+ * Named actions ("jump", "move_left", ...) bound to keys, mouse buttons and
+ * gamepad buttons/axes of any connected gamepad.
+ *
+ * Look the InputActionID up once with InputActionMap::addAction() or
+ * InputActionMap::getActionID(), queries with the ID are O(bindings).
+ */
+class InputActionMap {
+private:
+    std::vector<std::string> m_names;
+    std::vector<std::vector<InputBinding>> m_bindings;      //!< indexed by InputActionID
+    std::unordered_map<std::string, InputActionID> m_ids;
+
+    float bindingValue(const InputBinding& binding, const InputSnapshot& snapshot, bool previous) const;
+public:
+    /**
+     * Create the action `name`, or return its ID if it already exists.
+     */
+    InputActionID addAction(const std::string& name);
+
+    /**
+     * Return `false` if there's no action named `name`.
+     */
+    bool getActionID(const std::string& name, InputActionID* out__action) const;
+
+    const std::string& getActionName(InputActionID action) const { return m_names[action]; };
+    size_t getActionCount() const { return m_names.size(); };
+
+    void bindKey(InputActionID action, SDL_Scancode scancode);
+    void bindMouseButton(InputActionID action, Uint8 button);
+    void bindGamepadButton(InputActionID action, SDL_GamepadButton button);
+
+    /**
+     * Bind one direction of a gamepad axis, the action is down when the axis
+     * goes past `deadzone` in that direction.
+     */
+    void bindGamepadAxis(InputActionID action, SDL_GamepadAxis axis, bool positive, float deadzone = 0.25f);
+
+    void clearBindings(InputActionID action);
+
+    /**
+     * Strongest binding of `action`, from 0.0 to 1.0. Digital bindings are
+     * either 0.0 or 1.0, axes are rescaled past their deadzone.
+     */
+    float getActionValue(InputActionID action, const InputSnapshot& snapshot) const;
+
+    bool isActionDown(InputActionID action, const InputSnapshot& snapshot) const;
+
+    /**
+     * `true` on the frame `action` went from up to down.
+     */
+    bool isActionPressed(InputActionID action, const InputSnapshot& snapshot) const;
+
+    /**
+     * `true` on the frame `action` went from down to up.
+     */
+    bool isActionReleased(InputActionID action, const InputSnapshot& snapshot) const;
+
+    /**
+     * Value of `positive` minus value of `negative`, from -1.0 to 1.0.
+     */
+    float getAxis(InputActionID negative, InputActionID positive, const InputSnapshot& snapshot) const;
+};
+
+
+/**
+ * Input service of the Game, reachable from scripts with `game->input`.
+ *
+ * Game feeds it every SDL event and publishes a new InputSnapshot at the
+ * start of each simulated frame, before the systems Update.
+ */
+class Input {
+private:
+    InputSnapshot m_snapshot;           //!< published state of the current frame
+    InputSnapshot m_next;               //!< state being built from the events of the next frame
+
+    int gamepadSlot(SDL_JoystickID gamepad_id, bool assign);
+public:
+    InputActionMap actions;
+
+    const InputSnapshot& snapshot() const { return m_snapshot; };
+
+    bool isActionDown(InputActionID action) const { return actions.isActionDown(action, m_snapshot); };
+    bool isActionPressed(InputActionID action) const { return actions.isActionPressed(action, m_snapshot); };
+    bool isActionReleased(InputActionID action) const { return actions.isActionReleased(action, m_snapshot); };
+    float getActionValue(InputActionID action) const { return actions.getActionValue(action, m_snapshot); };
+    float getAxis(InputActionID negative, InputActionID positive) const { return actions.getAxis(negative, positive, m_snapshot); };
+
+    /**
+     * Update the next snapshot with `event`, called by Game for every event.
+     */
+    void __handleEvent(const SDL_Event* event);
+
+    /**
+     * Publish the next snapshot, called by Game at the start of each frame.
+     */
+    void __beginFrame(RenderContext* renderContext);
+};
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef JOB_POOL_HEADER
+#define JOB_POOL_HEADER
+
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Fixed set of worker threads running the jobs of JobPool::parallelFor().
+ *
+ * Created by Game::Initialize() (see GameConfig::job_pool_threads), used by
+ * ScriptSystem to update parallel-safe scripts.
+ */
+class JobPool {
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    bool m_stop_requested = false;
+
+    const std::function<void(size_t)>* m_job = nullptr;
+    size_t m_job_count = 0;
+    std::atomic<size_t> m_next_job{ 0 };
+    uint64_t m_generation = 0;          //!< incremented by each JobPool::parallelFor() call
+    size_t m_busy_workers = 0;
+
+    void run();
+    void runJobs(const std::function<void(size_t)>& job, size_t job_count);
+public:
+    /**
+     * Start `worker_count` threads, 0 runs every job on the calling thread.
+     */
+    JobPool(size_t worker_count);
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    /**
+     * Number of threads running jobs, the workers and the caller.
+     */
+    size_t getThreadCount() const { return m_workers.size() + 1; };
+
+    /**
+     * Call `job(i)` for every `i` in [0, job_count), spread over the workers
+     * and the calling thread, and return when all calls returned. Jobs must
+     * not call JobPool::parallelFor(), and only one thread may call it at a
+     * time.
+     */
+    void parallelFor(size_t job_count, const std::function<void(size_t)>& job);
+};
+
+
+#endif
@@ -12,6 +12,7 @@
 
 // ========== FORWARD DECLARATION ========== BEGIN
 class Game;
+class RenderSnapshot;
 // ========== FORWARD DECLARATION ========== END
 
 
@@ -121,4 +122,14 @@ void phydebDrawCross(
         float cross_width = 12.0
         );
 
+/**
+ * Record a cross into `snapshot`.
+ * Use RenderSnapshot::setDrawColorFloat before calling this function to set color.
+ */
+void phydebDrawCross(
+        RenderSnapshot* snapshot,
+        Vector2* center,
+        float cross_width = 12.0
+        );
+
 #endif
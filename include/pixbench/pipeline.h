@@ -0,0 +1,91 @@
+#ifndef PIPELINE_HEADER
+#define PIPELINE_HEADER
+
+
+#include "pixbench/game.h"
+#include "pixbench/render_snapshot.h"
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_events.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Runs the simulation of frame N+1 (events, Update, FixedUpdate, LateUpdate,
+ * PreDraw and RecordDraw) on a worker thread while the main thread submits
+ * frame N with SDL.
+ *
+ * The two RenderSnapshot buffers are swapped in FramePipeline::requestFrame():
+ * the front one is only read by the main thread, the back one is only
+ * written by the worker.
+ *
+ * Created by Game::Initialize() when GameConfig::pipelined_rendering is set.
+ */
+class FramePipeline {
+private:
+    Game* m_game;
+    RenderSnapshot m_snapshots[2];
+    int m_front_index = 0;                  //!< snapshot submitted by the main thread
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_frame_requested = false;
+    bool m_frame_running = false;
+    bool m_stop_requested = false;
+    Result<VoidResult, GameError> m_frame_result;
+    FrameStats m_frame_stats;               //!< stats of the last simulated frame
+
+    std::mutex m_event_mutex;
+    std::vector<SDL_Event> m_pending_events;    //!< events received while the worker was busy
+    std::vector<SDL_Event> m_processing_events; //!< events of the frame being simulated
+
+    void run();
+public:
+    FramePipeline(Game* game);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    /**
+     * Start the simulation thread.
+     */
+    void start();
+
+    /**
+     * Wait for the running frame and stop the simulation thread.
+     */
+    void stop();
+
+    /**
+     * Copy `event` to be handled at the start of the next simulated frame.
+     */
+    void queueEvent(const SDL_Event* event);
+
+    /**
+     * Block until the requested frame is simulated and return its result.
+     */
+    Result<VoidResult, GameError> waitForFrame();
+
+    /**
+     * Swap snapshot buffers and start simulating the next frame. Call only
+     * after FramePipeline::waitForFrame().
+     */
+    void requestFrame();
+
+    /**
+     * Snapshot of the last simulated frame, to be submitted by the main thread.
+     */
+    RenderSnapshot* frontSnapshot() { return &m_snapshots[m_front_index]; };
+
+    /**
+     * Stats of the last simulated frame, valid after FramePipeline::waitForFrame().
+     */
+    const FrameStats& frameStats() const { return m_frame_stats; };
+};
+
+
+#endif
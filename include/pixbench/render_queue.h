@@ -0,0 +1,95 @@
+#ifndef RENDER_QUEUE_HEADER
+#define RENDER_QUEUE_HEADER
+
+
+#include "pixbench/engine_config.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * Number of bits needed to store `max_value`.
+ */
+constexpr int __bitWidth(uint64_t max_value) {
+    return max_value == 0 ? 0 : 1 + __bitWidth(max_value >> 1);
+}
+
+
+// Sort key layout, from the most significant bits:
+// depth (32) | texture ID | entity ID | component index
+const int RENDER_KEY_CINDEX_BITS = __bitWidth(MAX_COMPONENTS - 1);
+const int RENDER_KEY_ENTITY_BITS = __bitWidth(MAX_ENTITIES - 1);
+const int RENDER_KEY_TEXTURE_BITS = 32 - RENDER_KEY_ENTITY_BITS - RENDER_KEY_CINDEX_BITS;
+static_assert(RENDER_KEY_TEXTURE_BITS >= 8, "MAX_ENTITIES and MAX_COMPONENTS leave too few sort key bits for texture IDs");
+
+
+struct RenderQueueEntry {
+    uint64_t key;
+    uint32_t item;      //!< caller's ID of the drawn thing
+};
+
+
+/**
+ * Draws ordered by packed 64-bit sort keys, see RenderQueue::makeSortKey().
+ *
+ * Keys are unique when built from an entity and component index, so the
+ * order is total and stable from a frame to the next. Within a depth, draws
+ * sharing a texture end up next to each other, which lets RenderSnapshot
+ * batch them.
+ *
+ * RenderQueue::sort() starts from the previous frame's order of the items
+ * still queued, which is usually already sorted or nearly so. Only the new
+ * items and the ones breaking that order are sorted, then merged back. When
+ * too much changed, it falls back to an LSD radix sort on the keys.
+ */
+class RenderQueue {
+private:
+    std::vector<RenderQueueEntry> m_entries;
+    std::vector<RenderQueueEntry> m_scratch;
+    std::vector<RenderQueueEntry> m_new_entries;      //!< new or moved items
+    //!< position of each item in the last sorted queue, valid if its m_item_sort_ids is m_sort_id
+    std::vector<uint32_t> m_item_ranks;
+    std::vector<uint32_t> m_item_sort_ids;
+    uint32_t m_sort_id = 0;
+    size_t m_last_count = 0;
+
+    /**
+     * Reorder `m_entries` as the previous frame had them, new items last.
+     */
+    void restorePreviousOrder();
+
+    /**
+     * Move the entries breaking the order of `m_entries` to `m_new_entries`,
+     * leaving a sorted `m_entries`.
+     */
+    void extractOutOfOrder();
+
+    void radixSort();
+
+    void storeRanks();
+public:
+    /**
+     * Ascending `depth` first, then `texture_id` (0 for none), then entity
+     * and component index.
+     */
+    static uint64_t makeSortKey(float depth, uint32_t texture_id, uint64_t entity_id, size_t cindex);
+
+    void clear() { m_entries.clear(); };
+
+    /**
+     * Queue `item` (below UINT32_MAX), sorted by `key` on RenderQueue::sort().
+     */
+    void push(uint64_t key, uint32_t item) {
+        m_entries.push_back({ key, item });
+    };
+
+    void sort();
+
+    size_t size() const { return m_entries.size(); };
+
+    const std::vector<RenderQueueEntry>& entries() const { return m_entries; };
+};
+
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef RENDER_SNAPSHOT_HEADER
+#define RENDER_SNAPSHOT_HEADER
+
+
+#include "pixbench/renderer.h"
+#include "pixbench/resource.h"
+#include "pixbench/utils/results.h"
+#include "pixbench/utils/utils.h"
+#include "pixbench/vector2.h"
+#include <SDL3/SDL_rect.h>
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_surface.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class AssetCache;
+class CustomRenderable;
+class EntityManager;
+
+
+enum RenderCommandTag {
+    RCMD_Geometry,              //!< textured quads sharing a texture, drawn with one SDL_RenderGeometry()
+    RCMD_DrawColor,
+    RCMD_Point,
+    RCMD_Line,
+    RCMD_Lines,
+    RCMD_Rect,
+    RCMD_DebugText,
+    RCMD_CustomRenderable,      //!< calls CustomRenderable::Draw() at submit time
+};
+
+
+struct RenderCommand {
+    RenderCommandTag tag;
+    Res_SDL_Texture* texture = nullptr;     //!< kept alive by the snapshot, its SDL_Texture is looked up at submit time
+    SDL_FRect drect;            //!< the points/color of primitive commands
+    size_t data_offset = 0;     //!< first vertex in RenderSnapshot::vertices, first point in RenderSnapshot::points, or first char in RenderSnapshot::text
+    size_t data_count = 0;
+    CustomRenderable* custom_renderable = nullptr;
+};
+
+
+/**
+ * Immutable (once recorded) list of draw commands for one frame, in screen
+ * space, together with the camera and clear color it was recorded with.
+ *
+ * Systems record into a snapshot with ISystem::RecordDraw(), and
+ * RenderSnapshot::submit() replays it with SDL on the main thread. In
+ * pipelined mode the simulation thread records frame N+1 while the main
+ * thread submits frame N.
+ *
+ * The recording functions mirror the SDL_Render* functions they replace.
+ * Textured quads are turned into vertices when recorded, and consecutive
+ * ones sharing a texture (and so a blend mode) are submitted as a single
+ * SDL_RenderGeometry() call.
+ */
+class RenderSnapshot {
+private:
+    //!< keep textures alive until the snapshot is submitted
+    std::vector<std::shared_ptr<Res_SDL_Texture>> m_retained_textures;
+    //!< 0, 1, 2, 2, 3, 0 for each quad, shared by every RCMD_Geometry batch
+    std::vector<int> m_quad_indices;
+
+    void retainTexture(const std::shared_ptr<Res_SDL_Texture>& texture);
+
+    /**
+     * Append the 4 vertices of `texture`'s `srect` drawn to `drect`, rotated
+     * by `angle` degrees clockwise around its center and flipped, to the
+     * last RCMD_Geometry batch if it uses the same texture.
+     */
+    void appendQuad(
+            const std::shared_ptr<Res_SDL_Texture>& texture,
+            const SDL_FRect* srect, const SDL_FRect* drect,
+            double angle, SDL_FlipMode flip_mode
+            );
+
+    /**
+     * Extend the last RCMD_Geometry batch by the last `vertex_count`
+     * vertices if it uses `texture`, otherwise start a new batch.
+     */
+    void appendToGeometryBatch(
+            const std::shared_ptr<Res_SDL_Texture>& texture,
+            size_t vertex_count
+            );
+public:
+    std::vector<RenderCommand> commands;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<SDL_FPoint> points;
+    std::string text;
+
+    Vector2 camera_position;
+    Vector2 camera_size;
+    Vector2 screen_size;
+    Color clear_color;
+
+    /**
+     * Drop all commands, capacity is kept for the next frame.
+     */
+    void clear();
+
+    /**
+     * Copy camera, screen and clear color from `renderContext`.
+     */
+    void captureContext(RenderContext* renderContext);
+
+    void renderTexture(
+            const std::shared_ptr<Res_SDL_Texture>& texture,
+            const SDL_FRect* srect, const SDL_FRect* drect
+            );
+    void renderTextureRotated(
+            const std::shared_ptr<Res_SDL_Texture>& texture,
+            const SDL_FRect* srect, const SDL_FRect* drect,
+            double angle, SDL_FlipMode flip_mode
+            );
+
+    /**
+     * Append `count` prebuilt vertices of `texture`, 4 per quad in the order
+     * of RenderSnapshot::vertices, with their positions scaled by `scale`
+     * and then moved by `offset`. Used for cached geometry such as
+     * TileMapLayer chunks.
+     */
+    void renderQuads(
+            const std::shared_ptr<Res_SDL_Texture>& texture,
+            const SDL_Vertex* quad_vertices, size_t count,
+            Vector2 offset, Vector2 scale
+            );
+
+    void setDrawColorFloat(float r, float g, float b, float a);
+    void renderPoint(float x, float y);
+    void renderLine(float x1, float y1, float x2, float y2);
+    void renderLines(const SDL_FPoint* line_points, int count);
+    void renderRect(const SDL_FRect* rect);
+    void renderDebugText(float x, float y, const char* str);
+
+    /**
+     * Call `custom_renderable->Draw()` when the snapshot is submitted, only
+     * allowed when recording and submitting happen on the same thread.
+     */
+    void drawCustomRenderable(CustomRenderable* custom_renderable);
+
+    /**
+     * Replay the commands on `renderContext->renderer`. Must be called on the
+     * main thread. The textures drawn are marked as used in `assets` if
+     * given, which loads them again first if it evicted them.
+     */
+    Result<VoidResult, GameError> submit(
+            RenderContext* renderContext,
+            EntityManager* entity_mgr,
+            AssetCache* assets = nullptr
+            );
+};
+
+
+#endif
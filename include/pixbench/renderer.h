@@ -1,11 +1,14 @@
 #ifndef RENDERER_HEADER
 #define RENDERER_HEADER
 
+#include "pixbench/engine_config.h"
 #include "pixbench/resource.h"
+#include "pixbench/utils/logger.h"
 #include "pixbench/utils/utils.h"
 #include "pixbench/vector2.h"
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_render.h>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <memory>
@@ -22,6 +25,7 @@ public:
     Vector2 screen_size;        //!< screen size in pixels
     Color renderClearColor;     //!< Color of clear window
     SDL_RendererLogicalPresentation _logical_presentation;
+    double interpolation_alpha = 1.0;   //!< blend factor between the last two FixedUpdate steps, set by Game every frame
 
     RenderContext(
             std::string game_title,
@@ -51,8 +55,35 @@ public:
         this->SetCameraContext(camera_position, camera_size);
     }
 
+    /**
+     * Null render context for headless mode. No window nor renderer will be
+     * created, but camera and screen space conversions still works.
+     */
+    RenderContext(
+            Vector2 screen_size,
+            Vector2 camera_position, Vector2 camera_size
+            )
+    :
+        renderer(nullptr),
+        window(nullptr),
+        renderClearColor(Color::GetBlack()),
+        _logical_presentation(SDL_LOGICAL_PRESENTATION_DISABLED)
+    {
+        this->SetScreenSize(screen_size);
+        this->SetCameraContext(camera_position, camera_size);
+    }
+
+    /**
+     * Returns `true` if this is a null render context (headless mode)
+     */
+    bool isHeadless() const {
+        return this->renderer == nullptr;
+    }
+
     void setRenderLogicalPresentation(SDL_RendererLogicalPresentation render_logical_presentation) {
         this->_logical_presentation = render_logical_presentation;
+        if ( !this->renderer )
+            return;
         SDL_SetRenderLogicalPresentation(
                 this->renderer,
                 this->screen_size.x, this->screen_size.y,
@@ -61,8 +92,10 @@ public:
     }
 
     ~RenderContext() {
-        SDL_DestroyRenderer(this->renderer);
-        SDL_DestroyWindow(this->window);
+        if (this->renderer)
+            SDL_DestroyRenderer(this->renderer);
+        if (this->window)
+            SDL_DestroyWindow(this->window);
     }
 
     void SetScreenSize(Vector2 screen_size) {
@@ -71,7 +104,7 @@ public:
     }
 
     void SetCameraContext(Vector2 camera_position, Vector2 camera_size) {
-        std::cout << "SetCameraContext called." << std::endl;
+        PIXBENCH_LOG_TRACE("SetCameraContext called");
         this->camera_position = camera_position;
         this->camera_size = camera_size;
     }
@@ -108,6 +141,15 @@ Vector2 sceneToScreenSpace(
         );
 
 
+/**
+ * Inverse of sceneToScreenSpace(), e.g. for the mouse position.
+ */
+Vector2 screenToSceneSpace(
+        RenderContext* renderContext,
+        Vector2 point
+        );
+
+
 /* Sprite Sheet */
 class SpriteSheet {
     float start_x, start_y;
@@ -115,12 +157,18 @@ class SpriteSheet {
     float pad_x, pad_y;
     int horizontal_count = 0;
     int vertical_count = 0;
+    SDL_FRect m_region;         //!< part of `res_texture` holding the sheet
+    std::vector<SDL_FRect> m_frames;    //!< in `res_texture` pixels
 public:
     int sheet_count;
     std::shared_ptr<Res_SDL_Texture> res_texture;
 
+    /**
+     * `sheet` is either a whole texture or a TextureRegion, e.g. from a
+     * TextureAtlas; `start_x` and `start_y` are relative to it.
+     */
     SpriteSheet(
-            std::shared_ptr<Res_SDL_Texture> res_texture,
+            TextureRegion sheet,
             float start_x, float start_y,
             float sprite_size_x, float sprite_size_y,
             float pad_x, float pad_y
@@ -132,21 +180,22 @@ public:
         this->pad_x = pad_x;
         this->pad_y = pad_y;
 
-        this->res_texture = res_texture;
+        this->res_texture = sheet.texture;
+        this->m_region = sheet.rect;
 
         /*Check size*/
-        if ((int)(start_x + sprite_size_x) < res_texture->texture->w) {
+        if ((int)(start_x + sprite_size_x) < m_region.w) {
             /*ATLASS SIZE ERROR*/
         }
-        if ((int)(start_y + sprite_size_y) < res_texture->texture->h) {
+        if ((int)(start_y + sprite_size_y) < m_region.h) {
             /*ATLASS SIZE ERROR*/
         }
 
         /* Calculate sheet_size */
         this->horizontal_count = 0;
         this->vertical_count = 0;
-        int hor_residual = res_texture->texture->w - start_x;
-        int ver_residual = res_texture->texture->h - start_y;
+        int hor_residual = m_region.w - start_x;
+        int ver_residual = m_region.h - start_y;
 
         while (hor_residual > 0) {
             ++(this->horizontal_count);
@@ -157,27 +206,61 @@ public:
             ver_residual -= (sprite_size_y + pad_y);
         }
         this->sheet_count = this->horizontal_count*this->vertical_count;
+
+        // computed once, frames are looked up every animation step
+        m_frames.reserve(this->sheet_count);
+        for (int y_i=0; y_i<this->vertical_count; ++y_i) {
+            for (int x_i=0; x_i<this->horizontal_count; ++x_i) {
+                SDL_FRect srect;
+                srect.x = m_region.x + this->start_x + (float)x_i * (this->sprite_size_x + this->pad_x);
+                srect.y = m_region.y + this->start_y + (float)y_i * (this->sprite_size_y + this->pad_y);
+                srect.w = sprite_size_x;
+                srect.h = sprite_size_y;
+                m_frames.push_back(srect);
+            }
+        }
+    }
+
+    /**
+     * Sheet of precomputed `frames`, relative to `sheet`, e.g. the frames of
+     * a cooked texture:
+     * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+     * SpriteSheet(texture, texture->frames)
+     * ~~~~~~~~~~~~~~~~~~~~
+     */
+    SpriteSheet(TextureRegion sheet, const std::vector<SDL_FRect>& frames) {
+        this->start_x = 0.0f;
+        this->start_y = 0.0f;
+        this->sprite_size_x = frames.empty() ? 0.0f : frames[0].w;
+        this->sprite_size_y = frames.empty() ? 0.0f : frames[0].h;
+        this->pad_x = 0.0f;
+        this->pad_y = 0.0f;
+
+        this->res_texture = sheet.texture;
+        this->m_region = sheet.rect;
+
+        // a single row
+        this->horizontal_count = (int)frames.size();
+        this->vertical_count = frames.empty() ? 0 : 1;
+        this->sheet_count = (int)frames.size();
+
+        m_frames.reserve(frames.size());
+        for (const SDL_FRect& frame : frames)
+            m_frames.push_back({ m_region.x + frame.x, m_region.y + frame.y, frame.w, frame.h });
     }
 
     SDL_FRect GetRectByFrameIndex(int frame_index) {
         if (this->sheet_count == 0) {
             // This situations should never hapens, errors should be thrown at
             // the time of the constructor being called.
-            std::cout << "[][][]GetRectByFrameIndex <<sheet_count = 0>> [][][]" << std::endl;
+            PIXBENCH_LOG_WARNING("SpriteSheet::GetRectByFrameIndex called on a sheet without frames");
             return SDL_FRect {.x = 0, .y = 0, .w = 0, .h = 0};
         }
 
         frame_index %= this->sheet_count;
-
-        int x_i = frame_index % this->horizontal_count;
-        int y_i = std::floor(frame_index / this->horizontal_count);
-
-        SDL_FRect srect;
-        srect.x = this->start_x + (float)x_i * (this->sprite_size_x + this->pad_x);
-        srect.y = this->start_y + (float)y_i * (this->sprite_size_y + this->pad_y);
-        srect.w = sprite_size_x;
-        srect.h = sprite_size_y;
-        return srect;
+        if (frame_index < 0)
+            frame_index += this->sheet_count;
+        return m_frames[frame_index];
     };
 
     int getRows() {
@@ -230,8 +313,12 @@ public:
     int rows, columns, tile_counts;                 // number of tiles
     int tile_w, tile_h;                             // tile size
 
+    /**
+     * `tile_texture` is either a whole texture or a TextureRegion, e.g. from
+     * a TextureAtlas.
+     */
     TileSet(
-            std::shared_ptr<Res_SDL_Texture> tile_texture,
+            TextureRegion tile_texture,
             int tile_w, int tile_h,
             int margin_x = 0, int margin_y = 0
            )
@@ -333,40 +420,183 @@ public:
 };
 
 
+/**
+ * Static tiles of a TILEMAP_CHUNK_SIZE x TILEMAP_CHUNK_SIZE tiles area of a
+ * TileMapLayer, baked into quads positioned relative to the layer's top left
+ * corner.
+ */
+struct TileMapChunk {
+    std::vector<SDL_Vertex> vertices;   //!< 4 per non-empty tile, see RenderSnapshot::renderQuads()
+    bool is_dirty = true;               //!< tiles changed since the last bake
+};
+
+
+/**
+ * A cell of a TileMapLayer showing an animated tile.
+ */
+struct AnimatedTile {
+    unsigned int index;             //!< cell index, see TileMapLayer::getIndexByTile()
+    TileAnimation* animation;       //!< shared by every cell showing the same animated tile ID
+};
+
+
 /*TileMapLayer*/
 class TileMapLayer {
 private:
     std::shared_ptr<TileSet> m_atlass;
     unsigned int* m_map = nullptr;
     unsigned int* m_anim_map = nullptr;
+    //!< animations by the tile ID standing for them in the map, elements never move
     std::unordered_map<unsigned int, TileAnimation> m_tile_anims;
+    std::vector<TileMapChunk> m_chunks;
+    //!< cells of `m_anim_map` set to an animated tile ID
+    std::vector<AnimatedTile> m_animated_tiles;
+    //!< position of a cell in `m_animated_tiles`
+    std::unordered_map<unsigned int, size_t> m_animated_tile_slots;
+
+    void addAnimatedTile(unsigned int tile_index, TileAnimation* tile_anim) {
+        auto slot_it = m_animated_tile_slots.find(tile_index);
+        if (slot_it != m_animated_tile_slots.end()) {
+            m_animated_tiles[slot_it->second].animation = tile_anim;
+            return;
+        }
+        m_animated_tile_slots[tile_index] = m_animated_tiles.size();
+        m_animated_tiles.push_back({ tile_index, tile_anim });
+    }
+
+    void removeAnimatedTile(unsigned int tile_index) {
+        auto slot_it = m_animated_tile_slots.find(tile_index);
+        if (slot_it == m_animated_tile_slots.end())
+            return;
+
+        // swap with the last one
+        const size_t slot = slot_it->second;
+        m_animated_tile_slots.erase(slot_it);
+        if (slot != m_animated_tiles.size() - 1) {
+            m_animated_tiles[slot] = m_animated_tiles.back();
+            m_animated_tile_slots[m_animated_tiles[slot].index] = slot;
+        }
+        m_animated_tiles.pop_back();
+    }
+
+    /**
+     * Rebuild the quads of the static tiles of chunk (`chunk_r`, `chunk_c`).
+     */
+    void bakeChunk(int chunk_r, int chunk_c) {
+        TileMapChunk& chunk = m_chunks[chunk_c + chunk_r*chunk_columns];
+        chunk.vertices.clear();
+        chunk.is_dirty = false;
+
+        if (!m_atlass)
+            return;
+        auto texture = m_atlass->getTexture();
+        if (!texture || texture->w == 0 || texture->h == 0)
+            return;
+
+        const int start_row = chunk_r * TILEMAP_CHUNK_SIZE;
+        const int start_col = chunk_c * TILEMAP_CHUNK_SIZE;
+        const int end_row = std::min(rows, start_row + TILEMAP_CHUNK_SIZE);
+        const int end_col = std::min(columns, start_col + TILEMAP_CHUNK_SIZE);
+        const SDL_FColor white = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (int r=start_row; r<end_row; ++r) {
+            for (int c=start_col; c<end_col; ++c) {
+                const unsigned int tile_id = getTileIDbyTilePosition(r, c);
+                if (tile_id == 0)
+                    continue;
+
+                const SDL_FRect srect = m_atlass->getRectByIndex(tile_id-1);
+                const float u0 = srect.x / (float)texture->w;
+                const float u1 = (srect.x + srect.w) / (float)texture->w;
+                const float v0 = srect.y / (float)texture->h;
+                const float v1 = (srect.y + srect.h) / (float)texture->h;
+                const float x0 = (float)(c * tile_w);
+                const float y0 = (float)(r * tile_h);
+
+                // clockwise from the top left, as RenderSnapshot does
+                const float corner_x[4] = { x0, x0 + tile_w, x0 + tile_w, x0 };
+                const float corner_y[4] = { y0, y0, y0 + tile_h, y0 + tile_h };
+                const float corner_u[4] = { u0, u1, u1, u0 };
+                const float corner_v[4] = { v0, v0, v1, v1 };
+                for (int i=0; i<4; ++i) {
+                    SDL_Vertex vertex;
+                    vertex.position.x = corner_x[i];
+                    vertex.position.y = corner_y[i];
+                    vertex.color = white;
+                    vertex.tex_coord.x = corner_u[i];
+                    vertex.tex_coord.y = corner_v[i];
+                    chunk.vertices.push_back(vertex);
+                }
+            }
+        }
+    }
 public:
     int rows, columns;              // number of tiles in a row/column
     int width, height;              // width and height of tilemaplayer int pixels
     int tile_w, tile_h;             // tile size (pixels)
     int tile_counts;                // total number of tiles
+    int chunk_rows, chunk_columns;  // number of chunks in a row/column, see TILEMAP_CHUNK_SIZE
 
-    bool addTileAnimation(unsigned int index, TileAnimation tile_anim) {
-        auto exist_it = m_tile_anims.find(index);
+    /**
+     * Register `tile_anim` for the animated tile ID `anim_tile_id`, before
+     * placing it with setTileIDatTilePosition(). Every cell showing that ID
+     * shares the animation and its clock.
+     */
+    bool addTileAnimation(unsigned int anim_tile_id, TileAnimation tile_anim) {
+        auto exist_it = m_tile_anims.find(anim_tile_id);
         if (exist_it != m_tile_anims.end())
             return false;
 
-        m_tile_anims[index] = tile_anim;
+        m_tile_anims[anim_tile_id] = tile_anim;
 
         return true;
     }
 
-    void replaceTileAnimationAtIndex(unsigned int index, TileAnimation tile_anim) {
-        m_tile_anims[index] = tile_anim;
+    void replaceTileAnimationAtIndex(unsigned int anim_tile_id, TileAnimation tile_anim) {
+        m_tile_anims[anim_tile_id] = tile_anim;
     }
 
-    TileAnimation* getTileAnimation(unsigned int index) {
-        auto exist_it = m_tile_anims.find(index);
+    TileAnimation* getTileAnimation(unsigned int anim_tile_id) {
+        auto exist_it = m_tile_anims.find(anim_tile_id);
         if (exist_it == m_tile_anims.end())
             return nullptr;
 
         return &(exist_it->second);
-        // return &m_tile_anims[index];
+    }
+
+    /**
+     * Advance the clock of every animation by `time_ms`.
+     */
+    void advanceAnimations(double time_ms) {
+        for (auto& anim_it : m_tile_anims) {
+            if (anim_it.second.getTotalNumberOfFrames() == 0)
+                continue;
+            anim_it.second.advanceFrameByTime(time_ms);
+        }
+    }
+
+    /**
+     * Cells showing an animated tile, in no particular order.
+     */
+    const std::vector<AnimatedTile>& getAnimatedTiles() {
+        return m_animated_tiles;
+    }
+
+    /**
+     * Rebuild the list of animated cells from the animation map. Needed
+     * after writing through the pointers returned by
+     * getAnimationTilePointerbyIndex() and
+     * getAnimationTilePointerbyTilePosition().
+     */
+    void rebuildAnimatedTiles() {
+        m_animated_tiles.clear();
+        m_animated_tile_slots.clear();
+        for (int i=0; i<tile_counts; ++i) {
+            if (m_anim_map[i] == 0)
+                continue;
+            TileAnimation* tile_anim = getTileAnimation(m_anim_map[i]);
+            if (tile_anim)
+                addAnimatedTile(i, tile_anim);
+        }
     }
 
     TileMapLayer(
@@ -393,6 +623,10 @@ public:
         for (size_t i=0; i<tile_counts; ++i) {
             m_anim_map[i] = 0;
         }
+
+        chunk_rows = (rows + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+        chunk_columns = (columns + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+        m_chunks.resize(chunk_rows * chunk_columns);
     }
 
     ~TileMapLayer() {
@@ -418,21 +652,49 @@ public:
     /**
      * Set the value of tile map at position rows r and columns c to
      * `tile_id`.
-     * If `tile_id` is for animated tile it will set the value of animated map instead.
+     * If `tile_id` is for animated tile (see addTileAnimation()) it will set
+     * the value of animated map instead.
      */
     void setTileIDatTilePosition(int r, int c, unsigned int tile_id) {
         unsigned int tile_index = getIndexByTile(r, c);
-        auto it_exists = m_tile_anims.find(tile_index);
-        if (it_exists != m_tile_anims.end()) {
+        TileAnimation* tile_anim = getTileAnimation(tile_id);
+        if (tile_anim) {
             // write to animation map
             m_anim_map[tile_index] = tile_id;
             m_map[tile_index] = 0;
+            addAnimatedTile(tile_index, tile_anim);
         }
         else {
             // write to non-animation map
             m_anim_map[tile_index] = 0;
             m_map[tile_index] = tile_id;
+            removeAnimatedTile(tile_index);
         }
+        markTileDirty(r, c);
+    }
+
+    /**
+     * Re-bake the chunk of the tile at rows r and columns c before it is
+     * drawn again. Needed after writing through the pointers returned by
+     * getTilePointerbyIndex() and getTilePointerbyTilePosition().
+     */
+    void markTileDirty(int r, int c) {
+        m_chunks[c/TILEMAP_CHUNK_SIZE + (r/TILEMAP_CHUNK_SIZE)*chunk_columns].is_dirty = true;
+    }
+
+    void markAllChunksDirty() {
+        for (auto& chunk : m_chunks)
+            chunk.is_dirty = true;
+    }
+
+    /**
+     * Chunk at chunk row `chunk_r` and chunk column `chunk_c`, baked first
+     * if its tiles changed.
+     */
+    const TileMapChunk* getBakedChunk(int chunk_r, int chunk_c) {
+        if (m_chunks[chunk_c + chunk_r*chunk_columns].is_dirty)
+            bakeChunk(chunk_r, chunk_c);
+        return &m_chunks[chunk_c + chunk_r*chunk_columns];
     }
 
     unsigned int* getTilePointerbyIndex(int index) {
@@ -463,12 +725,14 @@ public:
         for (int i=0; i<tile_counts; ++i) {
             m_map[i] = clear_value;
         }
+        markAllChunksDirty();
     }
 
     void clearAnimationMap(unsigned int clear_value = 0) {
         for (int i=0; i<tile_counts; ++i) {
             m_anim_map[i] = clear_value;
         }
+        rebuildAnimatedTiles();
     }
 
     std::weak_ptr<TileSet> getAtlass() {
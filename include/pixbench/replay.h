@@ -0,0 +1,109 @@
+#ifndef REPLAY_HEADER
+#define REPLAY_HEADER
+
+
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_events.h>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+#define REPLAY_FILE_MAGIC "PXRP"
+#define REPLAY_FILE_VERSION 1
+
+
+/*
+ * Replay file layout (host byte order, not meant to be moved across
+ * architectures):
+ *
+ *     header: char magic[4], uint32 version, uint32 random_seed
+ *     frame:  double delta_time_s, uint32 event_count, events...
+ *     event:  uint16 size, the first `size` bytes of the SDL_Event
+ *
+ * Trailing zero bytes of an event are not stored, the rest of the SDL_Event
+ * is zero filled on replay.
+ */
+
+
+/**
+ * `false` for events that hold pointers (text input, drop), they can't be
+ * replayed from a file and are not recorded.
+ */
+bool isEventReplayable(const SDL_Event* event);
+
+
+/**
+ * Records the SDL events and the delta time of every frame, together with
+ * the random generator seed, into a replay file.
+ *
+ * Created by Game when GameConfig::replay_record_path is set.
+ */
+class ReplayRecorder {
+private:
+    std::ofstream m_file;
+    std::vector<SDL_Event> m_frame_events;  //!< events received since the last frame
+    size_t m_frame_count = 0;
+public:
+    Result<VoidResult, GameError> open(const std::string& path, uint32_t random_seed);
+
+    /**
+     * Record `event` for the next frame.
+     */
+    void recordEvent(const SDL_Event* event);
+
+    /**
+     * Write a frame with the events recorded since the previous one.
+     */
+    Result<VoidResult, GameError> recordFrame(double delta_time_s);
+
+    void close();
+
+    size_t getFrameCount() const { return m_frame_count; };
+};
+
+
+/**
+ * Reads a replay file frame by frame, and collects the frame times of the
+ * replayed frames.
+ *
+ * Created by Game when GameConfig::replay_path is set, the game then runs
+ * headless and each Game::Itterate() replays one frame.
+ */
+class ReplayPlayer {
+private:
+    std::ifstream m_file;
+    std::string m_path;
+    uint32_t m_random_seed = 0;
+    size_t m_frame_count = 0;
+    std::vector<double> m_frame_times_s;
+public:
+    Result<VoidResult, GameError> open(const std::string& path);
+
+    uint32_t getRandomSeed() const { return m_random_seed; };
+
+    /**
+     * Read the next frame into `out__delta_time_s` and `out__events`.
+     * `out__has_frame` is set to `false` at the end of the file.
+     */
+    Result<VoidResult, GameError> readFrame(
+            bool* out__has_frame,
+            double* out__delta_time_s,
+            std::vector<SDL_Event>& out__events
+            );
+
+    size_t getFrameCount() const { return m_frame_count; };
+
+    void addFrameTime(double frame_time_s) { m_frame_times_s.push_back(frame_time_s); };
+
+    /**
+     * One line summary of the frame times: count, mean, p50, p95, p99 and max
+     * in milliseconds.
+     */
+    std::string summarizeFrameTimes() const;
+};
+
+
+#endif
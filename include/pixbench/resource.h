@@ -2,13 +2,38 @@
 #define RESOURCE_HEADER
 
 
+#include "pixbench/cooked_texture.h"
+#include "pixbench/utils/logger.h"
 #include <SDL3/SDL_rect.h>
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_surface.h>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
+
+
+/**
+ * Returns a new texture ID, unique for the run of the program, starting at 1.
+ */
+uint32_t __nextTextureID();
+
+/**
+ * Destroy `texture` on the main thread, SDL_Renderer is main thread only.
+ * Called off the main thread (e.g. a system dropping the last reference to
+ * a Res_SDL_Texture in pipelined mode), it is queued for
+ * __destroyReleasedTextures() instead.
+ */
+void __releaseSDLTexture(SDL_Texture* texture);
+
+/**
+ * Destroy the textures queued by __releaseSDLTexture(), called by Game on
+ * the main thread after each frame is presented.
+ */
+void __destroyReleasedTextures();
 
 
 /*Wrapper for SDL_Texture, which can be instantiated using */
@@ -16,28 +41,152 @@
 class Res_SDL_Texture {
 public:
     SDL_Texture* texture;
+    int w = 0;              //!< texture width in pixels
+    int h = 0;              //!< texture height in pixels
+    const uint32_t id = __nextTextureID();  //!< in load order, used to group draws by texture
+    std::vector<SDL_FRect> frames;          //!< sprite sheet frames of a cooked texture, see SpriteSheet
+
+    /*
+     * Set on textures shared by AssetCache, which may free `texture` to stay
+     * within its texture budget and load it again from `path` when drawn.
+     * Changed on the main thread only, under the AssetCache lock but for
+     * `last_used_frame`.
+     */
+    struct Residency {
+        std::string path;                           //!< empty if the texture can't be evicted
+        SDL_Renderer* renderer = nullptr;
+        SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST;
+        std::atomic<uint64_t> last_used_frame{ 0 }; //!< AssetCache frame it was last drawn in
+        bool is_evicted = false;                    //!< `texture` was freed and is loaded again when drawn
+        bool is_reloading = false;                  //!< evicted, queued on the AssetCache texture reloader
+    } residency;
     
+    /*
+     * Load a BMP file, or a cooked texture (see CookTexture()) when
+     * `texture_path` ends with COOKED_TEXTURE_EXTENSION.
+     *
+     * If `renderer` is null (headless mode), only the texture size will be
+     * loaded and `texture` will be left as null.
+     */
     Res_SDL_Texture(std::string texture_path, SDL_Renderer* renderer, SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST) {
+        this->texture = nullptr;
+
+        if (IsCookedTexturePath(texture_path)) {
+            CookedTexture cooked;
+            auto res = LoadCookedTexture(SDL_IOFromFile(texture_path.c_str(), "rb"), true, &cooked);
+            if ( !res.isOk() ) {
+                PIXBENCH_LOG_ERROR("Failed to load file {}: {}", texture_path, res.getErrResult()->err_message);
+                return;
+            }
+            this->createFromSurface(cooked.surface, renderer, scale_mode);
+            this->frames.swap(cooked.frames);
+            SDL_DestroySurface(cooked.surface);
+            return;
+        }
+
         SDL_Surface* surface = SDL_LoadBMP(texture_path.c_str());
         if (surface == NULL) {
-            std::cout << "Failed to load file: " << SDL_GetError() <<std::endl;
+            PIXBENCH_LOG_ERROR("Failed to load file {}: {}", texture_path, SDL_GetError());
+            return;
         }
+        this->createFromSurface(surface, renderer, scale_mode);
+        SDL_DestroySurface(surface);
+    }
+
+    /*
+     * Create the texture from the pixels of `surface`, which stays owned by
+     * the caller. Same headless behaviour as above.
+     */
+    Res_SDL_Texture(SDL_Surface* surface, SDL_Renderer* renderer, SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST) {
+        this->texture = nullptr;
+        if (surface == NULL)
+            return;
+        this->createFromSurface(surface, renderer, scale_mode);
+    }
+
+    ~Res_SDL_Texture() {
+        if (texture)
+            __releaseSDLTexture(texture);
+    }
+
+    /**
+     * Free `texture`, keeping its size and frames, see AssetCache texture
+     * budget. Main thread only.
+     */
+    void __evict() {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = nullptr;
+        residency.is_evicted = true;
+    }
+
+    /**
+     * Create `texture` again from `surface`, the pixels of Residency::path,
+     * after Res_SDL_Texture::__evict(). Main thread only.
+     */
+    void __restore(SDL_Surface* surface) {
+        this->createTexture(surface, residency.renderer, residency.scale_mode);
+        residency.is_evicted = false;
+    }
+private:
+    void createFromSurface(SDL_Surface* surface, SDL_Renderer* renderer, SDL_ScaleMode scale_mode) {
+        this->w = surface->w;
+        this->h = surface->h;
+
+        if (renderer == NULL)
+            return;
+        this->createTexture(surface, renderer, scale_mode);
+    }
+
+    void createTexture(SDL_Surface* surface, SDL_Renderer* renderer, SDL_ScaleMode scale_mode) {
         SDL_Texture* sdlTexture = SDL_CreateTextureFromSurface(renderer, surface);
         if (sdlTexture == NULL) {
-            std::cout << "Failed to convert surface to texture: " << SDL_GetError() <<std::endl;
+            PIXBENCH_LOG_ERROR("Failed to convert surface to texture: {}", SDL_GetError());
         }
         SDL_SetTextureScaleMode(sdlTexture, scale_mode);
-        SDL_DestroySurface(surface);
 
         this->texture = sdlTexture;
     }
+};
 
-    ~Res_SDL_Texture() {
-        SDL_DestroyTexture(texture);
+
+/**
+ * Part of a texture drawn as an image of its own, e.g. an image packed into
+ * a TextureAtlas page. Accepted by Sprite::SetTexture(), SpriteSheet and
+ * TileSet in place of a whole texture.
+ */
+struct TextureRegion {
+    std::shared_ptr<Res_SDL_Texture> texture = nullptr;
+    SDL_FRect rect = { 0.0f, 0.0f, 0.0f, 0.0f };   //!< in texture pixels
+
+    TextureRegion() = default;
+
+    TextureRegion(std::shared_ptr<Res_SDL_Texture> texture, SDL_FRect rect)
+        :
+            texture(texture),
+            rect(rect)
+    { }
+
+    /**
+     * Region covering the whole `texture`.
+     */
+    TextureRegion(std::shared_ptr<Res_SDL_Texture> texture)
+        :
+            texture(texture)
+    {
+        if (texture)
+            rect = { 0.0f, 0.0f, (float)texture->w, (float)texture->h };
     }
+
+    bool isValid() const { return texture != nullptr && rect.w > 0.0f && rect.h > 0.0f; };
 };
 
 
+/**
+ * Decode `texture_path` into a new texture, every call. Use
+ * `game->assets.loadTexture()` instead to share one texture per path and
+ * count it in the texture budget, see AssetCache.
+ */
 std::shared_ptr<Res_SDL_Texture> LoadSDLTexture(std::string texture_path, SDL_Renderer* renderer);
 
 
@@ -0,0 +1,283 @@
+#ifndef SCRIPT_BATCH_HEADER
+#define SCRIPT_BATCH_HEADER
+
+
+#include "pixbench/components.h"
+#include "pixbench/engine_config.h"
+#include "pixbench/entity.h"
+#include "pixbench/utils/results.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+
+class EntityManager;
+
+
+/**
+ * ScriptComponent hooks dispatched by ScriptSystem, as bit flags.
+ */
+enum ScriptHook {
+    SCRIPT_HOOK_INIT            = 1 << 0,
+    SCRIPT_HOOK_UPDATE          = 1 << 1,
+    SCRIPT_HOOK_LATE_UPDATE     = 1 << 2,
+    SCRIPT_HOOK_FIXED_UPDATE    = 1 << 3,
+    SCRIPT_HOOK_ON_EVENT        = 1 << 4,
+    SCRIPT_HOOK_ON_DESTROY      = 1 << 5,
+};
+
+
+/*
+ * `&T::Update` only has the type `Void (ScriptComponent::*)(...)` when
+ * neither `T` nor a base between them overrides it.
+ */
+#define __SCRIPT_HOOK_IF_OVERRIDDEN(T, method, flag) \
+    (std::is_same<decltype(&T::method), decltype(&ScriptComponent::method)>::value ? 0u : (unsigned int)(flag))
+
+
+/**
+ * ScriptHook flags of the hooks overridden by script type `T`, detected at
+ * compile time. ScriptSystem never calls the other hooks of `T`.
+ */
+template<typename T>
+unsigned int getScriptHooks() {
+    return __SCRIPT_HOOK_IF_OVERRIDDEN(T, Init, SCRIPT_HOOK_INIT)
+        | __SCRIPT_HOOK_IF_OVERRIDDEN(T, Update, SCRIPT_HOOK_UPDATE)
+        | __SCRIPT_HOOK_IF_OVERRIDDEN(T, LateUpdate, SCRIPT_HOOK_LATE_UPDATE)
+        | __SCRIPT_HOOK_IF_OVERRIDDEN(T, FixedUpdate, SCRIPT_HOOK_FIXED_UPDATE)
+        | __SCRIPT_HOOK_IF_OVERRIDDEN(T, OnEvent, SCRIPT_HOOK_ON_EVENT)
+        | __SCRIPT_HOOK_IF_OVERRIDDEN(T, OnDestroy, SCRIPT_HOOK_ON_DESTROY);
+}
+
+
+/**
+ * Dense list of the instances of one script type, so ScriptSystem can run a
+ * lifecycle hook on all of them with a single virtual call.
+ *
+ * Instances are kept in insertion order until one is removed, the last
+ * instance then takes its place.
+ */
+class IScriptBatch {
+public:
+    virtual ~IScriptBatch() {};
+
+    /**
+     * Add `script` of `entity`, `script` must be of the batch's script type.
+     */
+    virtual void add(EntityID entity, ScriptComponent* script) = 0;
+    virtual void remove(EntityIDNumber entity_id) = 0;
+    virtual size_t size() const = 0;
+
+    /**
+     * ScriptHook flags of the hooks implemented by the batch's script type.
+     */
+    virtual unsigned int getHooks() const = 0;
+    bool hasHook(ScriptHook hook) const { return (getHooks() & hook) != 0; };
+
+    /**
+     * Call Update/LateUpdate on the instances whose entity is in the current
+     * time slice (`entity.id % time_slices == current_slice`).
+     */
+    virtual Void updateAll(double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) = 0;
+    virtual Void lateUpdateAll(double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) = 0;
+    virtual Void fixedUpdateAll(double delta_time_s, EntityManager* entity_mgr) = 0;
+
+    /**
+     * `T::isParallelSafe()` of the batch's script type.
+     */
+    virtual bool isParallelSafe() const = 0;
+
+    /**
+     * Update the instances in [begin, end), may run concurrently with other
+     * ranges of the same batch. The instances must not be added or removed
+     * meanwhile.
+     */
+    virtual Void updateRange(size_t begin, size_t end, double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) = 0;
+};
+
+
+/**
+ * IScriptBatch of script type `T`. Hooks are called as `T::Update()`, which
+ * the compiler can inline, since the instances are known to be exactly `T`
+ * (ComponentArray<T> stores `T` objects).
+ */
+template<typename T>
+class ScriptBatch : public IScriptBatch {
+private:
+    std::vector<T*> m_instances;
+    std::vector<EntityID> m_entities;
+    std::vector<uint32_t> m_entity_to_index;    //!< index + 1 in m_instances, 0 if none
+    bool m_is_iterating = false;
+    bool m_has_deferred_removals = false;
+
+    /*
+     * Removing during an iteration would move an unvisited instance into an
+     * already visited slot, so only clear the slot and compact afterward.
+     */
+    void compact() {
+        size_t kept = 0;
+        for (size_t i=0; i<m_instances.size(); ++i) {
+            if ( !m_instances[i] )
+                continue;
+            m_instances[kept] = m_instances[i];
+            m_entities[kept] = m_entities[i];
+            m_entity_to_index[m_entities[kept].id] = (uint32_t)(kept + 1);
+            ++kept;
+        }
+        m_instances.resize(kept);
+        m_entities.resize(kept);
+        m_has_deferred_removals = false;
+    }
+
+    void endIteration() {
+        m_is_iterating = false;
+        if (m_has_deferred_removals)
+            compact();
+    }
+
+    static bool isInSlice(EntityID entity, unsigned int time_slices, unsigned int current_slice) {
+        return time_slices <= 1 || (entity.id % time_slices) == current_slice;
+    }
+
+public:
+    void add(EntityID entity, ScriptComponent* script) override {
+        if (m_entity_to_index.empty())
+            m_entity_to_index.assign(MAX_ENTITIES, 0);
+
+        T* instance = static_cast<T*>(script);
+        uint32_t index = m_entity_to_index[entity.id];
+        if (index != 0 && m_instances[index - 1]) {
+            // component replaced on the same entity
+            m_instances[index - 1] = instance;
+            m_entities[index - 1] = entity;
+            return;
+        }
+
+        m_instances.push_back(instance);
+        m_entities.push_back(entity);
+        m_entity_to_index[entity.id] = (uint32_t)m_instances.size();
+    }
+
+    void remove(EntityIDNumber entity_id) override {
+        if (m_entity_to_index.empty() || m_entity_to_index[entity_id] == 0)
+            return;
+
+        const size_t index = m_entity_to_index[entity_id] - 1;
+        m_entity_to_index[entity_id] = 0;
+
+        if (m_is_iterating) {
+            m_instances[index] = nullptr;
+            m_has_deferred_removals = true;
+            return;
+        }
+
+        const size_t last = m_instances.size() - 1;
+        if (index != last) {
+            m_instances[index] = m_instances[last];
+            m_entities[index] = m_entities[last];
+            m_entity_to_index[m_entities[index].id] = (uint32_t)(index + 1);
+        }
+        m_instances.pop_back();
+        m_entities.pop_back();
+    }
+
+    size_t size() const override {
+        return m_instances.size();
+    }
+
+    unsigned int getHooks() const override {
+        return getScriptHooks<T>();
+    }
+
+    bool isParallelSafe() const override {
+        return T::isParallelSafe();
+    }
+
+    Void updateRange(size_t begin, size_t end, double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) override {
+        for (size_t i=begin; i<end && i<m_instances.size(); ++i) {
+            if ( !m_instances[i] || !isInSlice(m_entities[i], time_slices, current_slice) )
+                continue;
+
+            Void res = m_instances[i]->T::Update(delta_time_s, entity_mgr, m_entities[i]);
+            if ( !res.isOk() )
+                return res;
+        }
+        return ResultOK;
+    }
+
+    Void updateAll(double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) override {
+        m_is_iterating = true;
+        for (size_t i=0; i<m_instances.size(); ++i) {
+            if ( !m_instances[i] || !isInSlice(m_entities[i], time_slices, current_slice) )
+                continue;
+
+            Void res = m_instances[i]->T::Update(delta_time_s, entity_mgr, m_entities[i]);
+            if ( !res.isOk() ) {
+                endIteration();
+                return res;
+            }
+        }
+        endIteration();
+        return ResultOK;
+    }
+
+    Void lateUpdateAll(double delta_time_s, EntityManager* entity_mgr, unsigned int time_slices, unsigned int current_slice) override {
+        m_is_iterating = true;
+        for (size_t i=0; i<m_instances.size(); ++i) {
+            if ( !m_instances[i] || !isInSlice(m_entities[i], time_slices, current_slice) )
+                continue;
+
+            Void res = m_instances[i]->T::LateUpdate(delta_time_s, entity_mgr, m_entities[i]);
+            if ( !res.isOk() ) {
+                endIteration();
+                return res;
+            }
+        }
+        endIteration();
+        return ResultOK;
+    }
+
+    Void fixedUpdateAll(double delta_time_s, EntityManager* entity_mgr) override {
+        m_is_iterating = true;
+        for (size_t i=0; i<m_instances.size(); ++i) {
+            if ( !m_instances[i] )
+                continue;
+
+            Void res = m_instances[i]->T::FixedUpdate(delta_time_s, entity_mgr, m_entities[i]);
+            if ( !res.isOk() ) {
+                endIteration();
+                return res;
+            }
+        }
+        endIteration();
+        return ResultOK;
+    }
+};
+
+
+typedef IScriptBatch* (*ScriptBatchFactory)();
+
+
+template<typename T>
+IScriptBatch* __createScriptBatch(std::true_type is_script) {
+    return new ScriptBatch<T>();
+}
+
+
+template<typename T>
+IScriptBatch* __createScriptBatch(std::false_type is_script) {
+    return nullptr;
+}
+
+
+/**
+ * New ScriptBatch<T> if `T` is a ScriptComponent, `nullptr` otherwise.
+ */
+template<typename T>
+IScriptBatch* createScriptBatch() {
+    return __createScriptBatch<T>(std::is_base_of<ScriptComponent, T>());
+}
+
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SPATIAL_GRID_HEADER
+#define SPATIAL_GRID_HEADER
+
+
+#include <SDL3/SDL_rect.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Loose uniform grid of items (small integer IDs chosen by the caller) by
+ * their bounds, for queries of the items that may overlap an area.
+ *
+ * An item is stored in the cell holding the center of its bounds, so moving
+ * it only costs something when its center crosses into another cell. Cells
+ * are `cell_size` wide, and items up to `cell_size` wide and high reach at
+ * most half a cell out of theirs, which queries account for. Bigger items
+ * are kept in a separate list returned by every query.
+ *
+ * Queries are conservative: they return every item overlapping the area,
+ * plus some nearby ones.
+ */
+class SpatialGrid {
+private:
+    struct ItemState {
+        bool is_inserted = false;
+        bool is_oversized = false;      //!< in `m_oversized_items` instead of a cell
+        int64_t cell_key = 0;
+        size_t slot = 0;                //!< index in its cell or in `m_oversized_items`
+    };
+
+    float m_cell_size;
+    std::vector<ItemState> m_items;     //!< by item ID
+    std::unordered_map<int64_t, std::vector<uint32_t>> m_cells;
+    std::vector<uint32_t> m_oversized_items;
+    size_t m_size = 0;
+
+    static int64_t cellKey(int32_t cell_x, int32_t cell_y) {
+        return ((int64_t)cell_x << 32) | (uint32_t)cell_y;
+    };
+
+    int32_t cellCoordinate(float position) const;
+
+    /**
+     * Remove `item` from its cell or from `m_oversized_items`.
+     */
+    void unlink(uint32_t item);
+
+public:
+    explicit SpatialGrid(float cell_size);
+
+    /**
+     * Insert `item`, or move it to where `bounds` now are.
+     * `oversized` puts it in the list returned by every query, e.g. for
+     * items with unknown bounds.
+     */
+    void update(uint32_t item, const SDL_FRect& bounds, bool oversized = false);
+
+    void remove(uint32_t item);
+
+    bool contains(uint32_t item) const {
+        return item < m_items.size() && m_items[item].is_inserted;
+    };
+
+    /**
+     * Append the items that may overlap `area` to `out__items`, each once,
+     * in no particular order.
+     */
+    void query(const SDL_FRect& area, std::vector<uint32_t>* out__items) const;
+
+    size_t size() const { return m_size; };
+
+    void clear();
+};
+
+
+#endif
@@ -2,28 +2,148 @@
 #define SYSTEMS_HEADER
 
 
+#include "pixbench/command_buffer.h"
 #include "pixbench/components.h"
 #include "pixbench/ecs.h"
 #include "pixbench/engine_config.h"
 #include "pixbench/entity.h"
+#include "pixbench/event_registry.h"
 #include "pixbench/game.h"
+#include "pixbench/job_pool.h"
 #include "pixbench/physics/physics.h"
 #include "pixbench/physics/type.h"
+#include "pixbench/render_queue.h"
+#include "pixbench/render_snapshot.h"
+#include "pixbench/spatial_grid.h"
 #include "pixbench/utils/results.h"
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Game phases a system takes part in, as bit flags of SystemSchedule::phases.
+ */
+enum SystemPhase {
+    SYSTEM_PHASE_UPDATE         = 1 << 0,
+    SYSTEM_PHASE_FIXED_UPDATE   = 1 << 1,
+    SYSTEM_PHASE_LATE_UPDATE    = 1 << 2,
+    SYSTEM_PHASE_DRAW           = 1 << 3,   //!< PreDraw, RecordDraw and Draw
+    SYSTEM_PHASE_ALL            = SYSTEM_PHASE_UPDATE | SYSTEM_PHASE_FIXED_UPDATE | SYSTEM_PHASE_LATE_UPDATE | SYSTEM_PHASE_DRAW,
+};
+
+
+/**
+ * Scheduling metadata of a system, read by Game every frame.
+ *
+ * - `enabled`: disabled systems skip every phase, but still receive
+ *   component, entity-destroyed and exit callbacks.
+ * - `phases`: SystemPhase flags of the phases the system runs in,
+ *   Initialize and events are not affected.
+ * - `priority`: systems run in ascending priority within each phase, ties
+ *   keep the order in which they were added.
+ * - `tick_divisor` / `tick_rate_hz`: Update and LateUpdate only run every
+ *   N-th frame and/or at most `tick_rate_hz` times per second, with the
+ *   time elapsed since the system last ran as delta time.
+ * - `time_slices`: each tick only processes the entities of one of N
+ *   slices (see SystemSchedule::isInCurrentSlice()), so a slice is visited
+ *   every N ticks and gets the time elapsed since its last visit as delta
+ *   time. Only systems that check isInCurrentSlice() are sliced.
+ *
+ * FixedUpdate, PreDraw, RecordDraw and Draw are only affected by `enabled`.
+ */
+class SystemSchedule {
+private:
+    unsigned long m_frame_count = 0;
+    double m_elapsed_since_tick_s = 0.0;
+    bool m_is_ticking = true;
+    double m_tick_delta_s = 0.0;
+    unsigned int m_current_slice = 0;
+    std::vector<double> m_slice_elapsed_s;
+    bool m_is_initialized = false;
+public:
+    bool enabled = true;
+    unsigned int phases = SYSTEM_PHASE_ALL;
+    int priority = 0;
+    unsigned int tick_divisor = 1;
+    double tick_rate_hz = 0.0;          //!< 0.0 means no rate limit
+    unsigned int time_slices = 1;
+
+    /**
+     * `true` if Update/LateUpdate are throttled or sliced, and receive
+     * SystemSchedule::tickDelta() instead of the frame delta time.
+     */
+    bool isThrottled() const {
+        return tick_divisor > 1 || tick_rate_hz > 0.0 || time_slices > 1;
+    }
+
+    /**
+     * `true` if `entity` should be processed in the current tick.
+     */
+    bool isInCurrentSlice(EntityID entity) const {
+        return time_slices <= 1 || (entity.id % time_slices) == m_current_slice;
+    }
+
+    unsigned int currentSlice() const { return m_current_slice; };
+
+    /**
+     * Whether the system is enabled and runs in `phase`.
+     */
+    bool runsPhase(SystemPhase phase) const { return enabled && (phases & phase) != 0; };
+
+    /**
+     * Whether Update and LateUpdate run this frame.
+     */
+    bool isTicking() const { return enabled && m_is_ticking; };
+
+    /**
+     * Delta time for Update and LateUpdate of the current tick.
+     */
+    double tickDelta() const { return m_tick_delta_s; };
+
+    /**
+     * Called by Game once per frame, before Update, with the frame's delta time.
+     */
+    void __beginFrame(double delta_time_s);
+
+    /**
+     * `true` until the system's first Initialize call. Game skips Initialize
+     * when there are no new entities, except for that first call.
+     */
+    bool __needsFirstInitialize() const { return !m_is_initialized; };
+    void __setInitialized() { m_is_initialized = true; };
+};
+
+
 class ISystem {
 public:
+    SystemSchedule schedule;    //!< enable flag, priority, tick rate and time-slicing of this system
+
     virtual Result<VoidResult, GameError> Initialize(Game* game, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> Awake(EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id) { return ResultOK; };
+    virtual Result<VoidResult, GameError> OnComponentRemovedFromEntity(const ComponentDataPayload* component_info, EntityID entity_id) { return ResultOK; };
     virtual Result<VoidResult, GameError> OnComponentRegistered(const ComponentDataPayload* component_info) { return ResultOK; };
+    /**
+     * Register the SDL event types handled by ISystem::OnEvent(), called
+     * again whenever the system order changes. Subscribes to every event
+     * type by default.
+     */
+    virtual void SubscribeEvents(EventSubscription* subscription) { subscription->subscribeAll(); };
     virtual Result<VoidResult, GameError> OnEvent(SDL_Event *event, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> Update(double delta_time_s, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> FixedUpdate(double delta_time_s, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> LateUpdate(double delta_time_s, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> PreDraw(RenderContext* renderContext, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> Draw(RenderContext* renderContext, EntityManager* entity_mgr) { return ResultOK; };
+    /**
+     * Record this frame's draw commands into `snapshot` instead of calling
+     * SDL directly. Runs on the simulation thread in pipelined mode, where
+     * ISystem::Draw() is not called.
+     */
+    virtual Result<VoidResult, GameError> RecordDraw(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> OnEntityDestroyed(EntityManager* entity_mgr, EntityID entity_id) { return ResultOK; };
     virtual Result<VoidResult, GameError> OnError(EntityManager* entity_mgr) { return ResultOK; };
     virtual Result<VoidResult, GameError> OnExit(EntityManager* entity_mgr) { return ResultOK; };
@@ -67,22 +187,63 @@ public:
 };
 
 
+/**
+ * A renderable component of an entity having a Transform, as indexed by
+ * RenderingSystem for culling.
+ */
+struct IndexedRenderable {
+    EntityID entity;
+    size_t cindex = 0;
+    RenderableComponent* renderable = nullptr;  //!< nullptr for a free slot
+    RenderableTag tag = RCTAG_Sprite;
+};
+
+
 class RenderingSystem : public ISystem {
 private:
     std::vector<RenderableComponent*> ordered_renderables;
     std::bitset<MAX_COMPONENTS> m_renderable_components_mask;
+    bool m_is_recording_off_main_thread{ false };   //!< pipelined mode, CustomRenderable::Draw() can't be deferred
+    bool m_warned_custom_renderable{ false };
+
+    //!< renderables by their slot, which is their item ID in `m_renderable_grid`
+    std::vector<IndexedRenderable> m_indexed_renderables;
+    std::vector<uint32_t> m_free_renderable_slots;
+    //!< slots of each entity's renderables
+    std::unordered_map<EntityIDNumber, std::vector<uint32_t>> m_entity_renderable_slots;
+    //!< entities whose renderables or Transform changed, indexed again on PreDraw
+    std::vector<EntityID> m_entities_to_index;
+    SpatialGrid m_renderable_grid{ RENDER_GRID_CELL_SIZE };
+    std::vector<uint32_t> m_visible_slots;
+    //!< visible renderables by their slot, in draw order
+    RenderQueue m_render_queue;
+
+    void __unindexEntity(EntityID entity_id);
+    void __indexPendingEntities(EntityManager* entity_mgr);
 public:
+    void __setRecordingOffMainThread(bool is_off_main_thread) { m_is_recording_off_main_thread = is_off_main_thread; };
+
     Result<VoidResult, GameError> Initialize(Game* game, EntityManager* entity_mgr) override;
     Result<VoidResult, GameError> OnComponentRegistered(const ComponentDataPayload* component_info) override;
+    Result<VoidResult, GameError> OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id) override;
+    Result<VoidResult, GameError> OnComponentRemovedFromEntity(const ComponentDataPayload* component_info, EntityID entity_id) override;
+    Result<VoidResult, GameError> OnEntityDestroyed(EntityManager* entity_mgr, EntityID entity_id) override;
     Result<VoidResult, GameError> LateUpdate(double delta_time_s, EntityManager* entity_mgr) override; // Animation update
     Result<VoidResult, GameError> PreDraw(RenderContext* renderContext, EntityManager* entity_mgr) override;
-    Result<VoidResult, GameError> Draw(RenderContext* renderContext, EntityManager* entity_mgr) override;
+    Result<VoidResult, GameError> RecordDraw(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) override;
 };
 
 
 class AudioSystem : public ISystem {
 private:
     std::vector<AudioChannelState> m_channel_states;
+    bool m_is_headless{ false };    //!< null audio backend, never touch SDL_mixer
+    double m_bytes_per_second{ 0.0 };   //!< of the mixer audio format
+
+    /**
+     * Play length of `clip` in seconds, 0.0 if unknown.
+     */
+    double clipDuration(const AudioClip* clip) const;
 public:
     Result<VoidResult, GameError> Initialize(Game* game, EntityManager* entity_mgr) override;
     Result<VoidResult, GameError> LateUpdate(double delta_time_s, EntityManager* entity_mgr) override; // Audio update
@@ -124,20 +285,70 @@ public:
     Result<VoidResult, GameError> FixedUpdate(double delta_time_s, EntityManager* entity_mgr) override; // Physics update
     Result<VoidResult, GameError> OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id) override;
     Result<VoidResult, GameError> OnComponentRegistered(const ComponentDataPayload* component_info) override;
-    Result<VoidResult, GameError> Draw(RenderContext* renderContext, EntityManager* entity_mgr) override;
+    Result<VoidResult, GameError> RecordDraw(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) override;
     Result<VoidResult, GameError> OnEntityDestroyed(EntityManager* entity_mgr, EntityID entity_id) override;
 };
 
 
+/**
+ * A script component of an entity, as stored in ScriptSystem's event registry.
+ */
+struct ScriptEventSubscriber {
+    EntityID entity;
+    size_t cindex;
+};
+
+
 class ScriptSystem : public ISystem {
 private:
     std::bitset<MAX_COMPONENTS> m_script_components_mask;
+    //!< scripts by the SDL event types they subscribed to
+    EventRegistry<ScriptEventSubscriber> m_event_registry;
+    //!< scripts added since the last ScriptSystem::__subscribePendingScripts(), not yet subscribed nor batched
+    std::vector<ScriptEventSubscriber> m_pending_subscribers;
+    std::vector<ScriptEventSubscriber> m_dispatch_subscribers;  //!< reused by ScriptSystem::OnEvent()
+
+    struct SubscribedScripts {
+        size_t version = 0;
+        std::bitset<MAX_COMPONENTS> mask;
+    };
+    //!< subscribed script components, indexed by entity ID number
+    std::vector<SubscribedScripts> m_subscribed_scripts;
+    size_t m_subscribed_count = 0;
+    //!< registry entries of destroyed entities, removed in batches
+    size_t m_stale_subscribed_count = 0;
+
+    //!< dense instance lists of each script type, indexed by component index
+    std::vector<std::shared_ptr<IScriptBatch>> m_script_batches;
+    //!< batches implementing each hook, in component index order
+    std::vector<IScriptBatch*> m_update_batches;
+    std::vector<IScriptBatch*> m_late_update_batches;
+    std::vector<IScriptBatch*> m_fixed_update_batches;
+
+    JobPool* m_job_pool = nullptr;
+    std::vector<EntityCommandBuffer> m_chunk_command_buffers;   //!< one per job of __updateParallel()
+    std::vector<Result<VoidResult, GameError>> m_chunk_results;
+
+    IScriptBatch* __getScriptBatch(size_t cindex) const;
+    void __createScriptBatch(size_t cindex, EntityManager* entity_mgr);
+
+    /**
+     * Update a parallel-safe batch in chunks of SCRIPT_PARALLEL_CHUNK_SIZE
+     * instances on the job pool, then apply the commands the chunks
+     * recorded, in chunk order.
+     */
+    Result<VoidResult, GameError> __updateParallel(IScriptBatch* batch, double delta_time_s, EntityManager* entity_mgr);
+
+    bool __isSubscriberStale(const ScriptEventSubscriber& subscriber) const;
+    void __subscribePendingScripts(EntityManager* entity_mgr);
 
 public:
     ScriptSystem();
 
     Result<VoidResult, GameError> Initialize(Game* game, EntityManager* entity_mgr);
     Result<VoidResult, GameError> OnComponentRegistered(const ComponentDataPayload* component_info);
+    Result<VoidResult, GameError> OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id);
+    Result<VoidResult, GameError> OnComponentRemovedFromEntity(const ComponentDataPayload* component_info, EntityID entity_id);
     Result<VoidResult, GameError> OnEvent(SDL_Event *event, EntityManager* entity_mgr);
     Result<VoidResult, GameError> Update(double delta_time_s, EntityManager* entity_mgr);
     Result<VoidResult, GameError> LateUpdate(double delta_time_s, EntityManager* entity_mgr);
@@ -0,0 +1,110 @@
+#ifndef TEXTURE_ATLAS_HEADER
+#define TEXTURE_ATLAS_HEADER
+
+
+#include "pixbench/engine_config.h"
+#include "pixbench/resource.h"
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_render.h>
+#include <SDL3/SDL_surface.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * Handle of an image added to a TextureAtlas.
+ */
+typedef size_t TextureAtlasHandle;
+
+
+/**
+ * Packs many images into a few shared textures (pages), so sprites, sprite
+ * sheets and tile sets using different images can be drawn in the same
+ * RenderSnapshot batch.
+ *
+ * Images are added first, then TextureAtlas::pack() places them on
+ * TEXTURE_ATLAS_PAGE_SIZE pixels pages, tallest first on shelves, and
+ * creates one texture per page. Images bigger than a page get a page of
+ * their own. Usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * TextureAtlas atlas;
+ * TextureAtlasHandle player = atlas.addImage(base_path + "assets/player.bmp");
+ * TextureAtlasHandle tiles = atlas.addImage(base_path + "assets/tiles.bmp");
+ * auto res = atlas.pack(game->renderContext->renderer);
+ *
+ * sprite->SetTexture(atlas.getRegion(player));
+ * auto tile_set = std::make_shared<TileSet>(atlas.getRegion(tiles), 16, 16);
+ * ~~~~~~~~~~~~~~~~~~~~
+ */
+class TextureAtlas {
+private:
+    struct AtlasImage {
+        std::string source;             //!< file path, for error messages
+        SDL_Surface* surface = nullptr; //!< released once packed
+        size_t page = 0;
+        SDL_Rect rect = { 0, 0, 0, 0 }; //!< in the page
+    };
+
+    int m_page_size;
+    int m_padding;
+    SDL_ScaleMode m_scale_mode;
+    std::vector<AtlasImage> m_images;
+    std::vector<std::shared_ptr<Res_SDL_Texture>> m_pages;
+    bool m_is_packed = false;
+
+    /**
+     * Place every image, setting their page and rect, and return the size
+     * of each page in `out__page_sizes`.
+     */
+    void placeImages(std::vector<SDL_Point>* out__page_sizes);
+
+    void releaseSurfaces();
+public:
+    /**
+     * `padding` pixels are left around each image, so linear filtering
+     * doesn't bleed neighbours in.
+     */
+    TextureAtlas(
+            int page_size = TEXTURE_ATLAS_PAGE_SIZE,
+            int padding = 1,
+            SDL_ScaleMode scale_mode = SDL_ScaleMode::SDL_SCALEMODE_NEAREST
+            );
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    /**
+     * Load the BMP file at `path` to be packed. Only allowed before
+     * TextureAtlas::pack(). A file that can't be loaded gives an invalid
+     * region.
+     */
+    TextureAtlasHandle addImage(const std::string& path);
+
+    /**
+     * Same as TextureAtlas::addImage(), the atlas takes ownership of
+     * `surface`.
+     */
+    TextureAtlasHandle addSurface(SDL_Surface* surface, const std::string& name = "surface");
+
+    /**
+     * Pack the images and create the page textures with `renderer`, null in
+     * headless mode. Can only be called once.
+     */
+    Result<VoidResult, GameError> pack(SDL_Renderer* renderer);
+
+    /**
+     * Where image `handle` ended up, only valid after TextureAtlas::pack().
+     */
+    TextureRegion getRegion(TextureAtlasHandle handle) const;
+
+    size_t getImageCount() const { return m_images.size(); };
+    size_t getPageCount() const { return m_pages.size(); };
+    std::shared_ptr<Res_SDL_Texture> getPage(size_t page) const { return m_pages[page]; };
+    bool isPacked() const { return m_is_packed; };
+};
+
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef TIMERS_HEADER
+#define TIMERS_HEADER
+
+
+#include "pixbench/entity.h"
+#include "pixbench/utils/results.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+
+/**
+ * Handle of a scheduled timer, stays safe to use after the timer fired or
+ * was cancelled.
+ */
+struct TimerID {
+    uint32_t index = 0;
+    uint32_t generation = 0;    //!< 0 for a handle that never refers to a timer
+
+    bool isValid() const { return generation != 0; };
+};
+
+
+typedef std::function<Result<VoidResult, GameError>()> TimerCallback;
+
+
+/**
+ * Delayed and repeating callbacks, advanced once per frame by Game.
+ *
+ * Timers are stored in a hierarchical timing wheel of TIMER_WHEEL_LEVELS
+ * levels of TIMER_WHEEL_SLOTS slots. Level 0 slots are one tick
+ * (TIMER_WHEEL_TICK_S) wide, each next level's slots are TIMER_WHEEL_SLOTS
+ * times wider, and are moved down a level as their time comes. Scheduling
+ * and cancelling are O(1), and a frame only costs the ticks it spans plus
+ * the timers that fire, however many timers are waiting.
+ *
+ * Expired timers fire together after the Update cascade, in order of
+ * expiry then scheduling. A repeating timer fires at most once per frame.
+ *
+ * Timers bound to an entity are cancelled when the entity is destroyed.
+ * Usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * game->timers.scheduleForEntity(self, 2.0, [entity_mgr, self] () {
+ *     entity_mgr->destroyEntity(self);
+ *     return ResultOK;
+ * });
+ * ~~~~~~~~~~~~~~~~~~~~
+ */
+class TimerWheel {
+private:
+    enum TimerState {
+        TIMER_FREE,
+        TIMER_SCHEDULED,    //!< waiting in a wheel slot
+        TIMER_EXPIRED,      //!< waiting in m_expired to be fired
+    };
+
+    struct Timer {
+        TimerCallback callback;
+        uint64_t expire_tick = 0;
+        uint64_t interval_ticks = 0;    //!< 0 for one-shot timers
+        uint64_t sequence = 0;          //!< scheduling order, breaks ties between timers expiring on the same tick
+        EntityID entity;
+        bool has_entity = false;
+        uint32_t generation = 1;
+        TimerState state = TIMER_FREE;
+        int32_t slot = -1;              //!< level * TIMER_WHEEL_SLOTS + slot index
+        int32_t slot_prev = -1;
+        int32_t slot_next = -1;         //!< also links the free list
+        int32_t entity_prev = -1;
+        int32_t entity_next = -1;
+    };
+
+    std::vector<Timer> m_timers;
+    int32_t m_free_head = -1;
+    int32_t m_slot_heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    std::vector<int32_t> m_entity_heads;    //!< first timer bound to each entity ID number, sized lazily
+    std::vector<TimerID> m_expired;         //!< expired timers of the current frame, fired in order
+    size_t m_fire_cursor = 0;               //!< next timer of m_expired to fire
+
+    uint64_t m_current_tick = 0;
+    uint64_t m_sequence = 0;
+    double m_tick_remainder_s = 0.0;
+    size_t m_scheduled_count = 0;           //!< timers waiting in the wheel or in m_expired
+    size_t m_wheel_count = 0;               //!< timers waiting in the wheel
+
+    uint64_t __delayToTicks(double delay_s) const;
+    TimerID __schedule(double delay_s, double interval_s, const EntityID* entity, TimerCallback callback);
+    void __insert(int32_t index);
+    void __unlinkSlot(int32_t index);
+    void __unlinkEntity(int32_t index);
+    void __free(int32_t index);
+    void __cascade(int level);
+    bool __isLive(TimerID timer) const;
+
+public:
+    TimerWheel();
+
+    /**
+     * Call `callback` once after `delay_s` seconds.
+     */
+    TimerID schedule(double delay_s, TimerCallback callback);
+
+    /**
+     * Call `callback` after `delay_s` seconds, then every `interval_s`
+     * seconds until cancelled.
+     */
+    TimerID scheduleRepeating(double delay_s, double interval_s, TimerCallback callback);
+
+    /**
+     * Same as TimerWheel::schedule(), cancelled when `entity` is destroyed.
+     */
+    TimerID scheduleForEntity(EntityID entity, double delay_s, TimerCallback callback);
+
+    /**
+     * Same as TimerWheel::scheduleRepeating(), cancelled when `entity` is
+     * destroyed.
+     */
+    TimerID scheduleRepeatingForEntity(EntityID entity, double delay_s, double interval_s, TimerCallback callback);
+
+    /**
+     * Cancel `timer`, returns `false` if it already fired or was cancelled.
+     * Safe to call from a timer callback, including on itself.
+     */
+    bool cancel(TimerID timer);
+
+    /**
+     * `true` until a one-shot timer fired, or a timer is cancelled.
+     */
+    bool isScheduled(TimerID timer) const;
+
+    /**
+     * Number of timers waiting to fire.
+     */
+    size_t size() const { return m_scheduled_count; };
+
+    /**
+     * Advance by `delta_time_s` and fire the timers that expired, called by
+     * Game each frame. If a callback fails, the remaining expired timers
+     * fire on the next call.
+     */
+    Result<VoidResult, GameError> __advance(double delta_time_s);
+
+    /**
+     * Cancel the timers bound to `entity`, called by Game when an entity is
+     * destroyed.
+     */
+    void __cancelEntityTimers(EntityID entity);
+};
+
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef PIXBENCH_LOCKFREE_QUEUE_HEADER
+#define PIXBENCH_LOCKFREE_QUEUE_HEADER
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * Bounded multi-producer multi-consumer queue (Dmitry Vyukov's algorithm).
+ *
+ * Every cell carries a sequence number that tells producers and consumers
+ * whether the cell is free to write or ready to read, so neither side ever
+ * takes a lock. `Capacity` must be a power of two.
+ *
+ * `tryPush` fails instead of blocking when the queue is full, `tryPop` fails
+ * when it is empty.
+ */
+template <typename T, size_t Capacity>
+class LockFreeQueue {
+private:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+            "LockFreeQueue Capacity must be a power of two");
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    // keep producer and consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> m_enqueue_pos;
+    alignas(64) std::atomic<size_t> m_dequeue_pos;
+    alignas(64) Cell* m_cells;
+
+public:
+    LockFreeQueue() {
+        m_cells = new Cell[Capacity];
+        for (size_t i = 0; i < Capacity; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_enqueue_pos.store(0, std::memory_order_relaxed);
+        m_dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    ~LockFreeQueue() {
+        delete[] m_cells;
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    /**
+     * Copy `value` into the queue. Returns `false` if the queue is full.
+     */
+    bool tryPush(const T& value) {
+        Cell* cell;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & (Capacity - 1)];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;   // full
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Move the oldest value into `out__value`. Returns `false` if the queue
+     * is empty.
+     */
+    bool tryPop(T& out__value) {
+        Cell* cell;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &m_cells[pos & (Capacity - 1)];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+            if (diff == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;   // empty
+            } else {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        out__value = cell->data;
+        cell->sequence.store(pos + Capacity, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Approximate number of queued values, exact only when no other thread
+     * is pushing or popping.
+     */
+    size_t sizeApprox() const {
+        const size_t enq = m_enqueue_pos.load(std::memory_order_relaxed);
+        const size_t deq = m_dequeue_pos.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+};
+
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Pixel Bench logging
+ *
+ * Leveled logging with compile-time stripping. Logging only copies the
+ * arguments into a record and pushes it into a lock-free queue, the record
+ * is formatted and written by a background thread.
+ *
+ * usage:
+ * ~~~~~~~~~~~~~~~~~~~~{.cpp}
+ * PIXBENCH_LOG_INFO("Loaded {} sprites in {} s", count, elapsed_s);
+ * PIXBENCH_LOG_ERROR("Can't load texture {}: {}", path, SDL_GetError());
+ * ~~~~~~~~~~~~~~~~~~~~
+ *
+ * Each `{}` in the format is replaced by the next argument. The format must be
+ * a string literal (only its pointer is stored), string arguments are copied.
+ *
+ * Calls below PIXBENCH_LOG_LEVEL are compiled out entirely, including the
+ * evaluation of their arguments. Build with e.g.
+ * `-DPIXBENCH_LOG_LEVEL=PIXBENCH_LOG_LEVEL_TRACE` to see the engine's traces.
+ */
+#ifndef PIXBENCH_LOGGER_HEADER
+#define PIXBENCH_LOGGER_HEADER
+
+#include "pixbench/utils/lockfree_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+#define PIXBENCH_LOG_LEVEL_TRACE    0
+#define PIXBENCH_LOG_LEVEL_DEBUG    1
+#define PIXBENCH_LOG_LEVEL_INFO     2
+#define PIXBENCH_LOG_LEVEL_WARNING  3
+#define PIXBENCH_LOG_LEVEL_ERROR    4
+#define PIXBENCH_LOG_LEVEL_OFF      5
+
+#ifndef PIXBENCH_LOG_LEVEL
+#define PIXBENCH_LOG_LEVEL PIXBENCH_LOG_LEVEL_INFO
+#endif
+
+
+enum LogLevel {
+    LOGLVL_Trace = PIXBENCH_LOG_LEVEL_TRACE,
+    LOGLVL_Debug = PIXBENCH_LOG_LEVEL_DEBUG,
+    LOGLVL_Info = PIXBENCH_LOG_LEVEL_INFO,
+    LOGLVL_Warning = PIXBENCH_LOG_LEVEL_WARNING,
+    LOGLVL_Error = PIXBENCH_LOG_LEVEL_ERROR,
+};
+
+
+const size_t LOG_MAX_ARGS = 8;              //!< extra arguments are ignored
+const size_t LOG_STRING_BUFFER_SIZE = 192;  //!< bytes for copied string arguments per record, longer strings are truncated
+const size_t LOG_QUEUE_CAPACITY = 4096;     //!< records waiting to be written, records are dropped when full
+
+
+enum LogArgType {
+    LOGARG_Int,
+    LOGARG_UInt,
+    LOGARG_Double,
+    LOGARG_Bool,
+    LOGARG_Char,
+    LOGARG_String,
+    LOGARG_Pointer,
+};
+
+
+/**
+ * A single captured argument. Strings are stored in LogRecord::strings and
+ * referenced by offset.
+ */
+struct LogArg {
+    LogArgType type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        const void* p;
+        struct {
+            unsigned short offset;
+            unsigned short length;
+        } s;
+    } value;
+};
+
+
+struct LogRecord {
+    LogLevel level = LOGLVL_Info;
+    double time_s = 0.0;                    //!< seconds since the logger started
+    const char* format = nullptr;
+    size_t num_args = 0;
+    LogArg args[LOG_MAX_ARGS];
+    size_t strings_used = 0;
+    char strings[LOG_STRING_BUFFER_SIZE];
+
+    void addArg(long long v) { LogArg* a = nextArg(LOGARG_Int); if (a) a->value.i = v; }
+    void addArg(int v) { addArg((long long)v); }
+    void addArg(long v) { addArg((long long)v); }
+    void addArg(short v) { addArg((long long)v); }
+    void addArg(unsigned long long v) { LogArg* a = nextArg(LOGARG_UInt); if (a) a->value.u = v; }
+    void addArg(unsigned int v) { addArg((unsigned long long)v); }
+    void addArg(unsigned long v) { addArg((unsigned long long)v); }
+    void addArg(unsigned short v) { addArg((unsigned long long)v); }
+    void addArg(unsigned char v) { addArg((unsigned long long)v); }
+    void addArg(double v) { LogArg* a = nextArg(LOGARG_Double); if (a) a->value.d = v; }
+    void addArg(float v) { addArg((double)v); }
+    void addArg(bool v) { LogArg* a = nextArg(LOGARG_Bool); if (a) a->value.u = v; }
+    void addArg(char v) { LogArg* a = nextArg(LOGARG_Char); if (a) a->value.i = v; }
+    void addArg(const std::string& v) { addString(v.c_str(), v.size()); }
+    void addArg(const char* v) {
+        if ( !v )
+            v = "(null)";
+        addString(v, std::strlen(v));
+    }
+    void addArg(char* v) { addArg((const char*)v); }
+    template <typename T>
+    void addArg(T* v) { LogArg* a = nextArg(LOGARG_Pointer); if (a) a->value.p = (const void*)v; }
+
+    /**
+     * Write the formatted message (without time and level) into `out`.
+     */
+    void formatMessage(std::string& out) const;
+
+private:
+    LogArg* nextArg(LogArgType type) {
+        if (num_args >= LOG_MAX_ARGS)
+            return nullptr;
+        LogArg* arg = &args[num_args++];
+        arg->type = type;
+        return arg;
+    }
+
+    void addString(const char* str, size_t length) {
+        LogArg* arg = nextArg(LOGARG_String);
+        if ( !arg )
+            return;
+
+        const size_t available = LOG_STRING_BUFFER_SIZE - strings_used;
+        if (length > available)
+            length = available;
+        std::memcpy(strings + strings_used, str, length);
+        arg->value.s.offset = (unsigned short)strings_used;
+        arg->value.s.length = (unsigned short)length;
+        strings_used += length;
+    }
+};
+
+
+/**
+ * Process-wide logger. The background thread is started on the first
+ * record and stopped (after writing everything still queued) when the
+ * program exits.
+ */
+class Logger {
+private:
+    LockFreeQueue<LogRecord, LOG_QUEUE_CAPACITY> m_queue;
+    std::atomic<bool> m_is_running;
+    std::atomic<bool> m_stop_requested;
+    std::atomic<int> m_min_level;
+    std::atomic<size_t> m_pushed_count;
+    std::atomic<size_t> m_written_count;
+    std::atomic<size_t> m_dropped_count;
+    std::chrono::steady_clock::time_point m_start_time;
+    std::mutex m_start_mutex;
+    std::mutex m_output_mutex;
+    std::thread m_thread;
+    FILE* m_output;
+
+    Logger();
+    void start();
+    void run();
+    void write(const LogRecord& record, std::string& line_buffer);
+
+    template <typename T, typename... Args>
+    static void addArgs(LogRecord& record, const T& first, const Args&... rest) {
+        record.addArg(first);
+        addArgs(record, rest...);
+    }
+    static void addArgs(LogRecord&) {}
+
+public:
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static Logger& get();
+
+    /**
+     * Queue a record. Never blocks, if the queue is full the record is
+     * dropped and counted in Logger::droppedCount().
+     */
+    template <typename... Args>
+    void log(LogLevel level, const char* format, const Args&... args) {
+        if ((int)level < m_min_level.load(std::memory_order_relaxed))
+            return;
+        if ( !m_is_running.load(std::memory_order_acquire) )
+            start();
+
+        LogRecord record;
+        record.level = level;
+        record.time_s = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - m_start_time
+                ).count();
+        record.format = format;
+        addArgs(record, args...);
+
+        if (m_queue.tryPush(record))
+            m_pushed_count.fetch_add(1, std::memory_order_release);
+        else
+            m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Minimum level written at runtime, on top of PIXBENCH_LOG_LEVEL.
+     */
+    void setLevel(LogLevel level) { m_min_level.store((int)level, std::memory_order_relaxed); };
+
+    /**
+     * Where formatted records are written to, `stdout` by default.
+     */
+    void setOutput(FILE* output);
+
+    /**
+     * Block until every record queued so far has been written.
+     */
+    void flush();
+
+    size_t droppedCount() const { return m_dropped_count.load(std::memory_order_relaxed); };
+};
+
+
+#if PIXBENCH_LOG_LEVEL <= PIXBENCH_LOG_LEVEL_TRACE
+#define PIXBENCH_LOG_TRACE(...) Logger::get().log(LOGLVL_Trace, __VA_ARGS__)
+#else
+#define PIXBENCH_LOG_TRACE(...) ((void)0)
+#endif
+
+#if PIXBENCH_LOG_LEVEL <= PIXBENCH_LOG_LEVEL_DEBUG
+#define PIXBENCH_LOG_DEBUG(...) Logger::get().log(LOGLVL_Debug, __VA_ARGS__)
+#else
+#define PIXBENCH_LOG_DEBUG(...) ((void)0)
+#endif
+
+#if PIXBENCH_LOG_LEVEL <= PIXBENCH_LOG_LEVEL_INFO
+#define PIXBENCH_LOG_INFO(...) Logger::get().log(LOGLVL_Info, __VA_ARGS__)
+#else
+#define PIXBENCH_LOG_INFO(...) ((void)0)
+#endif
+
+#if PIXBENCH_LOG_LEVEL <= PIXBENCH_LOG_LEVEL_WARNING
+#define PIXBENCH_LOG_WARNING(...) Logger::get().log(LOGLVL_Warning, __VA_ARGS__)
+#else
+#define PIXBENCH_LOG_WARNING(...) ((void)0)
+#endif
+
+#if PIXBENCH_LOG_LEVEL <= PIXBENCH_LOG_LEVEL_ERROR
+#define PIXBENCH_LOG_ERROR(...) Logger::get().log(LOGLVL_Error, __VA_ARGS__)
+#else
+#define PIXBENCH_LOG_ERROR(...) ((void)0)
+#endif
+
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef LZ4_HEADER
+#define LZ4_HEADER
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ * Compression to and from the LZ4 block format, without the frame format
+ * around it. Blocks written here can be read by any LZ4 implementation and
+ * the other way around.
+ */
+
+
+/**
+ * Biggest compressed size of `source_size` bytes.
+ */
+size_t LZ4CompressBound(size_t source_size);
+
+/**
+ * Compress `source` into `destination`, greedily with a single hash table.
+ * Returns the compressed size, or 0 if it doesn't fit in
+ * `destination_capacity`.
+ */
+size_t LZ4CompressBlock(
+        const uint8_t* source, size_t source_size,
+        uint8_t* destination, size_t destination_capacity
+        );
+
+/**
+ * Decompress the block `source` into exactly `destination_size` bytes.
+ * Returns `false` for a malformed block, or one of another size, without
+ * reading or writing out of the buffers.
+ */
+bool LZ4DecompressBlock(
+        const uint8_t* source, size_t source_size,
+        uint8_t* destination, size_t destination_size
+        );
+
+
+#endif
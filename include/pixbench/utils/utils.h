@@ -7,6 +7,16 @@
 
 void PrepareRandomGenerator();
 
+/**
+ * Seed the random generator with `seed`, e.g. to replay a recorded session.
+ */
+void PrepareRandomGenerator(uint32_t seed);
+
+/**
+ * Seed of the random generator, recorded in replay files.
+ */
+uint32_t GetRandomGeneratorSeed();
+
 uint32_t GenerateRandomUInt32();
 
 class Color {
@@ -0,0 +1,468 @@
+#include "pixbench/asset_cache.h"
+#include "pixbench/asset_loader.h"
+#include "pixbench/utils/logger.h"
+#include <SDL3/SDL_error.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+#define ASSET_CACHE_MIN_PRUNE_SIZE 64
+
+
+std::string AssetCache::normalizePath(const std::string& path) {
+    const bool is_absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+    std::vector<std::string> segments;
+    std::string segment;
+    for (size_t i=0; i<=path.size(); ++i) {
+        const char c = i < path.size() ? path[i] : '/';
+        if (c != '/' && c != '\\') {
+            segment.push_back(c);
+            continue;
+        }
+
+        if (segment.empty() || segment == ".") {
+            // repeated separator or current directory
+        } else if (segment == ".." && !segments.empty() && segments.back() != "..") {
+            segments.pop_back();
+        } else if ( !(segment == ".." && is_absolute) ) {
+            // ".." above the root of an absolute path is the root
+            segments.push_back(segment);
+        }
+        segment.clear();
+    }
+
+    std::string normalized = is_absolute ? "/" : "";
+    for (size_t i=0; i<segments.size(); ++i) {
+        if (i > 0)
+            normalized.push_back('/');
+        normalized.append(segments[i]);
+    }
+    if (normalized.empty())
+        normalized = ".";
+    return normalized;
+}
+
+
+Result<VoidResult, GameError> AssetCache::mountPack(const std::string& pack_path, const std::string& root_dir) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pack.isOpen())
+        return ResultError("An asset pack is already mounted, can't mount " + pack_path);
+
+    auto res = m_pack.open(pack_path);
+    if ( !res.isOk() )
+        return res;
+
+    m_pack_root = normalizePath(root_dir);
+    if (m_pack_root == ".")
+        m_pack_root.clear();
+    else if (m_pack_root.back() != '/')
+        m_pack_root.push_back('/');
+
+    PIXBENCH_LOG_INFO("Mounted asset pack {} with {} files", pack_path, m_pack.getEntryCount());
+    return ResultOK;
+}
+
+
+SDL_IOStream* AssetCache::openPackedFile(const std::string& path) const {
+    // mounted before any load and never unmounted, safe to read unlocked
+    if ( !m_pack.isOpen() )
+        return NULL;
+
+    const std::string normalized = normalizePath(path);
+    if (normalized.compare(0, m_pack_root.size(), m_pack_root) != 0)
+        return NULL;
+    return m_pack.openEntry(normalized.substr(m_pack_root.size()));
+}
+
+
+SDL_Surface* AssetCache::loadSurface(
+        const std::string& path,
+        std::vector<SDL_FRect>* out__frames,
+        std::string* out__error
+        ) const {
+    SDL_IOStream* packed_file = this->openPackedFile(path);
+
+    if (IsCookedTexturePath(path)) {
+        CookedTexture cooked;
+        auto res = LoadCookedTexture(
+                packed_file ? packed_file : SDL_IOFromFile(path.c_str(), "rb"),
+                true, &cooked
+                );
+        if ( !res.isOk() ) {
+            if (out__error)
+                *out__error = "Failed to load file " + path + ": " + res.getErrResult()->err_message;
+            return NULL;
+        }
+        if (out__frames)
+            out__frames->swap(cooked.frames);
+        return cooked.surface;
+    }
+
+    SDL_Surface* surface = packed_file ? SDL_LoadBMP_IO(packed_file, true) : SDL_LoadBMP(path.c_str());
+    if (surface == NULL && out__error)
+        *out__error = "Failed to load file " + path + ": " + SDL_GetError();
+    return surface;
+}
+
+
+Mix_Chunk* AssetCache::loadChunk(const std::string& path) const {
+    SDL_IOStream* packed_file = this->openPackedFile(path);
+    return packed_file ? Mix_LoadWAV_IO(packed_file, true) : Mix_LoadWAV(path.c_str());
+}
+
+
+void AssetCache::__pruneExpired() {
+    // amortized over the insertions that doubled the map since the last prune
+    if (m_textures.size() >= m_textures_prune_size) {
+        for (auto it = m_textures.begin(); it != m_textures.end(); ) {
+            if (it->second.expired())
+                it = m_textures.erase(it);
+            else
+                ++it;
+        }
+        m_textures_prune_size = std::max((size_t)ASSET_CACHE_MIN_PRUNE_SIZE, m_textures.size() * 2);
+    }
+
+    if (m_audio_clips.size() >= m_audio_clips_prune_size) {
+        for (auto it = m_audio_clips.begin(); it != m_audio_clips.end(); ) {
+            if (it->second.expired())
+                it = m_audio_clips.erase(it);
+            else
+                ++it;
+        }
+        m_audio_clips_prune_size = std::max((size_t)ASSET_CACHE_MIN_PRUNE_SIZE, m_audio_clips.size() * 2);
+    }
+}
+
+
+/**
+ * Estimate of the memory taken by `texture`, 4 bytes per pixel.
+ */
+static size_t textureBytes(const Res_SDL_Texture& texture) {
+    return (size_t)texture.w * (size_t)texture.h * 4;
+}
+
+
+std::string AssetCache::textureKey(const std::string& path, SDL_Renderer* renderer, SDL_ScaleMode scale_mode) {
+    return normalizePath(path)
+        + '\n' + std::to_string((uintptr_t)renderer)
+        + '\n' + std::to_string((int)scale_mode);
+}
+
+
+std::shared_ptr<Res_SDL_Texture> AssetCache::findTexture(
+        const std::string& path,
+        SDL_Renderer* renderer,
+        SDL_ScaleMode scale_mode
+        ) {
+    const std::string key = textureKey(path, renderer, scale_mode);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.texture_requests;
+    auto it = m_textures.find(key);
+    if (it == m_textures.end())
+        return nullptr;
+    std::shared_ptr<Res_SDL_Texture> texture = it->second.lock();
+    if (texture)
+        ++m_stats.texture_hits;
+    return texture;
+}
+
+
+std::shared_ptr<Res_SDL_Texture> AssetCache::storeTexture(
+        const std::string& path,
+        SDL_Renderer* renderer,
+        SDL_ScaleMode scale_mode,
+        std::shared_ptr<Res_SDL_Texture> texture
+        ) {
+    const std::string key = textureKey(path, renderer, scale_mode);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.texture_loads;
+    std::weak_ptr<Res_SDL_Texture>& cached = m_textures[key];
+    std::shared_ptr<Res_SDL_Texture> stored_meanwhile = cached.lock();
+    if (stored_meanwhile)
+        return stored_meanwhile;
+    cached = texture;
+    this->__pruneExpired();
+
+    // not drawn yet, kept for as long as a texture that just was
+    texture->residency.path = path;
+    texture->residency.renderer = renderer;
+    texture->residency.scale_mode = scale_mode;
+    texture->residency.last_used_frame.store(m_frame, std::memory_order_relaxed);
+    if (texture->texture)
+        m_resident_bytes_estimate += textureBytes(*texture);
+    return texture;
+}
+
+
+std::shared_ptr<Res_SDL_Texture> AssetCache::loadTexture(
+        const std::string& path,
+        SDL_Renderer* renderer,
+        SDL_ScaleMode scale_mode
+        ) {
+    std::shared_ptr<Res_SDL_Texture> texture = this->findTexture(path, renderer, scale_mode);
+    if (texture)
+        return texture;
+
+    // loaded without the lock, so other threads keep being served
+    std::vector<SDL_FRect> frames;
+    std::string error;
+    SDL_Surface* surface = this->loadSurface(path, &frames, &error);
+    texture = std::make_shared<Res_SDL_Texture>(surface, renderer, scale_mode);
+    // the file couldn't be read, don't keep the failure
+    if (surface == NULL) {
+        PIXBENCH_LOG_ERROR("{}", error);
+        return texture;
+    }
+    SDL_DestroySurface(surface);
+    texture->frames.swap(frames);
+
+    return this->storeTexture(path, renderer, scale_mode, texture);
+}
+
+
+std::shared_ptr<AudioClip> AssetCache::findAudioClip(const std::string& path) {
+    const std::string key = normalizePath(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.audio_requests;
+    auto it = m_audio_clips.find(key);
+    if (it == m_audio_clips.end())
+        return nullptr;
+    std::shared_ptr<AudioClip> clip = it->second.lock();
+    if (clip)
+        ++m_stats.audio_hits;
+    return clip;
+}
+
+
+std::shared_ptr<AudioClip> AssetCache::storeAudioClip(const std::string& path, std::shared_ptr<AudioClip> clip) {
+    const std::string key = normalizePath(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.audio_loads;
+    std::weak_ptr<AudioClip>& cached = m_audio_clips[key];
+    std::shared_ptr<AudioClip> stored_meanwhile = cached.lock();
+    if (stored_meanwhile)
+        return stored_meanwhile;
+    cached = clip;
+    this->__pruneExpired();
+    return clip;
+}
+
+
+Result<std::shared_ptr<AudioClip>, std::string> AssetCache::loadAudioClip(const std::string& path) {
+    auto res = Result<std::shared_ptr<AudioClip>, std::string>();
+
+    std::shared_ptr<AudioClip> clip = this->findAudioClip(path);
+    if (clip)
+        return res.Ok(clip);
+
+    Mix_Chunk* chunk = this->loadChunk(path);
+    if ( !chunk )
+        return res.Err("Can't open file '" + path + "': " + SDL_GetError());
+
+    clip = std::make_shared<AudioClip>();
+    clip->chunk = chunk;
+    return res.Ok(this->storeAudioClip(path, clip));
+}
+
+
+void AssetCache::setTextureBudget(size_t budget_bytes, uint64_t evict_after_frames) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_texture_budget_bytes = budget_bytes;
+    m_texture_evict_after_frames = std::max(evict_after_frames, (uint64_t)1);
+    m_next_eviction_frame = 0;
+}
+
+
+void AssetCache::setTextureReloader(AssetLoader* loader) {
+    m_texture_reloader = loader;
+}
+
+
+void AssetCache::useTexture(Res_SDL_Texture* texture) {
+    texture->residency.last_used_frame.store(m_frame, std::memory_order_relaxed);
+    if ( !texture->residency.is_evicted || texture->residency.is_reloading )
+        return;
+
+    if (m_texture_reloader) {
+        Res_SDL_Texture::Residency& residency = texture->residency;
+        std::shared_ptr<Res_SDL_Texture> cached;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_textures.find(textureKey(residency.path, residency.renderer, residency.scale_mode));
+            if (it != m_textures.end())
+                cached = it->second.lock();
+            // forgotten by AssetCache::clear() otherwise, loaded on the spot
+            if (cached.get() == texture)
+                residency.is_reloading = true;
+        }
+
+        if (residency.is_reloading) {
+            m_texture_reloader->__reloadTexture(cached);
+            return;
+        }
+    }
+
+    std::string error;
+    SDL_Surface* surface = this->loadSurface(texture->residency.path, nullptr, &error);
+    this->__finishTextureReload(texture, surface, error);
+    if (surface)
+        SDL_DestroySurface(surface);
+}
+
+
+void AssetCache::__finishTextureReload(Res_SDL_Texture* texture, SDL_Surface* surface, const std::string& error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    texture->residency.is_reloading = false;
+    if (surface == NULL) {
+        // left empty like a failed load, instead of retrying every frame
+        PIXBENCH_LOG_ERROR("Can't reload evicted texture: {}", error);
+        texture->residency.is_evicted = false;
+        texture->residency.path.clear();
+        return;
+    }
+    texture->__restore(surface);
+
+    ++m_stats.texture_reloads;
+    if (texture->texture)
+        m_resident_bytes_estimate += textureBytes(*texture);
+}
+
+
+void AssetCache::updateTextureResidency() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint64_t frame = m_frame++;
+
+    // the estimate is exact but for textures freed by their owners, the
+    // cache is only walked when it goes over the budget
+    if (
+            m_texture_budget_bytes == 0
+            || m_resident_bytes_estimate <= m_texture_budget_bytes
+            || frame < m_next_eviction_frame
+       ) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<Res_SDL_Texture>> candidates;
+    size_t resident_bytes = 0;
+    for (const auto& entry : m_textures) {
+        std::shared_ptr<Res_SDL_Texture> texture = entry.second.lock();
+        if ( !texture || !texture->texture )
+            continue;
+        resident_bytes += textureBytes(*texture);
+
+        const uint64_t last_used_frame = texture->residency.last_used_frame.load(std::memory_order_relaxed);
+        if ( !texture->residency.path.empty() && frame - last_used_frame >= m_texture_evict_after_frames )
+            candidates.push_back(texture);
+    }
+
+    // least recently drawn first, then in load order
+    std::sort(
+            candidates.begin(), candidates.end(),
+            [] (const std::shared_ptr<Res_SDL_Texture>& a, const std::shared_ptr<Res_SDL_Texture>& b)
+            {
+            const uint64_t a_frame = a->residency.last_used_frame.load(std::memory_order_relaxed);
+            const uint64_t b_frame = b->residency.last_used_frame.load(std::memory_order_relaxed);
+            return a_frame != b_frame ? a_frame < b_frame : a->id < b->id;
+            }
+            );
+    for (const auto& texture : candidates) {
+        if (resident_bytes <= m_texture_budget_bytes)
+            break;
+        resident_bytes -= textureBytes(*texture);
+        texture->__evict();
+        ++m_stats.texture_evictions;
+    }
+    m_resident_bytes_estimate = resident_bytes;
+
+    // every candidate was evicted and it's still over, nothing else can be
+    // until the least recently drawn texture left is unused for long enough
+    if (resident_bytes > m_texture_budget_bytes) {
+        uint64_t oldest_used_frame = frame;
+        for (const auto& entry : m_textures) {
+            std::shared_ptr<Res_SDL_Texture> texture = entry.second.lock();
+            if (texture && texture->texture && !texture->residency.path.empty())
+                oldest_used_frame = std::min(oldest_used_frame, texture->residency.last_used_frame.load(std::memory_order_relaxed));
+        }
+        m_next_eviction_frame = oldest_used_frame + m_texture_evict_after_frames;
+    }
+}
+
+
+AssetCacheStats AssetCache::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AssetCacheStats stats = m_stats;
+    stats.texture_budget_bytes = m_texture_budget_bytes;
+
+    for (const auto& entry : m_textures) {
+        std::shared_ptr<Res_SDL_Texture> texture = entry.second.lock();
+        if ( !texture )
+            continue;
+        ++stats.live_textures;
+        stats.texture_bytes += textureBytes(*texture);
+        if (texture->texture) {
+            ++stats.resident_textures;
+            stats.resident_texture_bytes += textureBytes(*texture);
+        }
+        if (texture->residency.is_evicted)
+            ++stats.evicted_textures;
+    }
+
+    for (const auto& entry : m_audio_clips) {
+        std::shared_ptr<AudioClip> clip = entry.second.lock();
+        if ( !clip )
+            continue;
+        ++stats.live_audio_clips;
+        if (clip->chunk)
+            stats.audio_bytes += clip->chunk->alen;
+    }
+
+    return stats;
+}
+
+
+std::vector<TextureResidency> AssetCache::getTextureResidency() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<TextureResidency> report;
+
+    for (const auto& entry : m_textures) {
+        std::shared_ptr<Res_SDL_Texture> texture = entry.second.lock();
+        if ( !texture )
+            continue;
+
+        const uint64_t last_used_frame = texture->residency.last_used_frame.load(std::memory_order_relaxed);
+        TextureResidency residency;
+        residency.id = texture->id;
+        residency.path = texture->residency.path;
+        residency.bytes = textureBytes(*texture);
+        residency.is_resident = texture->texture != nullptr;
+        // m_frame is the frame being recorded, drawn in the last one is 0
+        residency.frames_unused = m_frame > last_used_frame ? m_frame - last_used_frame - 1 : 0;
+        report.push_back(residency);
+    }
+
+    std::sort(
+            report.begin(), report.end(),
+            [] (const TextureResidency& a, const TextureResidency& b)
+            {
+            return a.frames_unused != b.frames_unused ? a.frames_unused > b.frames_unused : a.id < b.id;
+            }
+            );
+    return report;
+}
+
+
+void AssetCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_textures.clear();
+    m_audio_clips.clear();
+    m_textures_prune_size = 0;
+    m_audio_clips_prune_size = 0;
+    m_resident_bytes_estimate = 0;
+}
@@ -0,0 +1,336 @@
+#include "pixbench/asset_loader.h"
+#include "pixbench/utils/logger.h"
+#include <SDL3/SDL_error.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+
+AssetLoader::AssetLoader(AssetCache* cache, SDL_Renderer* renderer, size_t worker_count)
+    :
+        m_cache(cache),
+        m_renderer(renderer)
+{
+    worker_count = std::max(worker_count, (size_t)1);
+    for (size_t i=0; i<worker_count; ++i)
+        m_workers.emplace_back(&AssetLoader::run, this);
+}
+
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop_requested = true;
+    }
+    m_work_cv.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+
+    for (auto& job : m_load_queue)
+        __releaseJob(&job);
+    for (auto& job : m_upload_queue)
+        __releaseJob(&job);
+}
+
+
+void AssetLoader::__releaseJob(LoadJob* job) {
+    if (job->surface)
+        SDL_DestroySurface(job->surface);
+    job->surface = nullptr;
+    if (job->chunk)
+        Mix_FreeChunk(job->chunk);
+    job->chunk = nullptr;
+}
+
+
+void AssetLoader::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [this] {
+                return m_stop_requested || !m_load_queue.empty();
+                });
+        if (m_stop_requested)
+            return;
+
+        std::pop_heap(m_load_queue.begin(), m_load_queue.end(), __isLowerPriority);
+        LoadJob job = std::move(m_load_queue.back());
+        m_load_queue.pop_back();
+
+        lock.unlock();
+        __load(&job);
+        lock.lock();
+
+        m_upload_queue.push_back(std::move(job));
+        std::push_heap(m_upload_queue.begin(), m_upload_queue.end(), __isLowerPriority);
+        m_loaded_cv.notify_all();
+    }
+}
+
+
+void AssetLoader::__load(LoadJob* job) const {
+    const AssetCache* files = m_cache ? m_cache : &m_loose_files;
+
+    if (job->kind == AssetKind::TEXTURE) {
+        job->surface = files->loadSurface(job->path, &job->frames, &job->error);
+        return;
+    }
+    if (job->kind == AssetKind::TEXTURE_RELOAD) {
+        job->surface = files->loadSurface(job->path, nullptr, &job->error);
+        return;
+    }
+
+    job->chunk = files->loadChunk(job->path);
+    if (job->chunk == NULL)
+        job->error = "Can't open file '" + job->path + "': " + SDL_GetError();
+}
+
+
+void AssetLoader::__countRequest() {
+    // first request of a new batch
+    if (m_pending_count == 0)
+        m_progress = AssetLoadProgress();
+    ++m_progress.requested;
+}
+
+
+void AssetLoader::__countDone(size_t request_count, bool is_loaded) {
+    m_pending_count -= request_count;
+    if (is_loaded)
+        m_progress.loaded += request_count;
+    else
+        m_progress.failed += request_count;
+}
+
+
+void AssetLoader::__push(LoadJob job) {
+    job.sequence = m_next_sequence++;
+    if (job.kind != AssetKind::TEXTURE_RELOAD)
+        ++m_pending_count;
+    m_load_queue.push_back(std::move(job));
+    std::push_heap(m_load_queue.begin(), m_load_queue.end(), __isLowerPriority);
+    m_work_cv.notify_one();
+}
+
+
+TextureLoadHandle AssetLoader::loadTexture(
+        const std::string& path,
+        SDL_ScaleMode scale_mode,
+        int priority,
+        TextureLoadCallback on_done
+        ) {
+    std::shared_ptr<Res_SDL_Texture> cached = m_cache ?
+        m_cache->findTexture(path, m_renderer, scale_mode) : nullptr;
+    if (cached) {
+        TextureLoadHandle request = std::make_shared<AssetRequest<Res_SDL_Texture>>(path);
+        request->m_asset = cached;
+        request->m_state = AssetLoadState::LOADED;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            this->__countRequest();
+            ++m_progress.loaded;
+        }
+        if (on_done)
+            on_done(request);
+        return request;
+    }
+
+    const std::string key = AssetCache::textureKey(path, m_renderer, scale_mode);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    this->__countRequest();
+
+    // already loading, share the request
+    auto pending_it = m_pending_textures.find(key);
+    if (pending_it != m_pending_textures.end()) {
+        ++m_pending_count;
+        ++pending_it->second->m_request_count;
+        if (on_done)
+            pending_it->second->m_callbacks.push_back(on_done);
+        return pending_it->second;
+    }
+
+    TextureLoadHandle request = std::make_shared<AssetRequest<Res_SDL_Texture>>(path);
+    if (on_done)
+        request->m_callbacks.push_back(on_done);
+    m_pending_textures[key] = request;
+
+    LoadJob job;
+    job.priority = priority;
+    job.kind = AssetKind::TEXTURE;
+    job.key = key;
+    job.path = path;
+    job.scale_mode = scale_mode;
+    job.texture_request = request;
+    this->__push(std::move(job));
+    return request;
+}
+
+
+AudioClipLoadHandle AssetLoader::loadAudioClip(
+        const std::string& path,
+        int priority,
+        AudioClipLoadCallback on_done
+        ) {
+    std::shared_ptr<AudioClip> cached = m_cache ? m_cache->findAudioClip(path) : nullptr;
+    if (cached) {
+        AudioClipLoadHandle request = std::make_shared<AssetRequest<AudioClip>>(path);
+        request->m_asset = cached;
+        request->m_state = AssetLoadState::LOADED;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            this->__countRequest();
+            ++m_progress.loaded;
+        }
+        if (on_done)
+            on_done(request);
+        return request;
+    }
+
+    const std::string key = AssetCache::normalizePath(path);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    this->__countRequest();
+
+    auto pending_it = m_pending_audio_clips.find(key);
+    if (pending_it != m_pending_audio_clips.end()) {
+        ++m_pending_count;
+        ++pending_it->second->m_request_count;
+        if (on_done)
+            pending_it->second->m_callbacks.push_back(on_done);
+        return pending_it->second;
+    }
+
+    AudioClipLoadHandle request = std::make_shared<AssetRequest<AudioClip>>(path);
+    if (on_done)
+        request->m_callbacks.push_back(on_done);
+    m_pending_audio_clips[key] = request;
+
+    LoadJob job;
+    job.priority = priority;
+    job.kind = AssetKind::AUDIO_CLIP;
+    job.key = key;
+    job.path = path;
+    job.audio_clip_request = request;
+    this->__push(std::move(job));
+    return request;
+}
+
+
+void AssetLoader::__reloadTexture(const std::shared_ptr<Res_SDL_Texture>& texture) {
+    LoadJob job;
+    // drawn right now
+    job.priority = std::numeric_limits<int>::max();
+    job.kind = AssetKind::TEXTURE_RELOAD;
+    job.path = texture->residency.path;
+    job.reload_texture = texture;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    this->__push(std::move(job));
+}
+
+
+void AssetLoader::__finish(LoadJob* job) {
+    if (job->kind == AssetKind::TEXTURE_RELOAD) {
+        // skipped if its owners released it meanwhile
+        std::shared_ptr<Res_SDL_Texture> texture = job->reload_texture.lock();
+        if (texture && m_cache)
+            m_cache->__finishTextureReload(texture.get(), job->surface, job->error);
+        __releaseJob(job);
+        return;
+    }
+
+    if (job->kind == AssetKind::TEXTURE) {
+        TextureLoadHandle request = job->texture_request;
+        if (job->surface) {
+            std::shared_ptr<Res_SDL_Texture> texture =
+                std::make_shared<Res_SDL_Texture>(job->surface, m_renderer, job->scale_mode);
+            texture->frames.swap(job->frames);
+            if (m_cache)
+                texture = m_cache->storeTexture(job->path, m_renderer, job->scale_mode, texture);
+            request->m_asset = texture;
+            request->m_state = AssetLoadState::LOADED;
+        } else {
+            PIXBENCH_LOG_ERROR("{}", job->error);
+            request->m_error = job->error;
+            request->m_state = AssetLoadState::FAILED;
+        }
+        __releaseJob(job);
+
+        std::vector<TextureLoadCallback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending_textures.erase(job->key);
+            callbacks.swap(request->m_callbacks);
+            this->__countDone(request->m_request_count, request->m_state == AssetLoadState::LOADED);
+        }
+        for (auto& callback : callbacks)
+            callback(request);
+    } else {
+        AudioClipLoadHandle request = job->audio_clip_request;
+        if (job->chunk) {
+            std::shared_ptr<AudioClip> clip = std::make_shared<AudioClip>();
+            clip->chunk = job->chunk;
+            job->chunk = nullptr;
+            if (m_cache)
+                clip = m_cache->storeAudioClip(job->path, clip);
+            request->m_asset = clip;
+            request->m_state = AssetLoadState::LOADED;
+        } else {
+            PIXBENCH_LOG_ERROR("{}", job->error);
+            request->m_error = job->error;
+            request->m_state = AssetLoadState::FAILED;
+        }
+
+        std::vector<AudioClipLoadCallback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending_audio_clips.erase(job->key);
+            callbacks.swap(request->m_callbacks);
+            this->__countDone(request->m_request_count, request->m_state == AssetLoadState::LOADED);
+        }
+        for (auto& callback : callbacks)
+            callback(request);
+    }
+}
+
+
+void AssetLoader::update(double budget_s) {
+    const auto start = std::chrono::steady_clock::now();
+    while (true) {
+        LoadJob job;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_upload_queue.empty())
+                return;
+            std::pop_heap(m_upload_queue.begin(), m_upload_queue.end(), __isLowerPriority);
+            job = std::move(m_upload_queue.back());
+            m_upload_queue.pop_back();
+        }
+
+        this->__finish(&job);
+
+        const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed_s >= budget_s)
+            return;
+    }
+}
+
+
+void AssetLoader::finishAll() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_loaded_cv.wait(lock, [this] {
+                    return m_pending_count == 0 || !m_upload_queue.empty();
+                    });
+            if (m_pending_count == 0)
+                return;
+        }
+        this->update(0.0);
+    }
+}
+
+
+AssetLoadProgress AssetLoader::getProgress() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_progress;
+}
@@ -0,0 +1,322 @@
+#include "pixbench/asset_pack.h"
+#include "pixbench/asset_cache.h"
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t slot_count;
+    uint64_t entries_offset;
+    uint64_t slots_offset;
+    uint64_t names_offset;
+};
+
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+}
+
+
+uint64_t AssetPack::hashName(const std::string& name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : name) {
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+// ====================== Asset Pack ======================
+
+
+AssetPack::~AssetPack() {
+    this->close();
+}
+
+
+#ifdef _WIN32
+
+Result<VoidResult, GameError> AssetPack::__map(const std::string& path) {
+    HANDLE file = CreateFileA(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+            );
+    if (file == INVALID_HANDLE_VALUE)
+        return ResultError("Can't open asset pack: " + path);
+
+    LARGE_INTEGER file_size;
+    if ( !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ) {
+        CloseHandle(file);
+        return ResultError("Can't read the size of asset pack: " + path);
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (data == NULL) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return ResultError("Can't map asset pack: " + path);
+    }
+
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)file_size.QuadPart;
+    return ResultOK;
+}
+
+
+void AssetPack::__unmap() {
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping_handle)
+        CloseHandle((HANDLE)m_mapping_handle);
+    if (m_file_handle)
+        CloseHandle((HANDLE)m_file_handle);
+    m_file_handle = nullptr;
+    m_mapping_handle = nullptr;
+}
+
+#else
+
+Result<VoidResult, GameError> AssetPack::__map(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return ResultError("Can't open asset pack: " + path);
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        return ResultError("Can't read the size of asset pack: " + path);
+    }
+
+    void* data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps the file alive
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return ResultError("Can't map asset pack: " + path);
+
+    m_data = (const uint8_t*)data;
+    m_size = (size_t)file_stat.st_size;
+    return ResultOK;
+}
+
+
+void AssetPack::__unmap() {
+    if (m_data)
+        munmap((void*)m_data, m_size);
+}
+
+#endif
+
+
+Result<VoidResult, GameError> AssetPack::__readTableOfContents(const std::string& path) {
+    AssetPackHeader header;
+    if (m_size < sizeof(header))
+        return ResultError("Asset pack is too small: " + path);
+    std::memcpy(&header, m_data, sizeof(header));
+
+    if (std::memcmp(header.magic, ASSET_PACK_MAGIC, 4) != 0)
+        return ResultError("Not an asset pack: " + path);
+    if (header.version != ASSET_PACK_VERSION)
+        return ResultError("Unsupported asset pack version: " + path);
+
+    const bool is_slot_count_valid =
+        header.slot_count != 0 && (header.slot_count & (header.slot_count - 1)) == 0;
+    const bool are_tables_in_file =
+        header.entries_offset % alignof(AssetPackEntry) == 0
+        && header.slots_offset % alignof(uint32_t) == 0
+        && header.entries_offset <= m_size
+        && (m_size - header.entries_offset) / sizeof(AssetPackEntry) >= header.entry_count
+        && header.slots_offset <= m_size
+        && (m_size - header.slots_offset) / sizeof(uint32_t) >= header.slot_count
+        && header.names_offset <= m_size;
+    if ( !is_slot_count_valid || !are_tables_in_file )
+        return ResultError("Corrupted asset pack table of contents: " + path);
+
+    m_entries = (const AssetPackEntry*)(m_data + header.entries_offset);
+    m_slots = (const uint32_t*)(m_data + header.slots_offset);
+    m_names = (const char*)(m_data + header.names_offset);
+    m_entry_count = header.entry_count;
+    m_slot_count = header.slot_count;
+
+    // checked once here, so lookups can trust the entries
+    const uint64_t names_size = m_size - header.names_offset;
+    for (uint32_t i=0; i<m_entry_count; ++i) {
+        const AssetPackEntry& entry = m_entries[i];
+        if (
+                entry.offset > m_size || entry.size > m_size - entry.offset
+                || entry.name_offset > names_size || entry.name_length > names_size - entry.name_offset
+           ) {
+            return ResultError("Corrupted asset pack entry: " + path);
+        }
+    }
+    for (uint32_t slot=0; slot<m_slot_count; ++slot) {
+        if (m_slots[slot] > m_entry_count)
+            return ResultError("Corrupted asset pack table of contents: " + path);
+    }
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> AssetPack::open(const std::string& path) {
+    this->close();
+
+    auto res = this->__map(path);
+    if ( !res.isOk() )
+        return res;
+
+    res = this->__readTableOfContents(path);
+    if ( !res.isOk() )
+        this->close();
+    return res;
+}
+
+
+void AssetPack::close() {
+    this->__unmap();
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = nullptr;
+    m_slots = nullptr;
+    m_names = nullptr;
+    m_entry_count = 0;
+    m_slot_count = 0;
+}
+
+
+const AssetPackEntry* AssetPack::find(const std::string& name) const {
+    if ( !this->isOpen() )
+        return nullptr;
+
+    const std::string normalized = AssetCache::normalizePath(name);
+    const uint64_t hash = hashName(normalized);
+    const uint32_t mask = m_slot_count - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+    for (uint32_t probe=0; probe<m_slot_count && m_slots[slot] != 0; ++probe) {
+        const AssetPackEntry* entry = &m_entries[m_slots[slot] - 1];
+        if (
+                entry->name_hash == hash
+                && entry->name_length == normalized.size()
+                && std::memcmp(m_names + entry->name_offset, normalized.data(), normalized.size()) == 0
+           ) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+
+SDL_IOStream* AssetPack::openEntry(const std::string& name) const {
+    const AssetPackEntry* entry = this->find(name);
+    if ( !entry )
+        return NULL;
+    return SDL_IOFromConstMem(this->getEntryData(entry), (size_t)entry->size);
+}
+
+
+// ====================== Asset Pack Writer ======================
+
+
+void AssetPackWriter::addFile(const std::string& name, const std::string& file_path) {
+    const std::string normalized = AssetCache::normalizePath(name);
+    auto index_it = m_entry_indices.find(normalized);
+    if (index_it != m_entry_indices.end()) {
+        m_entries[index_it->second].file_path = file_path;
+        return;
+    }
+    m_entry_indices[normalized] = m_entries.size();
+    m_entries.push_back({ normalized, file_path });
+}
+
+
+Result<VoidResult, GameError> AssetPackWriter::write(const std::string& pack_path) {
+    // sizes first, to lay the file out
+    std::vector<AssetPackEntry> entries(m_entries.size());
+    std::string names;
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        std::ifstream file(m_entries[i].file_path.c_str(), std::ios::binary | std::ios::ate);
+        if ( !file.is_open() )
+            return ResultError("Can't open file to pack: " + m_entries[i].file_path);
+
+        entries[i].name_hash = AssetPack::hashName(m_entries[i].name);
+        entries[i].size = (uint64_t)file.tellg();
+        entries[i].name_offset = (uint32_t)names.size();
+        entries[i].name_length = (uint32_t)m_entries[i].name.size();
+        names.append(m_entries[i].name);
+    }
+
+    // at most half full, so probing stays short
+    uint32_t slot_count = 1;
+    while (slot_count < entries.size() * 2)
+        slot_count *= 2;
+    std::vector<uint32_t> slots(slot_count, 0);
+    for (size_t i=0; i<entries.size(); ++i) {
+        uint32_t slot = (uint32_t)entries[i].name_hash & (slot_count - 1);
+        while (slots[slot] != 0)
+            slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = (uint32_t)i + 1;
+    }
+
+    AssetPackHeader header;
+    std::memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = (uint32_t)entries.size();
+    header.slot_count = slot_count;
+    header.entries_offset = alignOffset(sizeof(header));
+    header.slots_offset = header.entries_offset + entries.size() * sizeof(AssetPackEntry);
+    header.names_offset = header.slots_offset + slots.size() * sizeof(uint32_t);
+
+    uint64_t data_offset = header.names_offset + names.size();
+    for (auto& entry : entries) {
+        entry.offset = alignOffset(data_offset);
+        data_offset = entry.offset + entry.size;
+    }
+
+    std::ofstream pack(pack_path.c_str(), std::ios::binary | std::ios::trunc);
+    if ( !pack.is_open() )
+        return ResultError("Can't open asset pack for writing: " + pack_path);
+
+    const char padding[ASSET_PACK_ALIGNMENT] = {};
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pack.write(padding, header.entries_offset - sizeof(header));
+    pack.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+    pack.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint32_t));
+    pack.write(names.data(), names.size());
+
+    uint64_t position = header.names_offset + names.size();
+    std::vector<char> buffer;
+    for (size_t i=0; i<entries.size(); ++i) {
+        pack.write(padding, entries[i].offset - position);
+
+        std::ifstream file(m_entries[i].file_path.c_str(), std::ios::binary);
+        buffer.resize((size_t)entries[i].size);
+        file.read(buffer.data(), buffer.size());
+        if ( (uint64_t)file.gcount() != entries[i].size )
+            return ResultError("Can't read file to pack: " + m_entries[i].file_path);
+        pack.write(buffer.data(), buffer.size());
+        position = entries[i].offset + entries[i].size;
+    }
+
+    if ( !pack.good() )
+        return ResultError("Can't write asset pack: " + pack_path);
+    return ResultOK;
+}
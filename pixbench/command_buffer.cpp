@@ -0,0 +1,31 @@
+#include "pixbench/command_buffer.h"
+#include "pixbench/ecs.h"
+#include <functional>
+
+
+void EntityCommandBuffer::destroyEntity(EntityID entity) {
+    m_commands.push_back([entity] (EntityManager* entity_mgr) {
+            // several scripts may destroy the same entity
+            if (entity_mgr->isEntityValid(entity))
+                entity_mgr->destroyEntity(entity);
+            });
+}
+
+
+void EntityCommandBuffer::createEntity(std::function<void(EntityManager*, EntityID)> setup) {
+    m_commands.push_back([setup] (EntityManager* entity_mgr) {
+            EntityID entity = entity_mgr->createEntity();
+            if (setup)
+                setup(entity_mgr, entity);
+            });
+}
+
+
+void EntityCommandBuffer::playback(EntityManager* entity_mgr) {
+    // by index, commands may record more commands
+    for (size_t i=0; i<m_commands.size(); ++i) {
+        std::function<void(EntityManager*)> command = std::move(m_commands[i]);
+        command(entity_mgr);
+    }
+    m_commands.clear();
+}
@@ -35,6 +35,28 @@ void Transform::rotate(double delta) {
     this->rotation += delta;
 }
 
+bool Transform::isInterpolated() {
+    return m_has_previous_state
+        && this->globalPosition.x == this->fixedStepGlobalPosition.x
+        && this->globalPosition.y == this->fixedStepGlobalPosition.y
+        && this->rotation == this->fixedStepRotation;
+}
+
+Vector2 Transform::InterpolatedPosition(double alpha) {
+    if ( !this->isInterpolated() )
+        return this->globalPosition;
+
+    return this->previousGlobalPosition
+        + (this->globalPosition - this->previousGlobalPosition) * alpha;
+}
+
+double Transform::InterpolatedRotation(double alpha) {
+    if ( !this->isInterpolated() )
+        return this->rotation;
+
+    return this->previousRotation + (this->rotation - this->previousRotation) * alpha;
+}
+
 void Transform::syncGlobalFromLocalBasedOnParent(const Transform& parent_transform) {
     this->globalPosition = parent_transform.globalPosition
         + this->localPosition.rotated(
@@ -58,6 +80,8 @@ void AudioPlayer::play() {
         m_is_playing = true;
     else
         m_is_need_to_replay = true;
+    m_is_finished = false;
+    m_last_known_position = 0.0;
     m_is_need_sync = true;
 }
 
@@ -132,6 +156,10 @@ void AudioPlayer::__setIsFinished(bool is_finished) {
     m_is_finished = is_finished;
 }
 
+void AudioPlayer::__setPosition(double position_s) {
+    m_last_known_position = position_s;
+}
+
 int AudioPlayer::__setAssignedChannel(int channel) {
     if (channel < -1)
         channel = -1;
@@ -0,0 +1,257 @@
+#include "pixbench/cooked_texture.h"
+#include "pixbench/utils/lz4.h"
+#include <SDL3/SDL_error.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+
+#define COOKED_TEXTURE_MAX_SIZE 16384
+#define COOKED_TEXTURE_MAX_FRAMES (1 << 20)
+
+
+struct CookedTextureHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixel_format;
+    uint32_t pitch;
+    uint32_t compression;
+    uint32_t block_rows;
+    uint32_t block_count;
+    uint32_t frame_count;
+};
+
+
+bool IsCookedTexturePath(const std::string& path) {
+    const size_t extension_length = std::strlen(COOKED_TEXTURE_EXTENSION);
+    return path.size() >= extension_length
+        && path.compare(path.size() - extension_length, extension_length, COOKED_TEXTURE_EXTENSION) == 0;
+}
+
+
+Result<VoidResult, GameError> CookTexture(
+        SDL_Surface* surface,
+        const std::vector<SDL_FRect>& frames,
+        const std::string& path,
+        CookedTextureCompression compression,
+        SDL_PixelFormat pixel_format
+        ) {
+    if (surface == NULL)
+        return ResultError("Can't cook a null surface to " + path);
+
+    SDL_Surface* converted = surface;
+    if (surface->format != pixel_format) {
+        converted = SDL_ConvertSurface(surface, pixel_format);
+        if (converted == NULL)
+            return ResultError(std::string("Can't convert texture to cook: ") + SDL_GetError());
+    }
+
+    CookedTextureHeader header;
+    std::memcpy(header.magic, COOKED_TEXTURE_MAGIC, 4);
+    header.version = COOKED_TEXTURE_VERSION;
+    header.width = (uint32_t)converted->w;
+    header.height = (uint32_t)converted->h;
+    header.pixel_format = (uint32_t)pixel_format;
+    header.pitch = (uint32_t)converted->pitch;
+    header.compression = (uint32_t)compression;
+    header.block_rows = std::max(1u, (uint32_t)(COOKED_TEXTURE_BLOCK_SIZE / std::max(converted->pitch, 1)));
+    header.block_count = (header.height + header.block_rows - 1) / header.block_rows;
+    header.frame_count = (uint32_t)frames.size();
+
+    std::vector<uint32_t> block_sizes(header.block_count);
+    std::vector<uint8_t> data;
+    const uint8_t* pixels = (const uint8_t*)converted->pixels;
+    std::vector<uint8_t> compressed;
+    for (uint32_t block=0; block<header.block_count; ++block) {
+        const uint32_t first_row = block * header.block_rows;
+        const uint32_t rows = std::min(header.block_rows, header.height - first_row);
+        const uint8_t* block_pixels = pixels + (size_t)first_row * header.pitch;
+        const size_t block_size = (size_t)rows * header.pitch;
+
+        size_t compressed_size = 0;
+        if (compression == CookedTextureCompression::LZ4) {
+            compressed.resize(LZ4CompressBound(block_size));
+            compressed_size = LZ4CompressBlock(block_pixels, block_size, compressed.data(), compressed.size());
+        }
+
+        // stored as is when compressing doesn't help
+        if (compressed_size == 0 || compressed_size >= block_size) {
+            data.insert(data.end(), block_pixels, block_pixels + block_size);
+            block_sizes[block] = (uint32_t)block_size;
+        } else {
+            data.insert(data.end(), compressed.begin(), compressed.begin() + compressed_size);
+            block_sizes[block] = (uint32_t)compressed_size;
+        }
+    }
+
+    if (converted != surface)
+        SDL_DestroySurface(converted);
+
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if ( !file.is_open() )
+        return ResultError("Can't open cooked texture for writing: " + path);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(frames.data()), frames.size() * sizeof(SDL_FRect));
+    file.write(reinterpret_cast<const char*>(block_sizes.data()), block_sizes.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if ( !file.good() )
+        return ResultError("Can't write cooked texture: " + path);
+
+    return ResultOK;
+}
+
+
+/**
+ * Read exactly `size` bytes of `stream` into `out__data`.
+ */
+static bool readExactly(SDL_IOStream* stream, void* out__data, size_t size) {
+    return size == 0 || SDL_ReadIO(stream, out__data, size) == size;
+}
+
+
+/**
+ * Threads to decompress `pixels_size` bytes of blocks on, see
+ * LoadCookedTexture().
+ */
+static unsigned int decodeThreadCount(int decode_threads, size_t pixels_size, size_t block_count) {
+    if (pixels_size < COOKED_TEXTURE_PARALLEL_MIN_SIZE || decode_threads == 1)
+        return 1;
+
+    unsigned int threads = (unsigned int)decode_threads;
+    if (decode_threads <= 0) {
+        threads = std::min(std::thread::hardware_concurrency(), (unsigned int)COOKED_TEXTURE_MAX_DECODE_THREADS);
+    }
+    return std::max(1u, std::min(threads, (unsigned int)block_count));
+}
+
+
+static Result<VoidResult, GameError> readCookedTexture(
+        SDL_IOStream* stream,
+        CookedTexture* out__cooked,
+        int decode_threads
+        ) {
+    CookedTextureHeader header;
+    if ( !readExactly(stream, &header, sizeof(header)) )
+        return ResultError(std::string("Can't read cooked texture: ") + SDL_GetError());
+    if (std::memcmp(header.magic, COOKED_TEXTURE_MAGIC, 4) != 0)
+        return ResultError("Not a cooked texture");
+    if (header.version != COOKED_TEXTURE_VERSION)
+        return ResultError("Unsupported cooked texture version");
+
+    const bool is_header_valid =
+        header.width > 0 && header.width <= COOKED_TEXTURE_MAX_SIZE
+        && header.height > 0 && header.height <= COOKED_TEXTURE_MAX_SIZE
+        && header.block_rows > 0
+        && header.block_count == (header.height + header.block_rows - 1) / header.block_rows
+        && header.frame_count <= COOKED_TEXTURE_MAX_FRAMES
+        && (
+                header.compression == (uint32_t)CookedTextureCompression::NONE
+                || header.compression == (uint32_t)CookedTextureCompression::LZ4
+           );
+    if ( !is_header_valid )
+        return ResultError("Corrupted cooked texture header");
+
+    SDL_Surface* surface = SDL_CreateSurface(
+            (int)header.width, (int)header.height,
+            (SDL_PixelFormat)header.pixel_format
+            );
+    if (surface == NULL)
+        return ResultError(std::string("Can't create cooked texture surface: ") + SDL_GetError());
+    // cooked on another platform or SDL version
+    if ((uint32_t)surface->pitch != header.pitch) {
+        SDL_DestroySurface(surface);
+        return ResultError("Cooked texture pitch doesn't match this platform, cook it again");
+    }
+
+    std::vector<SDL_FRect> frames(header.frame_count);
+    std::vector<uint32_t> block_sizes(header.block_count);
+    if (
+            !readExactly(stream, frames.data(), frames.size() * sizeof(SDL_FRect))
+            || !readExactly(stream, block_sizes.data(), block_sizes.size() * sizeof(uint32_t))
+       ) {
+        SDL_DestroySurface(surface);
+        return ResultError("Truncated cooked texture");
+    }
+
+    uint8_t* pixels = (uint8_t*)surface->pixels;
+    const size_t pixels_size = (size_t)header.height * header.pitch;
+
+    // stored blocks are read straight into the surface
+    if (header.compression == (uint32_t)CookedTextureCompression::NONE) {
+        if ( !readExactly(stream, pixels, pixels_size) ) {
+            SDL_DestroySurface(surface);
+            return ResultError("Truncated cooked texture");
+        }
+        out__cooked->surface = surface;
+        out__cooked->frames.swap(frames);
+        return ResultOK;
+    }
+
+    std::vector<size_t> block_offsets(header.block_count + 1, 0);
+    for (uint32_t block=0; block<header.block_count; ++block)
+        block_offsets[block + 1] = block_offsets[block] + block_sizes[block];
+
+    std::vector<uint8_t> data(block_offsets.back());
+    if ( !readExactly(stream, data.data(), data.size()) ) {
+        SDL_DestroySurface(surface);
+        return ResultError("Truncated cooked texture");
+    }
+
+    // blocks are independent, threads take the next one until none is left
+    std::atomic<size_t> next_block{ 0 };
+    std::atomic<bool> is_corrupted{ false };
+    auto decompress_blocks = [&] () {
+        for (size_t block = next_block++; block < header.block_count && !is_corrupted; block = next_block++) {
+            const size_t first_row = block * header.block_rows;
+            const size_t rows = std::min((size_t)header.block_rows, (size_t)header.height - first_row);
+            uint8_t* block_pixels = pixels + first_row * header.pitch;
+            const size_t block_size = rows * header.pitch;
+            const uint8_t* source = data.data() + block_offsets[block];
+
+            if (block_sizes[block] == block_size) {
+                std::memcpy(block_pixels, source, block_size);
+                continue;
+            }
+            if ( !LZ4DecompressBlock(source, block_sizes[block], block_pixels, block_size) )
+                is_corrupted = true;
+        }
+    };
+
+    // started for this call only, so any thread may load cooked textures
+    std::vector<std::thread> threads;
+    const unsigned int thread_count = decodeThreadCount(decode_threads, pixels_size, header.block_count);
+    for (unsigned int i=1; i<thread_count; ++i)
+        threads.emplace_back(decompress_blocks);
+    decompress_blocks();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (is_corrupted) {
+        SDL_DestroySurface(surface);
+        return ResultError("Corrupted cooked texture block");
+    }
+
+    out__cooked->surface = surface;
+    out__cooked->frames.swap(frames);
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> LoadCookedTexture(
+        SDL_IOStream* stream,
+        bool close_stream,
+        CookedTexture* out__cooked,
+        int decode_threads
+        ) {
+    if (stream == NULL)
+        return ResultError(std::string("Can't open cooked texture: ") + SDL_GetError());
+
+    auto res = readCookedTexture(stream, out__cooked, decode_threads);
+    if (close_stream)
+        SDL_CloseIO(stream);
+    return res;
+}
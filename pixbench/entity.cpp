@@ -9,6 +9,7 @@
 
 EntityManager::EntityManager() {
     this->m_component_manager = new ComponentManager();
+    this->m_last_available_entity_number = 0;
     this->tag.__setEntityInfoArray(this->m_entities);
     this->tag.__setEntityManager(this);
     
@@ -27,6 +28,22 @@ EntityManager::~EntityManager() {
 };
 
 
+// set by ScriptSystem on the threads running parallel script jobs
+static thread_local EntityCommandBuffer* t_command_buffer = nullptr;
+
+
+EntityCommandBuffer* EntityManager::getCommandBuffer() {
+    if (t_command_buffer)
+        return t_command_buffer;
+    return &this->m_command_buffer;
+}
+
+
+void EntityManager::__setThreadCommandBuffer(EntityCommandBuffer* command_buffer) {
+    t_command_buffer = command_buffer;
+}
+
+
 void EntityManager::setComponentRegisterCallback(
         std::function<void(ComponentTag, ComponentType, size_t)> callback_func
         ) {
@@ -41,6 +58,13 @@ void EntityManager::setComponentAddedToEntityCallback(
 }
 
 
+void EntityManager::setComponentRemovedFromEntityCallback(
+        std::function<void(ComponentTag, ComponentType, size_t, EntityID)> callback_func
+        ) {
+    m_component_manager->component_removed_from_entity_callback = callback_func;
+}
+
+
 void EntityManager::setOnEntityDestroyedCallback(
         std::function<void(EntityID entity_id)> callback_func
         ) {
@@ -138,8 +162,13 @@ int EntityTagAPI::getTagIndex(std::string tag) {
 void EntityTagAPI::addTagToEntity(EntityID entity, std::string tag) {
     int tag_index;
     if ( getTagIndex(tag) == -1 ) {
-        tag_index = tag_index_counter;
-        ++tag_index_counter;
+        if ( !m_free_tag_indices.empty() ) {
+            tag_index = m_free_tag_indices.back();
+            m_free_tag_indices.pop_back();
+        } else {
+            tag_index = tag_index_counter;
+            ++tag_index_counter;
+        }
 
         m_tag_to_index_map[tag] = tag_index;
         m_index_to_tag_array[tag_index] = tag;
@@ -183,6 +212,7 @@ void EntityTagAPI::removeTagFromEntity(EntityID entity, std::string tag) {
     int count_ent_with_this_tag = numOfEntityWithTag(tag);
     if (count_ent_with_this_tag == 0) {
         m_tag_to_index_map.erase(tag);
+        m_free_tag_indices.push_back(tag_index);
     }
 }
 
@@ -2,27 +2,63 @@
 #include "pixbench/ecs.h"
 #include "pixbench/systems.h"
 #include "pixbench/engine_config.h"
+#include "pixbench/job_pool.h"
+#include "pixbench/pipeline.h"
+#include "pixbench/render_snapshot.h"
+#include "pixbench/replay.h"
+#include "pixbench/utils/logger.h"
 #include "pixbench/vector2.h"
 #include "SDL3_mixer/SDL_mixer.h"
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_gamepad.h>
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 
 
 Game::Game () 
     : 
     renderContext(nullptr),
+    audioContext(nullptr),
     isRunning(false)
 {
 }
 
 Game::~Game () {
+    if (this->assetLoader) {
+        this->assets.setTextureReloader(nullptr);
+        delete this->assetLoader;
+    }
+    if (this->m_pipeline) {
+        delete this->m_pipeline;
+    }
+    if (this->jobPool) {
+        delete this->jobPool;
+    }
+    if (this->m_replay_recorder) {
+        delete this->m_replay_recorder;
+    }
+    if (this->m_replay_player) {
+        delete this->m_replay_player;
+    }
+    if (this->m_render_snapshot) {
+        delete this->m_render_snapshot;
+    }
+    if (this->entityManager) {
+        delete this->entityManager;
+    }
+    if (this->audioContext) {
+        delete this->audioContext;
+    }
+    __destroyReleasedTextures();
     if (this->renderContext) {
         delete this->renderContext;
     }
@@ -32,7 +68,41 @@ void Game::ApplyGameConfig (GameConfig newConfig) {
     this->gameConfig = newConfig;
 }
 
+static std::vector<std::string> s_command_line_arguments;
+
+
+void Game::SetCommandLineArguments(int argc, char* argv[]) {
+    s_command_line_arguments.assign(argv, argv + argc);
+}
+
+
+void Game::applyCommandLineArguments() {
+    for (size_t i=1; i+1<s_command_line_arguments.size(); ++i) {
+        if (s_command_line_arguments[i] == "--record")
+            this->gameConfig.replay_record_path = s_command_line_arguments[++i];
+        else if (s_command_line_arguments[i] == "--replay")
+            this->gameConfig.replay_path = s_command_line_arguments[++i];
+    }
+}
+
+
 Result<VoidResult, GameError> Game::Initialize() {
+    this->applyCommandLineArguments();
+
+    // Replays run headless, with the recorded seed and frame times
+    if ( !this->gameConfig.replay_path.empty() ) {
+        this->m_replay_player = new ReplayPlayer();
+        auto res = this->m_replay_player->open(this->gameConfig.replay_path);
+        if ( !res.isOk() )
+            return res;
+
+        this->gameConfig.headless = true;
+        if ( !this->gameConfig.replay_record_path.empty() ) {
+            PIXBENCH_LOG_WARNING("Can't record while replaying, GameConfig::replay_record_path is ignored");
+            this->gameConfig.replay_record_path.clear();
+        }
+    }
+
     auto res = PrepareUtils();
     if ( !res.isOk() )
         return res;
@@ -54,6 +124,11 @@ Result<VoidResult, GameError> Game::Initialize() {
     SDL_InitFlags init_flag = SDL_INIT_VIDEO | SDL_INIT_AUDIO;
     if (this->gameConfig.enable_joystick_and_gamepad) 
         init_flag |= SDL_INIT_JOYSTICK | SDL_INIT_GAMEPAD;
+    if (this->gameConfig.headless) {
+        // no video and audio subsystem in headless mode
+        init_flag = SDL_INIT_EVENTS;
+        this->m_use_external_clock = true;
+    }
     if (!SDL_Init(init_flag)) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Can't initialized SDL: %s`", SDL_GetError());
         return Result<VoidResult, GameError>::Err(
@@ -73,8 +148,32 @@ Result<VoidResult, GameError> Game::Initialize() {
     if ( !res.isOk() )
         return res;
 
+    if ( !this->gameConfig.asset_pack_path.empty() ) {
+        res = this->assets.mountPack(this->basePath + this->gameConfig.asset_pack_path, this->basePath);
+        if ( !res.isOk() )
+            return res;
+    }
+    this->assets.setTextureBudget(
+            (size_t)(std::max(this->gameConfig.texture_budget_mb, 0.0) * 1024.0 * 1024.0),
+            (uint64_t)std::max(this->gameConfig.texture_evict_after_frames, 1)
+            );
+
     this->entityManager = new EntityManager();
     this->entityManager->game = this;
+
+    size_t job_pool_threads = 0;
+    if (this->gameConfig.job_pool_threads >= 0) {
+        job_pool_threads = (size_t)this->gameConfig.job_pool_threads;
+    } else if (std::thread::hardware_concurrency() > 1) {
+        job_pool_threads = std::thread::hardware_concurrency() - 1;
+    }
+    this->jobPool = new JobPool(job_pool_threads);
+    this->assetLoader = new AssetLoader(
+            &this->assets,
+            this->renderContext->renderer,
+            (size_t)std::max(this->gameConfig.asset_loader_threads, 1)
+            );
+    this->assets.setTextureReloader(this->assetLoader);
     this->entityManager->setComponentAddedToEntityCallback(
             [this] (ComponentTag ctag, ComponentType ctype, size_t cindex, EntityID ent_id)
             {
@@ -85,6 +184,16 @@ Result<VoidResult, GameError> Game::Initialize() {
             this->OnComponentAddedToEntity(payload, ent_id);
             }
             );
+    this->entityManager->setComponentRemovedFromEntityCallback(
+            [this] (ComponentTag ctag, ComponentType ctype, size_t cindex, EntityID ent_id)
+            {
+            ComponentDataPayload payload;
+            payload.ctag = ctag;
+            payload.ctype = ctype;
+            payload.cindex = cindex;
+            this->OnComponentRemovedFromEntity(payload, ent_id);
+            }
+            );
     this->entityManager->setComponentRegisterCallback(
             [this] (ComponentTag ctag, ComponentType ctype, size_t cindex) 
             {
@@ -102,10 +211,11 @@ Result<VoidResult, GameError> Game::Initialize() {
             }
             );
 
+    this->renderingSystem = std::make_shared<RenderingSystem>();
     this->hierarchySystem = std::make_shared<HierarchySystem>();
     this->scriptSystem = std::make_shared<ScriptSystem>();
     this->physicsSystem = std::make_shared<PhysicsSystem>();
-    this->ecs_systems.push_back(std::make_shared<RenderingSystem>());
+    this->ecs_systems.push_back(renderingSystem);
     this->ecs_systems.push_back(std::make_shared<AudioSystem>());
     this->ecs_systems.push_back(hierarchySystem);
     this->ecs_systems.push_back(scriptSystem);
@@ -122,12 +232,40 @@ Result<VoidResult, GameError> Game::Initialize() {
     // Physics
     this->physics.__setGame(this);
 
+    // Start counting from now, so the first frame doesn't catch up on the
+    // time spent before the game is initialized
+    this->lastTicksU__ns = this->GetTicksNS();
+    this->lastTicksFU__ns = this->lastTicksU__ns;
+    this->lastTicksLU__ns = this->lastTicksU__ns;
+
+    // Rendering
+    if (this->gameConfig.pipelined_rendering && !this->gameConfig.headless) {
+        std::static_pointer_cast<RenderingSystem>(this->renderingSystem)->__setRecordingOffMainThread(true);
+        this->m_pipeline = new FramePipeline(this);
+        this->m_pipeline->start();
+    } else {
+        this->m_render_snapshot = new RenderSnapshot();
+    }
+
+    if ( !this->gameConfig.replay_record_path.empty() ) {
+        this->m_replay_recorder = new ReplayRecorder();
+        res = this->m_replay_recorder->open(
+                this->gameConfig.replay_record_path,
+                GetRandomGeneratorSeed()
+                );
+        if ( !res.isOk() )
+            return res;
+    }
+
     return Result<VoidResult, GameError>::Ok(VoidResult::empty);
 }
 
 Result<VoidResult, GameError> Game:: PrepareUtils() {
-    // Prepare for random number generator
-    // PrepareRandomGenerator();
+    // Prepare for random number generator, replays reuse the recorded seed
+    if (this->m_replay_player)
+        PrepareRandomGenerator(this->m_replay_player->getRandomSeed());
+    else if (this->gameConfig.random_seed != 0)
+        PrepareRandomGenerator(this->gameConfig.random_seed);
 
     // Base path of the executable
     const char* base_path_cstr = SDL_GetBasePath();
@@ -150,6 +288,16 @@ Result<VoidResult, GameError> Game::PrepareRenderer(int windowWidth, int windowH
                 GameError("PrepareRenderer() failed, renderContext already initialized")
                 );
     }
+
+    if (this->gameConfig.headless) {
+        this->renderContext = new RenderContext(
+                Vector2(windowWidth, windowHeight),
+                Vector2(0.0, 0.0),
+                Vector2(windowWidth, windowHeight)
+                );
+        return ResultOK;
+    }
+
     this->renderContext = new RenderContext(
             this->gameConfig.game_title.c_str(),
             Vector2(windowWidth, windowHeight),
@@ -175,9 +323,14 @@ Result<VoidResult, GameError> Game::PrepareRenderer(int windowWidth, int windowH
 Void Game::PrepareAudio() {
     // Create audioContext object
     this->audioContext = new AudioContext(
-            AUDIO_NUM_CHANNELS
+            AUDIO_NUM_CHANNELS,
+            this->gameConfig.headless
             );
 
+    // Null audio backend doesn't need SDL_mixer
+    if (this->gameConfig.headless)
+        return ResultOK;
+
     // Initalize SDL_mixer
     MIX_InitFlags mix_init_res = Mix_Init(AUDIO_MIX_INIT_FLAGS);
     if ( !mix_init_res ) {
@@ -201,30 +354,99 @@ void Game::OnComponentRegistered(ComponentDataPayload component_payload) {
 
 
 void Game::OnComponentAddedToEntity(ComponentDataPayload component_payload, EntityID entity_id) {
+    this->m_has_added_components = true;
     for (auto& system : this->ecs_systems) {
         system->OnComponentAddedToEntity(&component_payload, entity_id);
     }
 }
 
 
+void Game::OnComponentRemovedFromEntity(ComponentDataPayload component_payload, EntityID entity_id) {
+    for (auto& system : this->ecs_systems) {
+        system->OnComponentRemovedFromEntity(&component_payload, entity_id);
+    }
+}
+
+
 void Game::OnEntityDestroyed(EntityID entity_id) {
     for (auto& system : this->ecs_systems) {
         system->OnEntityDestroyed(this->entityManager, entity_id);
     }
+    this->timers.__cancelEntityTimers(entity_id);
 }
 
 
 Result<VoidResult, GameError> Game::OnEvent(SDL_Event *event) {
-    std::cout << "Game::OnEvent called" << std::endl;
+    PIXBENCH_LOG_TRACE("Game::OnEvent called");
     // if (event->type == SDL_EVENT_QUIT) {
     //     // return SDL_APP_SUCCESS;  /* end the program, reporting success to the OS. */
     //     this->Quit();
     // }
 
-    double lastTicks = this->lastTicksU__ns;
+    // The replay is the only input, but still let the user quit
+    if (this->m_replay_player) {
+        if (event->type == SDL_EVENT_QUIT)
+            this->Quit();
+        return ResultOK;
+    }
+
+    // SDL_Renderer functions are main thread only, do it before queueing
+    if (this->renderContext->renderer)
+        SDL_ConvertEventToRenderCoordinates(this->renderContext->renderer, event);
+
+    if (event->type == SDL_EVENT_GAMEPAD_ADDED) {
+        // gamepads only report events once opened, SDL closes them on SDL_Quit
+        if ( !SDL_OpenGamepad(event->gdevice.which) ) {
+            PIXBENCH_LOG_WARNING("Can't open gamepad {}, SDL error: {}", event->gdevice.which, SDL_GetError());
+        }
+    } else if (event->type == SDL_EVENT_GAMEPAD_REMOVED) {
+        SDL_Gamepad* gamepad = SDL_GetGamepadFromID(event->gdevice.which);
+        if (gamepad)
+            SDL_CloseGamepad(gamepad);
+    }
+
+    // Systems run on the simulation thread, handle it with the next frame
+    if (this->m_pipeline) {
+        this->m_pipeline->queueEvent(event);
+        return ResultOK;
+    }
 
-    // Let the system handle the event
+    return this->dispatchEvent(event);
+}
+
+
+void Game::subscribeSystemsEvents() {
+    this->m_system_event_registry.clear();
     for (auto& system : this->ecs_systems) {
+        EventRegistry<ISystem*>::Subscription subscription(
+                &this->m_system_event_registry, system.get()
+                );
+        system->SubscribeEvents(&subscription);
+    }
+
+    this->m_is_system_event_registry_dirty = false;
+    this->m_system_event_registry_size = this->ecs_systems.size();
+}
+
+
+Result<VoidResult, GameError> Game::dispatchEvent(SDL_Event *event) {
+    if (this->m_replay_recorder)
+        this->m_replay_recorder->recordEvent(event);
+    this->input.__handleEvent(event);
+
+    if (
+            this->m_is_system_event_registry_dirty
+            || this->m_system_event_registry_size != this->ecs_systems.size()
+       ) {
+        this->subscribeSystemsEvents();
+    }
+
+    // Let the subscribed systems handle the event
+    for (auto& entry : this->m_system_event_registry.subscribersOf(event->type)) {
+        ISystem* system = entry.subscriber;
+        if ( !system->schedule.enabled )
+            continue;
+
         auto res = system->OnEvent(event, this->entityManager);
         if ( !res.isOk() )
             return res;
@@ -233,72 +455,315 @@ Result<VoidResult, GameError> Game::OnEvent(SDL_Event *event) {
     return ResultOK;
 }
 
-Result<VoidResult, GameError> Game::Itterate() {
-    double now_ns = ((double)SDL_GetTicksNS());
+double Game::GetTicksNS() {
+    if (this->m_use_external_clock)
+        return this->m_external_clock_ns;
+
+    return ((double)SDL_GetTicksNS());
+}
+
+
+Result<VoidResult, GameError> Game::Step(double delta_time_s) {
+    this->AdvanceClock(delta_time_s);
+    return this->Itterate();
+}
+
+
+/*
+ * Wall-clock seconds elapsed since `start_counter`, used for FrameStats.
+ */
+static double secondsSince(Uint64 start_counter) {
+    return (double)(SDL_GetPerformanceCounter() - start_counter)
+        / (double)SDL_GetPerformanceFrequency();
+}
+
+
+void Game::finishAssetLoads(FrameStats* stats) {
+    const Uint64 upload_start = SDL_GetPerformanceCounter();
+    this->assetLoader->update(this->gameConfig.asset_upload_budget_ms / 1000.0);
+    stats->asset_upload_s = secondsSince(upload_start);
+}
+
+
+void Game::storePreviousTransforms() {
+    for (EntityID ent_id : EntityViewByTypes<Transform>(this->entityManager)) {
+        Transform* transform = this->entityManager->getEntityComponent<Transform>(ent_id);
+        transform->__storePreviousState();
+    }
+}
+
+
+void Game::storeFixedStepTransforms() {
+    for (EntityID ent_id : EntityViewByTypes<Transform>(this->entityManager)) {
+        Transform* transform = this->entityManager->getEntityComponent<Transform>(ent_id);
+        transform->__storeFixedStepState();
+    }
+}
+
+
+static bool isSystemPriorityLower(const std::shared_ptr<ISystem>& a, const std::shared_ptr<ISystem>& b) {
+    return a->schedule.priority < b->schedule.priority;
+}
+
+
+Result<VoidResult, GameError> Game::RegisterSystem(
+        std::shared_ptr<ISystem> system,
+        unsigned int phases,
+        int priority
+        ) {
+    if ( !this->entityManager ) {
+        return ResultError("Can't register a system before Game::Initialize() is called");
+    }
+    if ( !system ) {
+        return ResultError("Can't register a null system");
+    }
+    if (
+            std::find(this->ecs_systems.begin(), this->ecs_systems.end(), system) != this->ecs_systems.end()
+            || std::find(this->m_pending_systems.begin(), this->m_pending_systems.end(), system) != this->m_pending_systems.end()
+       ) {
+        return ResultError("System is already registered");
+    }
+
+    system->schedule.phases = phases;
+    system->schedule.priority = priority;
+    this->m_pending_systems.push_back(system);
+    return ResultOK;
+}
+
+
+void Game::addPendingSystems() {
+    if (this->m_pending_systems.empty())
+        return;
+
+    for (auto& system : this->m_pending_systems) {
+        this->ecs_systems.push_back(system);
+
+        // catch up on the components engine systems were told about
+        ISystem* new_system = system.get();
+        this->entityManager->__forEachRegisteredComponent(
+                [new_system] (ComponentTag ctag, ComponentType ctype, size_t cindex)
+                {
+                ComponentDataPayload payload;
+                payload.ctag = ctag;
+                payload.ctype = ctype;
+                payload.cindex = cindex;
+                new_system->OnComponentRegistered(&payload);
+                }
+                );
+    }
+    this->m_pending_systems.clear();
+
+    // resorted and subscribed to events before the frame runs
+    this->m_is_system_event_registry_dirty = true;
+}
+
+
+void Game::sortSystemsByPriority() {
+    // priorities rarely change, only pay for the sort when they did
+    if (std::is_sorted(this->ecs_systems.begin(), this->ecs_systems.end(), isSystemPriorityLower))
+        return;
+
+    std::stable_sort(this->ecs_systems.begin(), this->ecs_systems.end(), isSystemPriorityLower);
+    this->m_is_system_event_registry_dirty = true;
+}
+
+
+Result<VoidResult, GameError> Game::runSimulation(FrameStats* stats) {
+    double now_ns = this->GetTicksNS();
     double delta_time_s = (now_ns - this->lastTicksU__ns) / 1000000000.0;
 
     // std::cout << "Game::Itterate called (" << delta_time_s << ")" << std::endl;
 
+    if (this->m_replay_recorder) {
+        auto record_res = this->m_replay_recorder->recordFrame(delta_time_s);
+        if ( !record_res.isOk() ) {
+            // losing the recording isn't worth stopping the game
+            PIXBENCH_LOG_ERROR("{}", record_res.getErrResult()->err_message);
+            delete this->m_replay_recorder;
+            this->m_replay_recorder = nullptr;
+        }
+    }
+
     Result<VoidResult, GameError> res;
+    Uint64 phase_start = SDL_GetPerformanceCounter();
+
+    this->addPendingSystems();
+    this->sortSystemsByPriority();
+    this->input.__beginFrame(this->renderContext);
 
     // TO DO: Init cascade
+    // Systems only set up new entities and components, skip them when there
+    // are none (except for their first call)
+    const bool has_new_entities = this->entityManager->hasUninitializedEntities();
+    const bool has_new_components = this->m_has_added_components;
+    this->m_has_added_components = false;
     for (auto& system : this->ecs_systems) {
+        if ( !system->schedule.enabled )
+            continue;
+        if ( !has_new_entities && !has_new_components && !system->schedule.__needsFirstInitialize() )
+            continue;
+
         res = system->Initialize(this, this->entityManager);
         if ( !res.isOk() ) {
             return res;
         }
+        system->schedule.__setInitialized();
     }
-    this->entityManager->resetEntitiesUninitializedStatus();
+    if (has_new_entities)
+        this->entityManager->resetEntitiesUninitializedStatus();
+    stats->init_s = secondsSince(phase_start);
     
 
     // TO DO: Update cascade
+    phase_start = SDL_GetPerformanceCounter();
     for (auto& system : this->ecs_systems) {
-        res = system->Update(delta_time_s, this->entityManager);
+        system->schedule.__beginFrame(delta_time_s);
+        if ( !system->schedule.isTicking() || !system->schedule.runsPhase(SYSTEM_PHASE_UPDATE) )
+            continue;
+
+        const double system_delta_time_s = system->schedule.isThrottled()
+            ? system->schedule.tickDelta()
+            : delta_time_s;
+        res = system->Update(system_delta_time_s, this->entityManager);
         if ( !res.isOk() ) {
             return res;
         }
     }
-    this->lastTicksU__ns = now_ns;
 
-    // TO DO: FixedUpdate cascade, `while update is due`
-    // while (not is_deadline_been_made()) {
-    //      FixedUpdate();
-    // }
-    while ( this->lastTicksFU__ns < now_ns ) {
-        delta_time_s = 1.0/((double)FIXED_UPDATE_RATE);
+    res = this->timers.__advance(delta_time_s);
+    if ( !res.isOk() ) {
+        return res;
+    }
+    this->entityManager->__playbackCommands();
+    this->lastTicksU__ns = now_ns;
+    stats->update_s = secondsSince(phase_start);
+
+    // FixedUpdate cascade, consume the elapsed time in fixed steps, but no
+    // more than `fixed_update_max_steps` per frame
+    phase_start = SDL_GetPerformanceCounter();
+    const double fixed_delta_time_s = 1.0/((double)FIXED_UPDATE_RATE);
+    this->m_fixed_update_accumulator_s += (now_ns - this->lastTicksFU__ns) / 1000000000.0;
+    this->lastTicksFU__ns = now_ns;
+
+    int fixed_steps = 0;
+    while (
+            this->m_fixed_update_accumulator_s >= fixed_delta_time_s
+            && fixed_steps < this->gameConfig.fixed_update_max_steps
+          ) {
+        this->storePreviousTransforms();
 
         for (auto& system : this->ecs_systems) {
-            res = system->FixedUpdate(delta_time_s, this->entityManager);
+            if ( !system->schedule.runsPhase(SYSTEM_PHASE_FIXED_UPDATE) )
+                continue;
+
+            res = system->FixedUpdate(fixed_delta_time_s, this->entityManager);
             if ( !res.isOk() ) {
                 return res;
             }
         }
+        this->entityManager->__playbackCommands();
 
-        now_ns = ((double)SDL_GetTicksNS());
-        this->lastTicksFU__ns += delta_time_s*1000000000.0;
+        this->m_fixed_update_accumulator_s -= fixed_delta_time_s;
+        ++fixed_steps;
+    }
+    // later writes (LateUpdate, next frames' Update) stop the interpolation
+    if (fixed_steps > 0)
+        this->storeFixedStepTransforms();
+
+    // Too far behind, drop the remaining whole steps instead of catching up
+    // on the next frames
+    if (this->m_fixed_update_accumulator_s >= fixed_delta_time_s) {
+        const double dropped_s = this->m_fixed_update_accumulator_s
+            - std::fmod(this->m_fixed_update_accumulator_s, fixed_delta_time_s);
+        this->m_fixed_update_accumulator_s -= dropped_s;
+        stats->fixed_update_dropped_s = dropped_s;
     }
 
+    this->fixedUpdateAlpha = 1.0;
+    if (this->gameConfig.render_interpolation_enabled)
+        this->fixedUpdateAlpha = this->m_fixed_update_accumulator_s / fixed_delta_time_s;
+    this->renderContext->interpolation_alpha = this->fixedUpdateAlpha;
+
+    stats->fixed_update_steps = fixed_steps;
+    stats->fixed_update_s = secondsSince(phase_start);
+
     // TO DO: LateUpdate cascade
-    now_ns = ((double)SDL_GetTicksNS());
+    phase_start = SDL_GetPerformanceCounter();
+    now_ns = this->GetTicksNS();
     delta_time_s = (now_ns - this->lastTicksLU__ns) / 1000000000.0;
     for (auto& system : this->ecs_systems) {
-        res = system->LateUpdate(delta_time_s, this->entityManager);
+        if ( !system->schedule.isTicking() || !system->schedule.runsPhase(SYSTEM_PHASE_LATE_UPDATE) )
+            continue;
+
+        const double system_delta_time_s = system->schedule.isThrottled()
+            ? system->schedule.tickDelta()
+            : delta_time_s;
+        res = system->LateUpdate(system_delta_time_s, this->entityManager);
         if ( !res.isOk() ) {
             return res;
         }
     }
+    this->entityManager->__playbackCommands();
     this->lastTicksLU__ns = now_ns;
+    stats->late_update_s = secondsSince(phase_start);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> Game::runPreDraw(FrameStats* stats) {
+    const Uint64 phase_start = SDL_GetPerformanceCounter();
+    for (auto& system : this->ecs_systems) {
+        if ( !system->schedule.runsPhase(SYSTEM_PHASE_DRAW) )
+            continue;
+
+        auto res = system->PreDraw(
+                this->renderContext,
+                this->entityManager
+                );
+        if ( !res.isOk() ) {
+            return res;
+        }
+    }
+    stats->pre_draw_s = secondsSince(phase_start);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> Game::recordDraw(RenderSnapshot* snapshot) {
+    snapshot->clear();
+    snapshot->captureContext(this->renderContext);
+
+    for (auto& system : this->ecs_systems) {
+        if ( !system->schedule.runsPhase(SYSTEM_PHASE_DRAW) )
+            continue;
+
+        auto res = system->RecordDraw(
+                snapshot,
+                this->renderContext,
+                this->entityManager
+                );
+        if ( !res.isOk() ) {
+            return res;
+        }
+    }
+
+    return ResultOK;
+}
 
 
+Result<VoidResult, GameError> Game::submitFrame(RenderSnapshot* snapshot, bool call_systems_draw, FrameStats* stats) {
     bool is_success;
 
     // Clear screen before render
+    Uint64 phase_start = SDL_GetPerformanceCounter();
     is_success = SDL_SetRenderDrawColor(
             this->renderContext->renderer,
-            this->renderContext->renderClearColor.r,
-            this->renderContext->renderClearColor.g,
-            this->renderContext->renderClearColor.b,
-            this->renderContext->renderClearColor.a
+            snapshot->clear_color.r,
+            snapshot->clear_color.g,
+            snapshot->clear_color.b,
+            snapshot->clear_color.a
             );
     if ( !is_success ) {
         std::string err_msg =
@@ -319,30 +784,28 @@ Result<VoidResult, GameError> Game::Itterate() {
                 );
     }
 
-    // TO DO: PreDraw Calls
-    for (auto& system : this->ecs_systems) {
-        res = system->PreDraw(
-                this->renderContext,
-                this->entityManager
-                );
-        if ( !res.isOk() ) {
-            return res;
-        }
-    }
+    auto res = snapshot->submit(this->renderContext, this->entityManager, &this->assets);
+    if ( !res.isOk() )
+        return res;
 
-    // TO DO: Render ordering based on depth value (Int32)
-    // TO DO: Draw Calls (draw from back to front, largest depth value to smallest)
-    for (auto& system : this->ecs_systems) {
-        res = system->Draw(
-                this->renderContext,
-                this->entityManager
-                );
-        if ( !res.isOk() ) {
-            return res;
+    if (call_systems_draw) {
+        for (auto& system : this->ecs_systems) {
+            if ( !system->schedule.runsPhase(SYSTEM_PHASE_DRAW) )
+                continue;
+
+            res = system->Draw(
+                    this->renderContext,
+                    this->entityManager
+                    );
+            if ( !res.isOk() ) {
+                return res;
+            }
         }
     }
+    stats->draw_s += secondsSince(phase_start);
 
     // Screen Update (flip the screen)
+    phase_start = SDL_GetPerformanceCounter();
     is_success = SDL_RenderPresent(this->renderContext->renderer);
     if ( !is_success ) {
         std::string err_message =
@@ -352,12 +815,146 @@ Result<VoidResult, GameError> Game::Itterate() {
                 err_message
                 );
     }
+    stats->present_s = secondsSince(phase_start);
 
+    // textures whose last reference the simulation thread dropped
+    __destroyReleasedTextures();
+
+    // the textures drawn this frame are known now
+    phase_start = SDL_GetPerformanceCounter();
+    this->assets.updateTextureResidency();
+    stats->texture_residency_s = secondsSince(phase_start);
 
     return ResultOK;
 }
 
 
+Result<VoidResult, GameError> Game::SimulateFrame(
+        std::vector<SDL_Event>& events,
+        RenderSnapshot* snapshot,
+        FrameStats* stats
+        ) {
+    const Uint64 frame_start = SDL_GetPerformanceCounter();
+
+    for (SDL_Event& event : events) {
+        auto res = this->dispatchEvent(&event);
+        if ( !res.isOk() )
+            return res;
+    }
+
+    auto res = this->runSimulation(stats);
+    if ( !res.isOk() )
+        return res;
+
+    res = this->runPreDraw(stats);
+    if ( !res.isOk() )
+        return res;
+
+    const Uint64 record_start = SDL_GetPerformanceCounter();
+    res = this->recordDraw(snapshot);
+    if ( !res.isOk() )
+        return res;
+    stats->draw_s = secondsSince(record_start);
+    stats->frame_s = secondsSince(frame_start);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> Game::Itterate() {
+    if (this->m_replay_player)
+        return this->itterateReplay();
+    if (this->m_pipeline)
+        return this->itteratePipelined();
+
+    return this->itterateSerial();
+}
+
+
+Result<VoidResult, GameError> Game::itterateSerial() {
+    this->frameStats = FrameStats();
+    const Uint64 frame_start = SDL_GetPerformanceCounter();
+
+    this->finishAssetLoads(&this->frameStats);
+
+    auto res = this->runSimulation(&this->frameStats);
+    if ( !res.isOk() )
+        return res;
+
+    res = this->runPreDraw(&this->frameStats);
+    if ( !res.isOk() )
+        return res;
+
+    // Headless: only run PreDraw (visibility and ordering), nothing to draw on
+    if (this->renderContext->isHeadless()) {
+        this->frameStats.frame_s = secondsSince(frame_start);
+        return ResultOK;
+    }
+
+    const Uint64 record_start = SDL_GetPerformanceCounter();
+    res = this->recordDraw(this->m_render_snapshot);
+    if ( !res.isOk() )
+        return res;
+    this->frameStats.draw_s = secondsSince(record_start);
+
+    res = this->submitFrame(this->m_render_snapshot, true, &this->frameStats);
+    if ( !res.isOk() )
+        return res;
+    this->frameStats.frame_s = secondsSince(frame_start);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> Game::itterateReplay() {
+    bool has_frame = false;
+    double delta_time_s = 0.0;
+    auto res = this->m_replay_player->readFrame(&has_frame, &delta_time_s, this->m_replay_events);
+    if ( !res.isOk() )
+        return res;
+
+    if ( !has_frame ) {
+        PIXBENCH_LOG_INFO(
+                "Replay of {} finished: {}",
+                this->gameConfig.replay_path,
+                this->m_replay_player->summarizeFrameTimes()
+                );
+        this->Quit();
+        return ResultOK;
+    }
+
+    for (SDL_Event& event : this->m_replay_events) {
+        res = this->dispatchEvent(&event);
+        if ( !res.isOk() )
+            return res;
+    }
+
+    this->AdvanceClock(delta_time_s);
+    res = this->itterateSerial();
+    if ( !res.isOk() )
+        return res;
+
+    this->m_replay_player->addFrameTime(this->frameStats.frame_s);
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> Game::itteratePipelined() {
+    // frame N was simulated while frame N-1 was submitted
+    auto res = this->m_pipeline->waitForFrame();
+    if ( !res.isOk() )
+        return res;
+    this->frameStats = this->m_pipeline->frameStats();
+
+    // between simulated frames, so load callbacks can touch entities
+    this->finishAssetLoads(&this->frameStats);
+
+    // simulate frame N+1 while submitting frame N
+    this->m_pipeline->requestFrame();
+    return this->submitFrame(this->m_pipeline->frontSnapshot(), false, &this->frameStats);
+}
+
+
 void Game::Quit () {
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Game::Quit Called");
     this->isRunning = false;
@@ -365,6 +962,19 @@ void Game::Quit () {
 
 
 void Game::OnExit() {
+    // let the simulation thread finish its frame before tearing down
+    if (this->m_pipeline)
+        this->m_pipeline->stop();
+
+    if (this->m_replay_recorder) {
+        PIXBENCH_LOG_INFO(
+                "Recorded {} frames to {}",
+                this->m_replay_recorder->getFrameCount(),
+                this->gameConfig.replay_record_path
+                );
+        this->m_replay_recorder->close();
+    }
+
     // destroy all entities (along it's components)
     this->entityManager->destroyAllEntities();
 
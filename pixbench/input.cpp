@@ -0,0 +1,342 @@
+#include "pixbench/input.h"
+#include "pixbench/renderer.h"
+#include "pixbench/utils/logger.h"
+#include <SDL3/SDL_events.h>
+#include <algorithm>
+
+
+// ===================== Input Snapshot =====================
+
+
+void InputSnapshot::clearEdges() {
+    keys_pressed.reset();
+    keys_released.reset();
+    mouse_buttons_pressed = 0;
+    mouse_buttons_released = 0;
+    mouse_motion = Vector2::ZERO;
+    mouse_wheel = Vector2::ZERO;
+    quit_requested = false;
+
+    for (size_t slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+        gamepad_buttons_pressed[slot].reset();
+        gamepad_buttons_released[slot].reset();
+        for (size_t axis=0; axis<SDL_GAMEPAD_AXIS_COUNT; ++axis)
+            gamepad_axes_previous[slot][axis] = gamepad_axes[slot][axis];
+    }
+}
+
+
+// ===================== Input Action Map =====================
+
+
+InputActionID InputActionMap::addAction(const std::string& name) {
+    auto id_pair = m_ids.find(name);
+    if (id_pair != m_ids.end())
+        return id_pair->second;
+
+    InputActionID action = m_names.size();
+    m_names.push_back(name);
+    m_bindings.push_back(std::vector<InputBinding>());
+    m_ids[name] = action;
+    return action;
+}
+
+
+bool InputActionMap::getActionID(const std::string& name, InputActionID* out__action) const {
+    auto id_pair = m_ids.find(name);
+    if (id_pair == m_ids.end())
+        return false;
+
+    *out__action = id_pair->second;
+    return true;
+}
+
+
+void InputActionMap::bindKey(InputActionID action, SDL_Scancode scancode) {
+    InputBinding binding;
+    binding.tag = IBIND_Key;
+    binding.code = (int)scancode;
+    m_bindings[action].push_back(binding);
+}
+
+
+void InputActionMap::bindMouseButton(InputActionID action, Uint8 button) {
+    InputBinding binding;
+    binding.tag = IBIND_MouseButton;
+    binding.code = (int)button;
+    m_bindings[action].push_back(binding);
+}
+
+
+void InputActionMap::bindGamepadButton(InputActionID action, SDL_GamepadButton button) {
+    InputBinding binding;
+    binding.tag = IBIND_GamepadButton;
+    binding.code = (int)button;
+    m_bindings[action].push_back(binding);
+}
+
+
+void InputActionMap::bindGamepadAxis(InputActionID action, SDL_GamepadAxis axis, bool positive, float deadzone) {
+    InputBinding binding;
+    binding.tag = positive ? IBIND_GamepadAxisPositive : IBIND_GamepadAxisNegative;
+    binding.code = (int)axis;
+    binding.deadzone = std::min(std::max(deadzone, 0.0f), 0.99f);
+    m_bindings[action].push_back(binding);
+}
+
+
+void InputActionMap::clearBindings(InputActionID action) {
+    m_bindings[action].clear();
+}
+
+
+/*
+ * Value of `binding` from 0.0 to 1.0, for the previous frame if `previous`
+ * (only needed to find edges of axis bindings).
+ */
+float InputActionMap::bindingValue(const InputBinding& binding, const InputSnapshot& snapshot, bool previous) const {
+    switch (binding.tag) {
+        case IBIND_Key:
+            return snapshot.keys_down[binding.code] ? 1.0f : 0.0f;
+        case IBIND_MouseButton:
+            return (snapshot.mouse_buttons_down & SDL_BUTTON_MASK(binding.code)) ? 1.0f : 0.0f;
+        case IBIND_GamepadButton:
+            for (size_t slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+                if (snapshot.gamepad_buttons_down[slot][binding.code])
+                    return 1.0f;
+            }
+            return 0.0f;
+        case IBIND_GamepadAxisPositive:
+        case IBIND_GamepadAxisNegative:
+            {
+            float value = 0.0f;
+            for (size_t slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+                float axis_value = previous
+                    ? snapshot.gamepad_axes_previous[slot][binding.code]
+                    : snapshot.gamepad_axes[slot][binding.code];
+                if (binding.tag == IBIND_GamepadAxisNegative)
+                    axis_value = -axis_value;
+                if (axis_value <= binding.deadzone)
+                    continue;
+                value = std::max(value, (axis_value - binding.deadzone) / (1.0f - binding.deadzone));
+            }
+            return std::min(value, 1.0f);
+            }
+    }
+
+    return 0.0f;
+}
+
+
+float InputActionMap::getActionValue(InputActionID action, const InputSnapshot& snapshot) const {
+    float value = 0.0f;
+    for (const InputBinding& binding : m_bindings[action])
+        value = std::max(value, bindingValue(binding, snapshot, false));
+    return value;
+}
+
+
+bool InputActionMap::isActionDown(InputActionID action, const InputSnapshot& snapshot) const {
+    return getActionValue(action, snapshot) > 0.0f;
+}
+
+
+bool InputActionMap::isActionPressed(InputActionID action, const InputSnapshot& snapshot) const {
+    bool is_down = false;
+    bool was_down = false;
+    for (const InputBinding& binding : m_bindings[action]) {
+        switch (binding.tag) {
+            case IBIND_Key:
+                is_down |= snapshot.keys_down[binding.code];
+                was_down |= snapshot.keys_down[binding.code] && !snapshot.keys_pressed[binding.code];
+                break;
+            case IBIND_MouseButton:
+                {
+                const Uint32 mask = SDL_BUTTON_MASK(binding.code);
+                is_down |= (snapshot.mouse_buttons_down & mask) != 0;
+                was_down |= (snapshot.mouse_buttons_down & mask) && !(snapshot.mouse_buttons_pressed & mask);
+                break;
+                }
+            case IBIND_GamepadButton:
+                for (size_t slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+                    is_down |= snapshot.gamepad_buttons_down[slot][binding.code];
+                    was_down |= snapshot.gamepad_buttons_down[slot][binding.code]
+                        && !snapshot.gamepad_buttons_pressed[slot][binding.code];
+                }
+                break;
+            case IBIND_GamepadAxisPositive:
+            case IBIND_GamepadAxisNegative:
+                is_down |= bindingValue(binding, snapshot, false) > 0.0f;
+                was_down |= bindingValue(binding, snapshot, true) > 0.0f;
+                break;
+        }
+    }
+
+    // pressed if any binding went down while no binding was down before
+    return is_down && !was_down;
+}
+
+
+bool InputActionMap::isActionReleased(InputActionID action, const InputSnapshot& snapshot) const {
+    bool is_down = false;
+    bool was_down = false;
+    for (const InputBinding& binding : m_bindings[action]) {
+        switch (binding.tag) {
+            case IBIND_Key:
+                is_down |= snapshot.keys_down[binding.code];
+                was_down |= snapshot.keys_released[binding.code]
+                    || (snapshot.keys_down[binding.code] && !snapshot.keys_pressed[binding.code]);
+                break;
+            case IBIND_MouseButton:
+                {
+                const Uint32 mask = SDL_BUTTON_MASK(binding.code);
+                is_down |= (snapshot.mouse_buttons_down & mask) != 0;
+                was_down |= (snapshot.mouse_buttons_released & mask)
+                    || ((snapshot.mouse_buttons_down & mask) && !(snapshot.mouse_buttons_pressed & mask));
+                break;
+                }
+            case IBIND_GamepadButton:
+                for (size_t slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+                    is_down |= snapshot.gamepad_buttons_down[slot][binding.code];
+                    was_down |= snapshot.gamepad_buttons_released[slot][binding.code]
+                        || (snapshot.gamepad_buttons_down[slot][binding.code]
+                                && !snapshot.gamepad_buttons_pressed[slot][binding.code]);
+                }
+                break;
+            case IBIND_GamepadAxisPositive:
+            case IBIND_GamepadAxisNegative:
+                is_down |= bindingValue(binding, snapshot, false) > 0.0f;
+                was_down |= bindingValue(binding, snapshot, true) > 0.0f;
+                break;
+        }
+    }
+
+    return was_down && !is_down;
+}
+
+
+float InputActionMap::getAxis(InputActionID negative, InputActionID positive, const InputSnapshot& snapshot) const {
+    return getActionValue(positive, snapshot) - getActionValue(negative, snapshot);
+}
+
+
+// ===================== Input =====================
+
+
+/*
+ * Slot of `gamepad_id` in the snapshot, -1 if it has none and `assign` is
+ * `false` or all slots are taken.
+ */
+int Input::gamepadSlot(SDL_JoystickID gamepad_id, bool assign) {
+    for (int slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+        if (m_next.gamepad_ids[slot] == gamepad_id)
+            return slot;
+    }
+    if ( !assign )
+        return -1;
+
+    for (int slot=0; slot<INPUT_MAX_GAMEPADS; ++slot) {
+        if (m_next.gamepad_ids[slot] == 0) {
+            m_next.gamepad_ids[slot] = gamepad_id;
+            return slot;
+        }
+    }
+
+    PIXBENCH_LOG_WARNING("Input: more than {} gamepads connected, gamepad {} is ignored", INPUT_MAX_GAMEPADS, gamepad_id);
+    return -1;
+}
+
+
+void Input::__handleEvent(const SDL_Event* event) {
+    switch (event->type) {
+        case SDL_EVENT_QUIT:
+            m_next.quit_requested = true;
+            break;
+        case SDL_EVENT_KEY_DOWN:
+            if (event->key.repeat || event->key.scancode >= SDL_SCANCODE_COUNT)
+                break;
+            m_next.keys_pressed.set(event->key.scancode);
+            m_next.keys_down.set(event->key.scancode);
+            break;
+        case SDL_EVENT_KEY_UP:
+            if (event->key.scancode >= SDL_SCANCODE_COUNT)
+                break;
+            m_next.keys_released.set(event->key.scancode);
+            m_next.keys_down.reset(event->key.scancode);
+            break;
+        case SDL_EVENT_MOUSE_MOTION:
+            m_next.mouse_screen_position = Vector2(event->motion.x, event->motion.y);
+            m_next.mouse_motion = m_next.mouse_motion + Vector2(event->motion.xrel, event->motion.yrel);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            m_next.mouse_screen_position = Vector2(event->button.x, event->button.y);
+            m_next.mouse_buttons_pressed |= SDL_BUTTON_MASK(event->button.button);
+            m_next.mouse_buttons_down |= SDL_BUTTON_MASK(event->button.button);
+            break;
+        case SDL_EVENT_MOUSE_BUTTON_UP:
+            m_next.mouse_screen_position = Vector2(event->button.x, event->button.y);
+            m_next.mouse_buttons_released |= SDL_BUTTON_MASK(event->button.button);
+            m_next.mouse_buttons_down &= ~SDL_BUTTON_MASK(event->button.button);
+            break;
+        case SDL_EVENT_MOUSE_WHEEL:
+            m_next.mouse_wheel = m_next.mouse_wheel + Vector2(event->wheel.x, event->wheel.y);
+            break;
+        case SDL_EVENT_GAMEPAD_ADDED:
+            gamepadSlot(event->gdevice.which, true);
+            break;
+        case SDL_EVENT_GAMEPAD_REMOVED:
+            {
+            int slot = gamepadSlot(event->gdevice.which, false);
+            if (slot < 0)
+                break;
+            m_next.gamepad_ids[slot] = 0;
+            m_next.gamepad_buttons_released[slot] |= m_next.gamepad_buttons_down[slot];
+            m_next.gamepad_buttons_down[slot].reset();
+            for (size_t axis=0; axis<SDL_GAMEPAD_AXIS_COUNT; ++axis)
+                m_next.gamepad_axes[slot][axis] = 0.0f;
+            break;
+            }
+        case SDL_EVENT_GAMEPAD_AXIS_MOTION:
+            {
+            int slot = gamepadSlot(event->gaxis.which, true);
+            if (slot < 0 || event->gaxis.axis >= SDL_GAMEPAD_AXIS_COUNT)
+                break;
+            // Sint16 range is asymmetric, clamp the negative end
+            m_next.gamepad_axes[slot][event->gaxis.axis] =
+                std::max(-1.0f, (float)event->gaxis.value / 32767.0f);
+            break;
+            }
+        case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+            {
+            int slot = gamepadSlot(event->gbutton.which, true);
+            if (slot < 0 || event->gbutton.button >= SDL_GAMEPAD_BUTTON_COUNT)
+                break;
+            m_next.gamepad_buttons_pressed[slot].set(event->gbutton.button);
+            m_next.gamepad_buttons_down[slot].set(event->gbutton.button);
+            break;
+            }
+        case SDL_EVENT_GAMEPAD_BUTTON_UP:
+            {
+            int slot = gamepadSlot(event->gbutton.which, true);
+            if (slot < 0 || event->gbutton.button >= SDL_GAMEPAD_BUTTON_COUNT)
+                break;
+            m_next.gamepad_buttons_released[slot].set(event->gbutton.button);
+            m_next.gamepad_buttons_down[slot].reset(event->gbutton.button);
+            break;
+            }
+        default:
+            break;
+    }
+}
+
+
+void Input::__beginFrame(RenderContext* renderContext) {
+    const Uint64 frame = m_snapshot.frame + 1;
+
+    m_snapshot = m_next;
+    m_snapshot.frame = frame;
+    // camera might have moved even if the mouse didn't
+    m_snapshot.mouse_position = screenToSceneSpace(renderContext, m_snapshot.mouse_screen_position);
+
+    m_next.clearEdges();
+}
@@ -0,0 +1,87 @@
+#include "pixbench/job_pool.h"
+#include "pixbench/utils/logger.h"
+#include <mutex>
+#include <thread>
+
+
+JobPool::JobPool(size_t worker_count) {
+    for (size_t i=0; i<worker_count; ++i)
+        m_workers.push_back(std::thread(&JobPool::run, this));
+
+    if (worker_count > 0)
+        PIXBENCH_LOG_DEBUG("JobPool started {} worker threads", worker_count);
+}
+
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop_requested = true;
+    }
+    m_work_cv.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+
+void JobPool::runJobs(const std::function<void(size_t)>& job, size_t job_count) {
+    for (;;) {
+        const size_t index = m_next_job.fetch_add(1);
+        if (index >= job_count)
+            return;
+        job(index);
+    }
+}
+
+
+void JobPool::run() {
+    uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_work_cv.wait(lock, [this, seen_generation] {
+                return m_stop_requested || m_generation != seen_generation;
+                });
+        if (m_stop_requested)
+            break;
+
+        seen_generation = m_generation;
+        const std::function<void(size_t)>* job = m_job;
+        const size_t job_count = m_job_count;
+        lock.unlock();
+
+        this->runJobs(*job, job_count);
+
+        lock.lock();
+        if (--m_busy_workers == 0)
+            m_done_cv.notify_all();
+    }
+}
+
+
+void JobPool::parallelFor(size_t job_count, const std::function<void(size_t)>& job) {
+    if (job_count == 0)
+        return;
+
+    if (job_count == 1 || m_workers.empty()) {
+        for (size_t i=0; i<job_count; ++i)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_job_count = job_count;
+        m_next_job.store(0);
+        m_busy_workers = m_workers.size();
+        ++m_generation;
+    }
+    m_work_cv.notify_all();
+
+    this->runJobs(job, job_count);
+
+    // every worker checks in, so none can still be reading `job` afterward
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_busy_workers == 0; });
+    m_job = nullptr;
+}
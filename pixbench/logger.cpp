@@ -0,0 +1,174 @@
+#include "pixbench/utils/logger.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+static const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LOGLVL_Trace:      return "TRACE";
+        case LOGLVL_Debug:      return "DEBUG";
+        case LOGLVL_Info:       return "INFO ";
+        case LOGLVL_Warning:    return "WARN ";
+        case LOGLVL_Error:      return "ERROR";
+    }
+    return "?????";
+}
+
+
+void LogRecord::formatMessage(std::string& out) const {
+    char number_buffer[32];
+    size_t arg_index = 0;
+
+    for (const char* c = format; c && *c; ++c) {
+        if (c[0] != '{' || c[1] != '}' || arg_index >= num_args) {
+            out.push_back(*c);
+            continue;
+        }
+        ++c;    // skip '}'
+
+        const LogArg& arg = args[arg_index++];
+        switch (arg.type) {
+            case LOGARG_Int:
+                std::snprintf(number_buffer, sizeof(number_buffer), "%lld", arg.value.i);
+                out.append(number_buffer);
+                break;
+            case LOGARG_UInt:
+                std::snprintf(number_buffer, sizeof(number_buffer), "%llu", arg.value.u);
+                out.append(number_buffer);
+                break;
+            case LOGARG_Double:
+                std::snprintf(number_buffer, sizeof(number_buffer), "%g", arg.value.d);
+                out.append(number_buffer);
+                break;
+            case LOGARG_Bool:
+                out.append(arg.value.u ? "true" : "false");
+                break;
+            case LOGARG_Char:
+                out.push_back((char)arg.value.i);
+                break;
+            case LOGARG_String:
+                out.append(strings + arg.value.s.offset, arg.value.s.length);
+                break;
+            case LOGARG_Pointer:
+                std::snprintf(number_buffer, sizeof(number_buffer), "%p", arg.value.p);
+                out.append(number_buffer);
+                break;
+        }
+    }
+}
+
+
+Logger::Logger()
+    :
+    m_is_running(false),
+    m_stop_requested(false),
+    m_min_level(PIXBENCH_LOG_LEVEL),
+    m_pushed_count(0),
+    m_written_count(0),
+    m_dropped_count(0),
+    m_start_time(std::chrono::steady_clock::now()),
+    m_output(stdout)
+{
+}
+
+
+Logger::~Logger() {
+    if ( !m_is_running.load(std::memory_order_acquire) )
+        return;
+
+    m_stop_requested.store(true, std::memory_order_release);
+    m_thread.join();
+}
+
+
+Logger& Logger::get() {
+    static Logger logger;
+    return logger;
+}
+
+
+void Logger::start() {
+    std::lock_guard<std::mutex> lock(m_start_mutex);
+    if (m_is_running.load(std::memory_order_relaxed))
+        return;
+
+    m_thread = std::thread(&Logger::run, this);
+    m_is_running.store(true, std::memory_order_release);
+}
+
+
+void Logger::setOutput(FILE* output) {
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    m_output = output;
+}
+
+
+void Logger::flush() {
+    if ( !m_is_running.load(std::memory_order_acquire) )
+        return;
+
+    const size_t target = m_pushed_count.load(std::memory_order_acquire);
+    while (m_written_count.load(std::memory_order_acquire) < target)
+        std::this_thread::yield();
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    std::fflush(m_output);
+}
+
+
+void Logger::write(const LogRecord& record, std::string& line_buffer) {
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "[%12.6f] %s ", record.time_s, logLevelName(record.level));
+
+    line_buffer.assign(prefix);
+    record.formatMessage(line_buffer);
+    line_buffer.push_back('\n');
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    std::fwrite(line_buffer.data(), 1, line_buffer.size(), m_output);
+}
+
+
+void Logger::run() {
+    LogRecord record;
+    std::string line_buffer;
+    size_t reported_dropped = 0;
+    int idle_rounds = 0;
+
+    for (;;) {
+        if (m_queue.tryPop(record)) {
+            write(record, line_buffer);
+            m_written_count.fetch_add(1, std::memory_order_release);
+            idle_rounds = 0;
+            continue;
+        }
+
+        const size_t dropped = m_dropped_count.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            std::fprintf(m_output, "[logger] %zu records dropped, queue full\n", dropped - reported_dropped);
+            reported_dropped = dropped;
+        }
+
+        if (m_stop_requested.load(std::memory_order_acquire))
+            break;
+
+        // nothing to write: flush, then back off from spinning to sleeping
+        if (idle_rounds == 0) {
+            std::lock_guard<std::mutex> lock(m_output_mutex);
+            std::fflush(m_output);
+        }
+        if (idle_rounds < 64) {
+            ++idle_rounds;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    std::fflush(m_output);
+}
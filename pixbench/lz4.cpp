@@ -0,0 +1,245 @@
+#include "pixbench/utils/lz4.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5         //!< a block always ends with this many literals
+#define LZ4_MATCH_START_LIMIT 12    //!< no match starts in the last bytes of a block
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+#define LZ4_FAST_COPY 16            //!< literals up to 14 bytes are copied as this many
+
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+
+/**
+ * Write a length continuation, 255 bytes then the rest. Returns `false` if
+ * it doesn't fit.
+ */
+static bool writeLength(size_t length, uint8_t** out__op, const uint8_t* end) {
+    uint8_t* op = *out__op;
+    while (length >= 255) {
+        if (op >= end)
+            return false;
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= end)
+        return false;
+    *op++ = (uint8_t)length;
+    *out__op = op;
+    return true;
+}
+
+
+/**
+ * Write a sequence: `literal_count` literals, then a match of `match_length`
+ * at `offset`, or no match for the last sequence (`match_length` 0).
+ */
+static bool writeSequence(
+        const uint8_t* literals, size_t literal_count,
+        size_t offset, size_t match_length,
+        uint8_t** out__op, const uint8_t* end
+        ) {
+    uint8_t* op = *out__op;
+    if (op >= end)
+        return false;
+
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_count >= 15 ? 15 : literal_count) << 4);
+    if (literal_count >= 15 && !writeLength(literal_count - 15, &op, end))
+        return false;
+
+    if ((size_t)(end - op) < literal_count)
+        return false;
+    if (literal_count > 0)
+        std::memcpy(op, literals, literal_count);
+    op += literal_count;
+
+    if (match_length > 0) {
+        if (end - op < 2)
+            return false;
+        *op++ = (uint8_t)(offset & 0xff);
+        *op++ = (uint8_t)(offset >> 8);
+
+        const size_t length_code = match_length - LZ4_MIN_MATCH;
+        *token |= (uint8_t)(length_code >= 15 ? 15 : length_code);
+        if (length_code >= 15 && !writeLength(length_code - 15, &op, end))
+            return false;
+    }
+
+    *out__op = op;
+    return true;
+}
+
+
+size_t LZ4CompressBound(size_t source_size) {
+    return source_size + source_size / 255 + 16;
+}
+
+
+size_t LZ4CompressBlock(
+        const uint8_t* source, size_t source_size,
+        uint8_t* destination, size_t destination_capacity
+        ) {
+    uint8_t* op = destination;
+    const uint8_t* end = destination + destination_capacity;
+    size_t anchor = 0;
+
+    if (source_size > LZ4_MATCH_START_LIMIT) {
+        // positions + 1, 0 for none
+        std::vector<uint32_t> table((size_t)1 << LZ4_HASH_BITS, 0);
+        const size_t match_start_end = source_size - LZ4_MATCH_START_LIMIT;
+        const size_t match_end_limit = source_size - LZ4_LAST_LITERALS;
+
+        size_t ip = 0;
+        while (ip < match_start_end) {
+            const uint32_t sequence = read32(source + ip);
+            uint32_t& slot = table[hashSequence(sequence)];
+            const size_t candidate = slot;
+            slot = (uint32_t)ip + 1;
+
+            if (
+                    candidate == 0
+                    || ip - (candidate - 1) > LZ4_MAX_OFFSET
+                    || read32(source + candidate - 1) != sequence
+               ) {
+                ++ip;
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t match_length = LZ4_MIN_MATCH;
+            while (ip + match_length < match_end_limit && source[match + match_length] == source[ip + match_length])
+                ++match_length;
+            // the match may have started earlier, in the pending literals
+            while (ip > anchor && match > 0 && source[ip - 1] == source[match - 1]) {
+                --ip;
+                --match;
+                ++match_length;
+            }
+
+            if ( !writeSequence(source + anchor, ip - anchor, ip - match, match_length, &op, end) )
+                return 0;
+            ip += match_length;
+            anchor = ip;
+
+            // keeps a position near the end of the match, for the next one
+            if (ip - 2 < match_start_end)
+                table[hashSequence(read32(source + ip - 2))] = (uint32_t)(ip - 2) + 1;
+        }
+    }
+
+    if ( !writeSequence(source + anchor, source_size - anchor, 0, 0, &op, end) )
+        return 0;
+    return (size_t)(op - destination);
+}
+
+
+/**
+ * Read a length continuation into `out__length`.
+ */
+static bool readLength(const uint8_t** out__ip, const uint8_t* end, size_t* out__length) {
+    const uint8_t* ip = *out__ip;
+    uint8_t byte;
+    do {
+        if (ip >= end)
+            return false;
+        byte = *ip++;
+        *out__length += byte;
+    } while (byte == 255);
+    *out__ip = ip;
+    return true;
+}
+
+
+bool LZ4DecompressBlock(
+        const uint8_t* source, size_t source_size,
+        uint8_t* destination, size_t destination_size
+        ) {
+    const uint8_t* ip = source;
+    const uint8_t* const source_end = source + source_size;
+    uint8_t* op = destination;
+    uint8_t* const destination_end = destination + destination_size;
+
+    while (true) {
+        if (ip >= source_end)
+            return false;
+        const uint8_t token = *ip++;
+
+        size_t literal_count = token >> 4;
+        if (
+                literal_count < 15
+                && source_end - ip >= LZ4_FAST_COPY
+                && destination_end - op >= LZ4_FAST_COPY
+           ) {
+            // short literals, copied in one fixed size move with room to spare
+            std::memcpy(op, ip, LZ4_FAST_COPY);
+        } else {
+            if (literal_count == 15 && !readLength(&ip, source_end, &literal_count))
+                return false;
+            if (literal_count > (size_t)(source_end - ip) || literal_count > (size_t)(destination_end - op))
+                return false;
+            if (literal_count > 0)
+                std::memcpy(op, ip, literal_count);
+        }
+        ip += literal_count;
+        op += literal_count;
+
+        // the last sequence has no match
+        if (ip == source_end)
+            return op == destination_end;
+
+        if (source_end - ip < 2)
+            return false;
+        const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - destination))
+            return false;
+
+        size_t match_length = token & 15;
+        if (match_length == 15 && !readLength(&ip, source_end, &match_length))
+            return false;
+        match_length += LZ4_MIN_MATCH;
+        if (match_length > (size_t)(destination_end - op))
+            return false;
+
+        const uint8_t* match = op - offset;
+        if (offset >= 8 && (size_t)(destination_end - op) >= match_length + 8) {
+            // 8 bytes at a time, overshooting into room that is written later
+            uint8_t* const match_end = op + match_length;
+            while (op < match_end) {
+                std::memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            }
+            op = match_end;
+        } else if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        } else {
+            // overlapping, repeats the last `offset` bytes; what is copied
+            // repeats too, so each copy can be twice as long as the last
+            size_t period = offset;
+            while (match_length > 0) {
+                const size_t chunk = std::min(period, match_length);
+                std::memcpy(op, match, chunk);
+                op += chunk;
+                match_length -= chunk;
+                period *= 2;
+            }
+        }
+    }
+}
@@ -1891,3 +1891,17 @@ void phydebDrawCross(
 }
 
 
+void phydebDrawCross(
+        RenderSnapshot* snapshot,
+        Vector2* center,
+        float cross_width
+        ) {
+    snapshot->renderLine(
+            center->x - cross_width/2, center->y - cross_width/2,
+            center->x + cross_width/2, center->y + cross_width/2
+            );
+    snapshot->renderLine(
+            center->x + cross_width/2, center->y - cross_width/2,
+            center->x - cross_width/2, center->y + cross_width/2
+            );
+}
@@ -0,0 +1,100 @@
+#include "pixbench/pipeline.h"
+#include "pixbench/utils/logger.h"
+#include <mutex>
+#include <thread>
+
+
+FramePipeline::FramePipeline(Game* game)
+    :
+    m_game(game),
+    m_frame_result(ResultOK)
+{
+}
+
+
+FramePipeline::~FramePipeline() {
+    this->stop();
+}
+
+
+void FramePipeline::start() {
+    if (m_thread.joinable())
+        return;
+
+    m_stop_requested = false;
+    m_thread = std::thread(&FramePipeline::run, this);
+    PIXBENCH_LOG_DEBUG("FramePipeline simulation thread started");
+}
+
+
+void FramePipeline::stop() {
+    if ( !m_thread.joinable() )
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop_requested = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    PIXBENCH_LOG_DEBUG("FramePipeline simulation thread stopped");
+}
+
+
+void FramePipeline::queueEvent(const SDL_Event* event) {
+    std::lock_guard<std::mutex> lock(m_event_mutex);
+    m_pending_events.push_back(*event);
+}
+
+
+Result<VoidResult, GameError> FramePipeline::waitForFrame() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return !m_frame_running; });
+    return m_frame_result;
+}
+
+
+void FramePipeline::requestFrame() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_front_index = 1 - m_front_index;
+        m_frame_requested = true;
+        m_frame_running = true;
+    }
+    m_cv.notify_all();
+}
+
+
+void FramePipeline::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        // a requested frame is always finished before stopping, so
+        // FramePipeline::waitForFrame() can't block forever
+        m_cv.wait(lock, [this] { return m_frame_requested || m_stop_requested; });
+        if ( !m_frame_requested )
+            break;
+
+        m_frame_requested = false;
+        RenderSnapshot* back_snapshot = &m_snapshots[1 - m_front_index];
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> event_lock(m_event_mutex);
+            m_processing_events.swap(m_pending_events);
+        }
+
+        FrameStats stats;
+        Result<VoidResult, GameError> res = m_game->SimulateFrame(
+                m_processing_events,
+                back_snapshot,
+                &stats
+                );
+        m_processing_events.clear();
+
+        lock.lock();
+        m_frame_result = res;
+        m_frame_stats = stats;
+        m_frame_running = false;
+        m_cv.notify_all();
+    }
+}
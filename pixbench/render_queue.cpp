@@ -0,0 +1,154 @@
+#include "pixbench/render_queue.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+
+#define RENDER_QUEUE_NO_ITEM UINT32_MAX
+#define RENDER_RADIX_BITS 8
+#define RENDER_RADIX_BUCKETS (1 << RENDER_RADIX_BITS)
+#define RENDER_RADIX_PASSES (64 / RENDER_RADIX_BITS)
+
+
+uint64_t RenderQueue::makeSortKey(float depth, uint32_t texture_id, uint64_t entity_id, size_t cindex) {
+    // flip the float bits so they compare like unsigned integers, negative
+    // depths first
+    uint32_t depth_bits;
+    std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+    depth_bits = (depth_bits & 0x80000000u) ? ~depth_bits : (depth_bits | 0x80000000u);
+
+    const uint64_t texture_mask = ((uint64_t)1 << RENDER_KEY_TEXTURE_BITS) - 1;
+    const uint64_t entity_mask = ((uint64_t)1 << RENDER_KEY_ENTITY_BITS) - 1;
+    const uint64_t cindex_mask = ((uint64_t)1 << RENDER_KEY_CINDEX_BITS) - 1;
+    return ((uint64_t)depth_bits << 32)
+        | (((uint64_t)texture_id & texture_mask) << (RENDER_KEY_ENTITY_BITS + RENDER_KEY_CINDEX_BITS))
+        | ((entity_id & entity_mask) << RENDER_KEY_CINDEX_BITS)
+        | ((uint64_t)cindex & cindex_mask);
+}
+
+
+void RenderQueue::restorePreviousOrder() {
+    const RenderQueueEntry empty = { 0, RENDER_QUEUE_NO_ITEM };
+    m_scratch.assign(m_last_count, empty);
+    m_new_entries.clear();
+
+    const uint32_t previous_sort_id = m_sort_id - 1;
+    for (const RenderQueueEntry& entry : m_entries) {
+        if (
+                entry.item < m_item_ranks.size()
+                && m_item_sort_ids[entry.item] == previous_sort_id
+                && m_scratch[m_item_ranks[entry.item]].item == RENDER_QUEUE_NO_ITEM
+           ) {
+            m_scratch[m_item_ranks[entry.item]] = entry;
+            continue;
+        }
+        m_new_entries.push_back(entry);
+    }
+
+    size_t count = 0;
+    for (const RenderQueueEntry& entry : m_scratch) {
+        if (entry.item != RENDER_QUEUE_NO_ITEM)
+            m_entries[count++] = entry;
+    }
+    for (const RenderQueueEntry& entry : m_new_entries)
+        m_entries[count++] = entry;
+}
+
+
+void RenderQueue::extractOutOfOrder() {
+    m_new_entries.clear();
+
+    // keep a non decreasing run, an entry is moved out if it is smaller than
+    // the last kept one or bigger than the next one
+    size_t count = 0;
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        const uint64_t key = m_entries[i].key;
+        const bool is_after_last_kept = count == 0 || m_entries[count-1].key <= key;
+        const bool is_before_next = i+1 == m_entries.size() || key <= m_entries[i+1].key;
+        if (is_after_last_kept && is_before_next)
+            m_entries[count++] = m_entries[i];
+        else
+            m_new_entries.push_back(m_entries[i]);
+    }
+    m_entries.resize(count);
+}
+
+
+void RenderQueue::radixSort() {
+    const size_t count = m_entries.size();
+    size_t histograms[RENDER_RADIX_PASSES][RENDER_RADIX_BUCKETS] = {};
+    for (const RenderQueueEntry& entry : m_entries) {
+        for (int pass=0; pass<RENDER_RADIX_PASSES; ++pass)
+            ++histograms[pass][(entry.key >> (pass * RENDER_RADIX_BITS)) & (RENDER_RADIX_BUCKETS - 1)];
+    }
+
+    m_scratch.resize(count);
+    std::vector<RenderQueueEntry>* source = &m_entries;
+    std::vector<RenderQueueEntry>* destination = &m_scratch;
+    for (int pass=0; pass<RENDER_RADIX_PASSES; ++pass) {
+        const int shift = pass * RENDER_RADIX_BITS;
+        size_t* histogram = histograms[pass];
+
+        // every key has the same digit, e.g. the unused texture bits
+        if (histogram[((*source)[0].key >> shift) & (RENDER_RADIX_BUCKETS - 1)] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int bucket=0; bucket<RENDER_RADIX_BUCKETS; ++bucket) {
+            const size_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+        for (const RenderQueueEntry& entry : *source)
+            (*destination)[histogram[(entry.key >> shift) & (RENDER_RADIX_BUCKETS - 1)]++] = entry;
+
+        std::swap(source, destination);
+    }
+
+    if (source != &m_entries)
+        m_entries.swap(m_scratch);
+}
+
+
+void RenderQueue::storeRanks() {
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        const uint32_t item = m_entries[i].item;
+        if (item >= m_item_ranks.size()) {
+            m_item_ranks.resize(item + 1, 0);
+            m_item_sort_ids.resize(item + 1, 0);
+        }
+        m_item_ranks[item] = (uint32_t)i;
+        m_item_sort_ids[item] = m_sort_id;
+    }
+    m_last_count = m_entries.size();
+}
+
+
+void RenderQueue::sort() {
+    ++m_sort_id;
+    if (m_entries.size() > 1) {
+        this->restorePreviousOrder();
+        this->extractOutOfOrder();
+
+        if (m_new_entries.size() * 8 > m_entries.size()) {
+            // too much changed
+            m_entries.insert(m_entries.end(), m_new_entries.begin(), m_new_entries.end());
+            this->radixSort();
+        }
+        else if ( !m_new_entries.empty() ) {
+            // a few changed depths and new items
+            const auto by_key = [] (const RenderQueueEntry& a, const RenderQueueEntry& b) {
+                return a.key < b.key;
+            };
+            std::sort(m_new_entries.begin(), m_new_entries.end(), by_key);
+            m_scratch.resize(m_entries.size() + m_new_entries.size());
+            std::merge(
+                    m_entries.begin(), m_entries.end(),
+                    m_new_entries.begin(), m_new_entries.end(),
+                    m_scratch.begin(), by_key
+                    );
+            m_entries.swap(m_scratch);
+        }
+    }
+    this->storeRanks();
+}
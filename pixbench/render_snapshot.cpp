@@ -0,0 +1,281 @@
+#include "pixbench/render_snapshot.h"
+#include "pixbench/asset_cache.h"
+#include "pixbench/components.h"
+#include "pixbench/utils/logger.h"
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_render.h>
+#include <algorithm>
+#include <cmath>
+
+
+void RenderSnapshot::retainTexture(const std::shared_ptr<Res_SDL_Texture>& texture) {
+    // consecutive commands mostly share a texture, only check the last one
+    if ( !m_retained_textures.empty() && m_retained_textures.back() == texture )
+        return;
+    m_retained_textures.push_back(texture);
+}
+
+
+void RenderSnapshot::clear() {
+    commands.clear();
+    vertices.clear();
+    points.clear();
+    text.clear();
+    m_retained_textures.clear();
+}
+
+
+void RenderSnapshot::captureContext(RenderContext* renderContext) {
+    camera_position = renderContext->camera_position;
+    camera_size = renderContext->camera_size;
+    screen_size = renderContext->screen_size;
+    clear_color = renderContext->renderClearColor;
+}
+
+
+void RenderSnapshot::appendQuad(
+        const std::shared_ptr<Res_SDL_Texture>& texture,
+        const SDL_FRect* srect, const SDL_FRect* drect,
+        double angle, SDL_FlipMode flip_mode
+        ) {
+    if ( !texture )
+        return;
+    if (srect->w == 0 || srect->h == 0 || texture->w == 0 || texture->h == 0) {
+        PIXBENCH_LOG_ERROR("Sprite source rect has zero width or height");
+        return;
+    }
+    retainTexture(texture);
+
+    // texture coordinates, flipping swaps them
+    float u0 = srect->x / (float)texture->w;
+    float u1 = (srect->x + srect->w) / (float)texture->w;
+    float v0 = srect->y / (float)texture->h;
+    float v1 = (srect->y + srect->h) / (float)texture->h;
+    if (flip_mode & SDL_FLIP_HORIZONTAL)
+        std::swap(u0, u1);
+    if (flip_mode & SDL_FLIP_VERTICAL)
+        std::swap(v0, v1);
+
+    // corners around the center, clockwise from the top left (y goes down)
+    const float half_w = drect->w * 0.5f;
+    const float half_h = drect->h * 0.5f;
+    const float center_x = drect->x + half_w;
+    const float center_y = drect->y + half_h;
+    const float corner_x[4] = { -half_w, half_w, half_w, -half_w };
+    const float corner_y[4] = { -half_h, -half_h, half_h, half_h };
+    const float corner_u[4] = { u0, u1, u1, u0 };
+    const float corner_v[4] = { v0, v0, v1, v1 };
+
+    float cos_a = 1.0f, sin_a = 0.0f;
+    if (angle != 0.0) {
+        const double radians = angle * M_PI / 180.0;
+        cos_a = (float)std::cos(radians);
+        sin_a = (float)std::sin(radians);
+    }
+
+    const SDL_FColor white = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int i=0; i<4; ++i) {
+        SDL_Vertex vertex;
+        vertex.position.x = center_x + corner_x[i] * cos_a - corner_y[i] * sin_a;
+        vertex.position.y = center_y + corner_x[i] * sin_a + corner_y[i] * cos_a;
+        vertex.color = white;
+        vertex.tex_coord.x = corner_u[i];
+        vertex.tex_coord.y = corner_v[i];
+        vertices.push_back(vertex);
+    }
+
+    appendToGeometryBatch(texture, 4);
+}
+
+
+void RenderSnapshot::appendToGeometryBatch(
+        const std::shared_ptr<Res_SDL_Texture>& texture,
+        size_t vertex_count
+        ) {
+    if ( !commands.empty() && commands.back().tag == RCMD_Geometry && commands.back().texture == texture.get() ) {
+        commands.back().data_count += vertex_count;
+        return;
+    }
+
+    RenderCommand command;
+    command.tag = RCMD_Geometry;
+    command.texture = texture.get();
+    command.data_offset = vertices.size() - vertex_count;
+    command.data_count = vertex_count;
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderTexture(
+        const std::shared_ptr<Res_SDL_Texture>& texture,
+        const SDL_FRect* srect, const SDL_FRect* drect
+        ) {
+    appendQuad(texture, srect, drect, 0.0, SDL_FLIP_NONE);
+}
+
+
+void RenderSnapshot::renderTextureRotated(
+        const std::shared_ptr<Res_SDL_Texture>& texture,
+        const SDL_FRect* srect, const SDL_FRect* drect,
+        double angle, SDL_FlipMode flip_mode
+        ) {
+    appendQuad(texture, srect, drect, angle, flip_mode);
+}
+
+
+void RenderSnapshot::renderQuads(
+        const std::shared_ptr<Res_SDL_Texture>& texture,
+        const SDL_Vertex* quad_vertices, size_t count,
+        Vector2 offset, Vector2 scale
+        ) {
+    if ( !texture || count == 0 )
+        return;
+    if (count % 4 != 0) {
+        PIXBENCH_LOG_ERROR("RenderSnapshot::renderQuads() expects 4 vertices per quad, got {}", count);
+        return;
+    }
+    retainTexture(texture);
+
+    const size_t first = vertices.size();
+    vertices.insert(vertices.end(), quad_vertices, quad_vertices + count);
+    for (size_t i=first; i<vertices.size(); ++i) {
+        vertices[i].position.x = vertices[i].position.x * scale.x + offset.x;
+        vertices[i].position.y = vertices[i].position.y * scale.y + offset.y;
+    }
+
+    appendToGeometryBatch(texture, count);
+}
+
+
+void RenderSnapshot::setDrawColorFloat(float r, float g, float b, float a) {
+    RenderCommand command;
+    command.tag = RCMD_DrawColor;
+    command.drect = { r, g, b, a };
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderPoint(float x, float y) {
+    RenderCommand command;
+    command.tag = RCMD_Point;
+    command.drect = { x, y, 0.0f, 0.0f };
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderLine(float x1, float y1, float x2, float y2) {
+    RenderCommand command;
+    command.tag = RCMD_Line;
+    command.drect = { x1, y1, x2, y2 };
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderLines(const SDL_FPoint* line_points, int count) {
+    RenderCommand command;
+    command.tag = RCMD_Lines;
+    command.data_offset = points.size();
+    command.data_count = count;
+    points.insert(points.end(), line_points, line_points + count);
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderRect(const SDL_FRect* rect) {
+    RenderCommand command;
+    command.tag = RCMD_Rect;
+    command.drect = *rect;
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::renderDebugText(float x, float y, const char* str) {
+    RenderCommand command;
+    command.tag = RCMD_DebugText;
+    command.drect = { x, y, 0.0f, 0.0f };
+    command.data_offset = text.size();
+    text.append(str);
+    text.push_back('\0');
+    commands.push_back(command);
+}
+
+
+void RenderSnapshot::drawCustomRenderable(CustomRenderable* custom_renderable) {
+    RenderCommand command;
+    command.tag = RCMD_CustomRenderable;
+    command.custom_renderable = custom_renderable;
+    commands.push_back(command);
+}
+
+
+Result<VoidResult, GameError> RenderSnapshot::submit(
+        RenderContext* renderContext,
+        EntityManager* entity_mgr,
+        AssetCache* assets
+        ) {
+    SDL_Renderer* renderer = renderContext->renderer;
+
+    for (const RenderCommand& command : commands) {
+        switch (command.tag) {
+            case RCMD_Geometry:
+                {
+                const size_t index_count = command.data_count / 4 * 6;
+                while (m_quad_indices.size() < index_count) {
+                    const int first = (int)(m_quad_indices.size() / 6 * 4);
+                    const int quad[6] = { first, first + 1, first + 2, first + 2, first + 3, first };
+                    m_quad_indices.insert(m_quad_indices.end(), quad, quad + 6);
+                }
+
+                // looked up now, it may have been evicted and loaded again since recording
+                if (assets)
+                    assets->useTexture(command.texture);
+                // evicted and still being loaded again, or failed to load
+                if ( !command.texture->texture )
+                    break;
+
+                bool is_success = SDL_RenderGeometry(
+                        renderer, command.texture->texture,
+                        &vertices[command.data_offset], (int)command.data_count,
+                        m_quad_indices.data(), (int)index_count
+                        );
+                if ( !is_success ) {
+                    PIXBENCH_LOG_ERROR("Problem in rendering sprites, SDL error: {}", SDL_GetError());
+                }
+                break;
+                }
+            case RCMD_DrawColor:
+                SDL_SetRenderDrawColorFloat(
+                        renderer,
+                        command.drect.x, command.drect.y, command.drect.w, command.drect.h
+                        );
+                break;
+            case RCMD_Point:
+                SDL_RenderPoint(renderer, command.drect.x, command.drect.y);
+                break;
+            case RCMD_Line:
+                SDL_RenderLine(
+                        renderer,
+                        command.drect.x, command.drect.y, command.drect.w, command.drect.h
+                        );
+                break;
+            case RCMD_Lines:
+                SDL_RenderLines(renderer, &points[command.data_offset], (int)command.data_count);
+                break;
+            case RCMD_Rect:
+                SDL_RenderRect(renderer, &command.drect);
+                break;
+            case RCMD_DebugText:
+                SDL_RenderDebugText(
+                        renderer,
+                        command.drect.x, command.drect.y,
+                        text.c_str() + command.data_offset
+                        );
+                break;
+            case RCMD_CustomRenderable:
+                command.custom_renderable->Draw(renderContext, entity_mgr);
+                break;
+        }
+    }
+
+    return ResultOK;
+}
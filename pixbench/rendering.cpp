@@ -61,3 +61,16 @@ Vector2 sceneToScreenSpace(
     const Vector2 _intermediary = sceneToCamSpace(renderContext, point);
     return camToScreenSpace(renderContext, _intermediary);
 }
+
+
+Vector2 screenToSceneSpace(
+        RenderContext* renderContext,
+        Vector2 point
+        ) {
+    const float scale_x = renderContext->camera_size.x / renderContext->screen_size.x;
+    const float scale_y = renderContext->camera_size.y / renderContext->screen_size.y;
+    return Vector2(
+            point.x * scale_x + renderContext->camera_position.x,
+            point.y * scale_y + renderContext->camera_position.y
+            );
+}
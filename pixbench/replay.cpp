@@ -0,0 +1,181 @@
+#include "pixbench/replay.h"
+#include <SDL3/SDL_events.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+
+bool isEventReplayable(const SDL_Event* event) {
+    switch (event->type) {
+        case SDL_EVENT_TEXT_EDITING:
+        case SDL_EVENT_TEXT_EDITING_CANDIDATES:
+        case SDL_EVENT_TEXT_INPUT:
+        case SDL_EVENT_CLIPBOARD_UPDATE:
+        case SDL_EVENT_DROP_FILE:
+        case SDL_EVENT_DROP_TEXT:
+            return false;
+        default:
+            // user events can carry anything
+            return event->type < SDL_EVENT_USER;
+    }
+}
+
+
+// ===================== Replay Recorder =====================
+
+
+Result<VoidResult, GameError> ReplayRecorder::open(const std::string& path, uint32_t random_seed) {
+    m_file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    if ( !m_file.is_open() ) {
+        return ResultError("Can't open replay file for recording: " + path);
+    }
+
+    const uint32_t version = REPLAY_FILE_VERSION;
+    m_file.write(REPLAY_FILE_MAGIC, 4);
+    m_file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    m_file.write(reinterpret_cast<const char*>(&random_seed), sizeof(random_seed));
+
+    m_frame_events.clear();
+    m_frame_count = 0;
+    return ResultOK;
+}
+
+
+void ReplayRecorder::recordEvent(const SDL_Event* event) {
+    if ( !isEventReplayable(event) )
+        return;
+    m_frame_events.push_back(*event);
+}
+
+
+Result<VoidResult, GameError> ReplayRecorder::recordFrame(double delta_time_s) {
+    if ( !m_file.is_open() )
+        return ResultOK;
+
+    const uint32_t event_count = (uint32_t)m_frame_events.size();
+    m_file.write(reinterpret_cast<const char*>(&delta_time_s), sizeof(delta_time_s));
+    m_file.write(reinterpret_cast<const char*>(&event_count), sizeof(event_count));
+
+    for (const SDL_Event& event : m_frame_events) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&event);
+        uint16_t size = sizeof(SDL_Event);
+        while (size > 0 && bytes[size - 1] == 0)
+            --size;
+
+        m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        m_file.write(reinterpret_cast<const char*>(bytes), size);
+    }
+    m_frame_events.clear();
+    ++m_frame_count;
+
+    if ( !m_file.good() ) {
+        m_file.close();
+        return ResultError("Can't write replay file, recording stopped");
+    }
+
+    return ResultOK;
+}
+
+
+void ReplayRecorder::close() {
+    if (m_file.is_open())
+        m_file.close();
+}
+
+
+// ===================== Replay Player =====================
+
+
+Result<VoidResult, GameError> ReplayPlayer::open(const std::string& path) {
+    m_path = path;
+    m_file.open(path.c_str(), std::ios::binary);
+    if ( !m_file.is_open() ) {
+        return ResultError("Can't open replay file: " + path);
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    m_file.read(magic, 4);
+    m_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    m_file.read(reinterpret_cast<char*>(&m_random_seed), sizeof(m_random_seed));
+    if ( !m_file.good() || std::memcmp(magic, REPLAY_FILE_MAGIC, 4) != 0 ) {
+        return ResultError("Not a replay file: " + path);
+    }
+    if (version != REPLAY_FILE_VERSION) {
+        return ResultError("Unsupported replay file version: " + path);
+    }
+
+    m_frame_count = 0;
+    m_frame_times_s.clear();
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> ReplayPlayer::readFrame(
+        bool* out__has_frame,
+        double* out__delta_time_s,
+        std::vector<SDL_Event>& out__events
+        ) {
+    out__events.clear();
+    *out__has_frame = false;
+
+    double delta_time_s = 0.0;
+    uint32_t event_count = 0;
+    m_file.read(reinterpret_cast<char*>(&delta_time_s), sizeof(delta_time_s));
+    // the end of the replay, unless it cut a frame time short
+    if (m_file.eof()) {
+        if (m_file.gcount() != 0)
+            return ResultError("Truncated or corrupted replay file: " + m_path);
+        return ResultOK;
+    }
+    m_file.read(reinterpret_cast<char*>(&event_count), sizeof(event_count));
+
+    for (uint32_t i=0; i<event_count && m_file.good(); ++i) {
+        uint16_t size = 0;
+        m_file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (size > sizeof(SDL_Event))
+            return ResultError("Truncated or corrupted replay file: " + m_path);
+
+        SDL_Event event;
+        std::memset(&event, 0, sizeof(SDL_Event));
+        m_file.read(reinterpret_cast<char*>(&event), size);
+        out__events.push_back(event);
+    }
+
+    if ( !m_file.good() ) {
+        return ResultError("Truncated or corrupted replay file: " + m_path);
+    }
+
+    *out__has_frame = true;
+    *out__delta_time_s = delta_time_s;
+    ++m_frame_count;
+    return ResultOK;
+}
+
+
+std::string ReplayPlayer::summarizeFrameTimes() const {
+    std::ostringstream summary;
+    summary << "frames=" << m_frame_times_s.size();
+    if (m_frame_times_s.empty())
+        return summary.str();
+
+    std::vector<double> sorted_times_s = m_frame_times_s;
+    std::sort(sorted_times_s.begin(), sorted_times_s.end());
+
+    double total_s = 0.0;
+    for (double frame_time_s : sorted_times_s)
+        total_s += frame_time_s;
+
+    auto percentile_ms = [&sorted_times_s] (double percentile) {
+        size_t index = (size_t)(percentile * (double)(sorted_times_s.size() - 1) + 0.5);
+        return sorted_times_s[index] * 1000.0;
+    };
+
+    summary << " total_ms=" << total_s * 1000.0
+        << " mean_ms=" << total_s * 1000.0 / (double)sorted_times_s.size()
+        << " p50_ms=" << percentile_ms(0.50)
+        << " p95_ms=" << percentile_ms(0.95)
+        << " p99_ms=" << percentile_ms(0.99)
+        << " max_ms=" << sorted_times_s.back() * 1000.0;
+    return summary.str();
+}
@@ -1,4 +1,43 @@
 #include "pixbench/resource.h"
+#include <SDL3/SDL_init.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+static std::mutex s_released_textures_mutex;
+static std::vector<SDL_Texture*> s_released_textures;   //!< released off the main thread
+
+
+uint32_t __nextTextureID() {
+    static std::atomic<uint32_t> next_id{ 1 };
+    return next_id.fetch_add(1);
+}
+
+
+void __releaseSDLTexture(SDL_Texture* texture) {
+    if ( !texture )
+        return;
+    if (SDL_IsMainThread()) {
+        SDL_DestroyTexture(texture);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_released_textures_mutex);
+    s_released_textures.push_back(texture);
+}
+
+
+void __destroyReleasedTextures() {
+    std::vector<SDL_Texture*> textures;
+    {
+        std::lock_guard<std::mutex> lock(s_released_textures_mutex);
+        textures.swap(s_released_textures);
+    }
+
+    for (SDL_Texture* texture : textures)
+        SDL_DestroyTexture(texture);
+}
 
 
 std::shared_ptr<Res_SDL_Texture> LoadSDLTexture(std::string texture_path, SDL_Renderer* renderer) {
@@ -0,0 +1,117 @@
+#include "pixbench/spatial_grid.h"
+#include <cmath>
+
+
+SpatialGrid::SpatialGrid(float cell_size)
+    :
+        m_cell_size(cell_size)
+{ }
+
+
+int32_t SpatialGrid::cellCoordinate(float position) const {
+    const float cell = std::floor(position / m_cell_size);
+    // keeps far away and non finite positions in the outermost cells
+    if ( !(cell > (float)INT32_MIN) )
+        return INT32_MIN;
+    if ( !(cell < (float)INT32_MAX) )
+        return INT32_MAX;
+    return (int32_t)cell;
+}
+
+
+void SpatialGrid::unlink(uint32_t item) {
+    ItemState& state = m_items[item];
+    std::vector<uint32_t>& items = state.is_oversized ?
+        m_oversized_items : m_cells[state.cell_key];
+
+    // swap with the last one
+    if (state.slot != items.size() - 1) {
+        items[state.slot] = items.back();
+        m_items[items[state.slot]].slot = state.slot;
+    }
+    items.pop_back();
+    state.is_inserted = false;
+    --m_size;
+}
+
+
+void SpatialGrid::update(uint32_t item, const SDL_FRect& bounds, bool oversized) {
+    if (item >= m_items.size())
+        m_items.resize(item + 1);
+
+    oversized = oversized || bounds.w > m_cell_size || bounds.h > m_cell_size;
+    int64_t cell_key = 0;
+    if ( !oversized ) {
+        cell_key = cellKey(
+                cellCoordinate(bounds.x + bounds.w * 0.5f),
+                cellCoordinate(bounds.y + bounds.h * 0.5f)
+                );
+    }
+
+    ItemState& state = m_items[item];
+    if (state.is_inserted) {
+        if (state.is_oversized == oversized && state.cell_key == cell_key)
+            return;
+        this->unlink(item);
+    }
+
+    std::vector<uint32_t>& items = oversized ? m_oversized_items : m_cells[cell_key];
+    state.is_inserted = true;
+    state.is_oversized = oversized;
+    state.cell_key = cell_key;
+    state.slot = items.size();
+    items.push_back(item);
+    ++m_size;
+}
+
+
+void SpatialGrid::remove(uint32_t item) {
+    if ( !this->contains(item) )
+        return;
+    this->unlink(item);
+}
+
+
+void SpatialGrid::query(const SDL_FRect& area, std::vector<uint32_t>* out__items) const {
+    out__items->insert(out__items->end(), m_oversized_items.begin(), m_oversized_items.end());
+    if (m_size == m_oversized_items.size())
+        return;
+
+    // items reach up to half a cell out of the cell of their center
+    const float margin = m_cell_size * 0.5f;
+    const int64_t start_x = cellCoordinate(area.x - margin);
+    const int64_t start_y = cellCoordinate(area.y - margin);
+    const int64_t end_x = cellCoordinate(area.x + area.w + margin);
+    const int64_t end_y = cellCoordinate(area.y + area.h + margin);
+
+    // an area spanning more cells than there are occupied ones, e.g. a
+    // zoomed out camera, is cheaper to check cell by cell
+    const double area_cells = (double)(end_x - start_x + 1) * (double)(end_y - start_y + 1);
+    if (area_cells > (double)m_cells.size()) {
+        for (const auto& cell_it : m_cells) {
+            const int64_t cell_x = (int32_t)(cell_it.first >> 32);
+            const int64_t cell_y = (int32_t)(uint32_t)cell_it.first;
+            if (cell_x < start_x || cell_x > end_x || cell_y < start_y || cell_y > end_y)
+                continue;
+            out__items->insert(out__items->end(), cell_it.second.begin(), cell_it.second.end());
+        }
+        return;
+    }
+
+    for (int64_t cell_y=start_y; cell_y<=end_y; ++cell_y) {
+        for (int64_t cell_x=start_x; cell_x<=end_x; ++cell_x) {
+            auto cell_it = m_cells.find(cellKey((int32_t)cell_x, (int32_t)cell_y));
+            if (cell_it == m_cells.end())
+                continue;
+            out__items->insert(out__items->end(), cell_it->second.begin(), cell_it->second.end());
+        }
+    }
+}
+
+
+void SpatialGrid::clear() {
+    m_items.clear();
+    m_cells.clear();
+    m_oversized_items.clear();
+    m_size = 0;
+}
@@ -7,6 +7,7 @@
 #include "pixbench/physics/physics.h"
 #include "pixbench/physics/type.h"
 #include "pixbench/renderer.h"
+#include "pixbench/utils/logger.h"
 #include "pixbench/utils/results.h"
 #include "pixbench/vector2.h"
 #include <SDL3/SDL_rect.h>
@@ -17,6 +18,52 @@
 #include <cstddef>
 
 
+// ===================== System Schedule =====================
+
+
+void SystemSchedule::__beginFrame(double delta_time_s) {
+    ++m_frame_count;
+    m_elapsed_since_tick_s += delta_time_s;
+
+    if ( !this->isThrottled() ) {
+        m_is_ticking = true;
+        m_tick_delta_s = delta_time_s;
+        m_elapsed_since_tick_s = 0.0;
+        return;
+    }
+
+    m_is_ticking = true;
+    if (tick_divisor > 1 && (m_frame_count % tick_divisor) != 0)
+        m_is_ticking = false;
+    // small tolerance, so summed frame deltas don't miss a tick by rounding
+    if (tick_rate_hz > 0.0 && m_elapsed_since_tick_s < 1.0 / tick_rate_hz - 1e-9)
+        m_is_ticking = false;
+    if ( !m_is_ticking )
+        return;
+
+    const double elapsed_s = m_elapsed_since_tick_s;
+    m_elapsed_since_tick_s = 0.0;
+
+    if (time_slices <= 1) {
+        m_tick_delta_s = elapsed_s;
+        return;
+    }
+
+    // every slice ages, the visited slice gets all the time since its last visit
+    if (m_slice_elapsed_s.size() != time_slices) {
+        m_slice_elapsed_s.assign(time_slices, 0.0);
+        m_current_slice = 0;
+    } else {
+        m_current_slice = (m_current_slice + 1) % time_slices;
+    }
+    for (double& slice_elapsed_s : m_slice_elapsed_s)
+        slice_elapsed_s += elapsed_s;
+
+    m_tick_delta_s = m_slice_elapsed_s[m_current_slice];
+    m_slice_elapsed_s[m_current_slice] = 0.0;
+}
+
+
 // ===================== Hierarchy System =====================
 
 #define HIERARCHY_STACK_CHILD_COUNT 4
@@ -293,6 +340,10 @@ Result<VoidResult, GameError> ScriptSystem::OnEntityDestroyed(EntityManager* ent
         if (!(this->m_script_components_mask[cindex]))
             continue; // skip non-script components
 
+        IScriptBatch* batch = this->__getScriptBatch(cindex);
+        if (batch && !batch->hasHook(SCRIPT_HOOK_ON_DESTROY))
+            continue;
+
         ScriptComponent* script_comp = entity_mgr->getEntityComponentCasted<ScriptComponent>(
                 entity_id, cindex);
 
@@ -303,28 +354,166 @@ Result<VoidResult, GameError> ScriptSystem::OnEntityDestroyed(EntityManager* ent
         if ( !res.isOk() )
             return res;
     }
+
+    // Subscriptions of the entity are skipped from now on, and removed once
+    // enough of them piled up
+    if (entity_id.id < this->m_subscribed_scripts.size()) {
+        SubscribedScripts& subscribed = this->m_subscribed_scripts[entity_id.id];
+        if (subscribed.version == entity_id.version && subscribed.mask.any()) {
+            const size_t count = subscribed.mask.count();
+            subscribed.mask.reset();
+            this->m_subscribed_count -= count;
+            this->m_stale_subscribed_count += count;
+        }
+    }
+
+    for (auto& batch : this->m_script_batches) {
+        if (batch)
+            batch->remove(entity_id.id);
+    }
+
+    if (this->m_stale_subscribed_count > 64 && this->m_stale_subscribed_count > this->m_subscribed_count) {
+        this->m_event_registry.unsubscribeIf(
+                [this] (const ScriptEventSubscriber& subscriber) {
+                    return this->__isSubscriberStale(subscriber);
+                });
+        this->m_stale_subscribed_count = 0;
+    }
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> ScriptSystem::OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id) {
+    if (component_info->ctag != CTAG_Script)
+        return ResultOK;
+
+    // the component isn't attached to the entity yet, subscribe it later
+    ScriptEventSubscriber subscriber = { entity_id, component_info->cindex };
+    this->m_pending_subscribers.push_back(subscriber);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> ScriptSystem::OnComponentRemovedFromEntity(const ComponentDataPayload* component_info, EntityID entity_id) {
+    if (component_info->ctag != CTAG_Script)
+        return ResultOK;
+
+    // event subscriptions are skipped by OnEvent() once the component is gone,
+    // and replaced if a script of the same type is added back
+    IScriptBatch* batch = this->__getScriptBatch(component_info->cindex);
+    if (batch)
+        batch->remove(entity_id.id);
+
     return ResultOK;
 }
 
 
+IScriptBatch* ScriptSystem::__getScriptBatch(size_t cindex) const {
+    if (cindex >= this->m_script_batches.size())
+        return nullptr;
+    return this->m_script_batches[cindex].get();
+}
+
+
+void ScriptSystem::__createScriptBatch(size_t cindex, EntityManager* entity_mgr) {
+    if (cindex >= this->m_script_batches.size())
+        this->m_script_batches.resize(cindex + 1);
+    this->m_script_batches[cindex] = std::shared_ptr<IScriptBatch>(
+            entity_mgr->__createScriptBatch(cindex)
+            );
+
+    // rebuilt in component index order, script types are few
+    this->m_update_batches.clear();
+    this->m_late_update_batches.clear();
+    this->m_fixed_update_batches.clear();
+    for (auto& batch : this->m_script_batches) {
+        if ( !batch )
+            continue;
+        if (batch->hasHook(SCRIPT_HOOK_UPDATE))
+            this->m_update_batches.push_back(batch.get());
+        if (batch->hasHook(SCRIPT_HOOK_LATE_UPDATE))
+            this->m_late_update_batches.push_back(batch.get());
+        if (batch->hasHook(SCRIPT_HOOK_FIXED_UPDATE))
+            this->m_fixed_update_batches.push_back(batch.get());
+    }
+}
+
+
+bool ScriptSystem::__isSubscriberStale(const ScriptEventSubscriber& subscriber) const {
+    const SubscribedScripts& subscribed = this->m_subscribed_scripts[subscriber.entity.id];
+    return subscribed.version != subscriber.entity.version
+        || !subscribed.mask[subscriber.cindex];
+}
+
+
+void ScriptSystem::__subscribePendingScripts(EntityManager* entity_mgr) {
+    if (this->m_pending_subscribers.empty())
+        return;
+
+    if (this->m_subscribed_scripts.empty())
+        this->m_subscribed_scripts.resize(MAX_ENTITIES);
+
+    for (const ScriptEventSubscriber& subscriber : this->m_pending_subscribers) {
+        auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
+                subscriber.entity, subscriber.cindex);
+        if ( !script )
+            continue; // destroyed before it got subscribed
+
+        if ( !this->__getScriptBatch(subscriber.cindex) )
+            this->__createScriptBatch(subscriber.cindex, entity_mgr);
+
+        IScriptBatch* batch = this->__getScriptBatch(subscriber.cindex);
+        if (batch) {
+            batch->add(subscriber.entity, script);
+            if ( !batch->hasHook(SCRIPT_HOOK_ON_EVENT) )
+                continue; // nothing to dispatch events to
+        }
+
+        SubscribedScripts& subscribed = this->m_subscribed_scripts[subscriber.entity.id];
+        if (subscribed.version != subscriber.entity.version) {
+            subscribed.version = subscriber.entity.version;
+            subscribed.mask.reset();
+        }
+
+        if (subscribed.mask[subscriber.cindex]) {
+            // script replaced, drop the subscriptions of the previous one
+            this->m_event_registry.unsubscribeIf(
+                    [&subscriber] (const ScriptEventSubscriber& other) {
+                        return other.entity == subscriber.entity && other.cindex == subscriber.cindex;
+                    });
+        } else {
+            subscribed.mask.set(subscriber.cindex);
+            ++this->m_subscribed_count;
+        }
+
+        EventRegistry<ScriptEventSubscriber>::Subscription subscription(
+                &this->m_event_registry, subscriber
+                );
+        script->SubscribeEvents(&subscription);
+    }
+    this->m_pending_subscribers.clear();
+}
+
+
 Result<VoidResult, GameError> ScriptSystem::OnEvent (SDL_Event *event, EntityManager* entity_mgr) {
-    // std::cout << "ScriptSystem::OnEvent" << std::endl;
-    for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
-        if (!(this->m_script_components_mask[cindex]))
-            continue; // skip non-script components
+    this->__subscribePendingScripts(entity_mgr);
 
-        // std::cout << "<< cindex=" << cindex << " >>" << std::endl;
+    // copied, scripts may create or destroy entities while handling the event
+    this->m_dispatch_subscribers.clear();
+    for (auto& entry : this->m_event_registry.subscribersOf(event->type))
+        this->m_dispatch_subscribers.push_back(entry.subscriber);
 
-        std::bitset<MAX_COMPONENTS> mask;
-        mask.reset();
-        mask.set(cindex);
-        for (auto ent_id : EntityView(entity_mgr, mask, true)) {
-            auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
-                    ent_id, cindex);
-            auto res = script->OnEvent(event, entity_mgr, ent_id);
-            if ( !res.isOk() ) {
-                return res;
-            }
+    for (const ScriptEventSubscriber& subscriber : this->m_dispatch_subscribers) {
+        auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
+                subscriber.entity, subscriber.cindex);
+        if ( !script )
+            continue; // destroyed or removed since it subscribed
+
+        auto res = script->OnEvent(event, entity_mgr, subscriber.entity);
+        if ( !res.isOk() ) {
+            return res;
         }
     }
 
@@ -334,6 +523,9 @@ Result<VoidResult, GameError> ScriptSystem::OnEvent (SDL_Event *event, EntityMan
 /*Result<VoidResult, GameError> PreDraw(RenderContext* renderContext, EntityManager* entity_mgr);*/
 /*Result<VoidResult, GameError> Draw(RenderContext* renderContext, EntityManager* entity_mgr);*/
 Result<VoidResult, GameError> ScriptSystem::Initialize(Game* game, EntityManager* entity_mgr) {
+    this->m_job_pool = game->jobPool;
+    this->__subscribePendingScripts(entity_mgr);
+
     auto uninitialized_entities = entity_mgr->getUninitializedEntities();
     for (auto& ent_id : uninitialized_entities) {
 
@@ -341,6 +533,10 @@ Result<VoidResult, GameError> ScriptSystem::Initialize(Game* game, EntityManager
             if (!(this->m_script_components_mask[cindex]))
                 continue; // skip non-script components
 
+            IScriptBatch* batch = this->__getScriptBatch(cindex);
+            if (batch && !batch->hasHook(SCRIPT_HOOK_INIT))
+                continue;
+
             if (!(entity_mgr->isEntityHasComponent(ent_id, cindex))) {
                 continue; // skip if entity doesn't have this particular script component
             }
@@ -357,42 +553,68 @@ Result<VoidResult, GameError> ScriptSystem::Initialize(Game* game, EntityManager
 };
 
 Result<VoidResult, GameError> ScriptSystem::Update(double delta_time_s, EntityManager* entity_mgr) {
-    for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
-        if (!(this->m_script_components_mask[cindex]))
-            continue; // skip non-script components
-
-        std::bitset<MAX_COMPONENTS> mask;
-        mask.reset();
-        mask.set(cindex);
-        for (auto ent_id : EntityView(entity_mgr, mask, false)) {
-            auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
-                    ent_id, cindex);
-            // std::cout << "ScriptSystem::Update => script->Update(id=" << ent_id.id << ")" << std::endl;
-            auto res = script->Update(delta_time_s, entity_mgr, ent_id);
-            if ( !res.isOk() )
-                return res;
+    // scripts added since Initialize() are updated from the next frame,
+    // after their Init()
+    for (IScriptBatch* batch : this->m_update_batches) {
+        Result<VoidResult, GameError> res;
+        if (this->m_job_pool && batch->isParallelSafe()) {
+            res = this->__updateParallel(batch, delta_time_s, entity_mgr);
+        } else {
+            res = batch->updateAll(
+                    delta_time_s, entity_mgr,
+                    this->schedule.time_slices, this->schedule.currentSlice()
+                    );
         }
+        if ( !res.isOk() )
+            return res;
     }
 
     return ResultOK;
 };
 
 
-Result<VoidResult, GameError> ScriptSystem::LateUpdate(double delta_time_s, EntityManager* entity_mgr) {
-    for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
-        if (!(this->m_script_components_mask[cindex]))
-            continue; // skip non-script components
+Result<VoidResult, GameError> ScriptSystem::__updateParallel(IScriptBatch* batch, double delta_time_s, EntityManager* entity_mgr) {
+    const size_t instance_count = batch->size();
+    const size_t chunk_count = (instance_count + SCRIPT_PARALLEL_CHUNK_SIZE - 1) / SCRIPT_PARALLEL_CHUNK_SIZE;
+    if (this->m_chunk_command_buffers.size() < chunk_count)
+        this->m_chunk_command_buffers.resize(chunk_count);
+    this->m_chunk_results.assign(chunk_count, ResultOK);
+
+    const unsigned int time_slices = this->schedule.time_slices;
+    const unsigned int current_slice = this->schedule.currentSlice();
+    this->m_job_pool->parallelFor(chunk_count, [&] (size_t chunk) {
+            const size_t begin = chunk * SCRIPT_PARALLEL_CHUNK_SIZE;
+            EntityManager::__setThreadCommandBuffer(&this->m_chunk_command_buffers[chunk]);
+            this->m_chunk_results[chunk] = batch->updateRange(
+                    begin, begin + SCRIPT_PARALLEL_CHUNK_SIZE,
+                    delta_time_s, entity_mgr,
+                    time_slices, current_slice
+                    );
+            EntityManager::__setThreadCommandBuffer(nullptr);
+            });
 
-        std::bitset<MAX_COMPONENTS> mask;
-        mask.reset();
-        mask.set(cindex);
-        for (auto ent_id : EntityView(entity_mgr, mask, false)) {
-            auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
-                    ent_id, cindex);
-            auto res = script->LateUpdate(delta_time_s, entity_mgr, ent_id);
-            if ( !res.isOk() )
-                return res;
-        }
+    // applied on this thread, in the same order whatever the thread count;
+    // the batch may shrink while destroying entities
+    for (size_t chunk=0; chunk<chunk_count; ++chunk)
+        this->m_chunk_command_buffers[chunk].playback(entity_mgr);
+
+    for (size_t chunk=0; chunk<chunk_count; ++chunk) {
+        if ( !this->m_chunk_results[chunk].isOk() )
+            return this->m_chunk_results[chunk];
+    }
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> ScriptSystem::LateUpdate(double delta_time_s, EntityManager* entity_mgr) {
+    for (IScriptBatch* batch : this->m_late_update_batches) {
+        auto res = batch->lateUpdateAll(
+                delta_time_s, entity_mgr,
+                this->schedule.time_slices, this->schedule.currentSlice()
+                );
+        if ( !res.isOk() )
+            return res;
     }
 
     return ResultOK;
@@ -400,20 +622,10 @@ Result<VoidResult, GameError> ScriptSystem::LateUpdate(double delta_time_s, Enti
 
 
 Result<VoidResult, GameError> ScriptSystem::FixedUpdate(double delta_time_s, EntityManager* entity_mgr) {
-    for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
-        if (!(this->m_script_components_mask[cindex]))
-            continue; // skip non-script components
-
-        std::bitset<MAX_COMPONENTS> mask;
-        mask.reset();
-        mask.set(cindex);
-        for (auto ent_id : EntityView(entity_mgr, mask, false)) {
-            auto script = entity_mgr->getEntityComponentCasted<ScriptComponent>(
-                    ent_id, cindex);
-            auto res = script->FixedUpdate(delta_time_s, entity_mgr, ent_id);
-            if ( !res.isOk() )
-                return res;
-        }
+    for (IScriptBatch* batch : this->m_fixed_update_batches) {
+        auto res = batch->fixedUpdateAll(delta_time_s, entity_mgr);
+        if ( !res.isOk() )
+            return res;
     }
 
     return ResultOK;
@@ -435,7 +647,7 @@ Result<VoidResult, GameError> RenderingSystem::OnComponentRegistered(const Compo
 
 
 Result<VoidResult, GameError> RenderingSystem::Initialize(Game* game, EntityManager* entity_mgr) {
-    std::cout << "RenderingSystem::Initialize" << std::endl;
+    PIXBENCH_LOG_TRACE("RenderingSystem::Initialize");
     auto uninitialized_entities = entity_mgr->getUninitializedEntities();
     for (auto& ent_id : uninitialized_entities) {
 
@@ -457,7 +669,7 @@ Result<VoidResult, GameError> RenderingSystem::Initialize(Game* game, EntityMana
             }
         }
     }
-    std::cout << "RenderingSystem::Initialize::END" << std::endl;
+    PIXBENCH_LOG_TRACE("RenderingSystem::Initialize::END");
 
     return ResultOK;
 }
@@ -465,12 +677,15 @@ Result<VoidResult, GameError> RenderingSystem::Initialize(Game* game, EntityMana
 
 Result<VoidResult, GameError> RenderingSystem::LateUpdate(double delta_time_s, EntityManager* entity_mgr) {
     // Performing animation update (moving the srect)
-    std::cout << "RenderingSystem::LateUpdate" << std::endl;
+    PIXBENCH_LOG_TRACE("RenderingSystem::LateUpdate");
 
     for (EntityID ent_id : EntityView(entity_mgr, m_renderable_components_mask, false)) {
         if ( !(entity_mgr->isEntityHasComponent<Transform>(ent_id)) )
             continue;
 
+        if ( !this->schedule.isInCurrentSlice(ent_id) )
+            continue;
+
         for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
             if (!(this->m_renderable_components_mask[cindex]))
                 continue; // skip non-renderable components
@@ -498,7 +713,7 @@ Result<VoidResult, GameError> RenderingSystem::LateUpdate(double delta_time_s, E
 
                 auto sprite_anim = sprite->GetSpriteAnimation().lock();
                 if ( !sprite_anim ) {
-                    std::cout << "ENT" << ent_id.id << " DOESN'T HAVE SPRITE ANIM" << std::endl;
+                    PIXBENCH_LOG_DEBUG("Entity {} doesn't have sprite animation", ent_id.id);
                     continue;
                 }
 
@@ -536,115 +751,230 @@ Result<VoidResult, GameError> RenderingSystem::LateUpdate(double delta_time_s, E
                 if ( !tile_map )
                     continue;
 
-                for (unsigned int i=0; i < tile_map->tile_counts; ++i) {
-                    TileAnimation* tile_anim = tile_map->getTileAnimation(i);
-                    if ( !tile_anim )
-                        continue;
-
-                    tile_anim->advanceFrameByTime(delta_time_s * 1000.0);
-                }
+                tile_map->advanceAnimations(delta_time_s * 1000.0);
             }
         }
     }
 
-    std::cout << "RenderingSystem::Update::END" << std::endl;
+    PIXBENCH_LOG_TRACE("RenderingSystem::LateUpdate::END");
 
     return ResultOK;
 };
 
 
-Result<VoidResult, GameError> RenderingSystem::PreDraw(RenderContext* renderContext, EntityManager* entity_mgr) {
-    std::cout << "RenderingSystem::PreDraw" << std::endl;
-    ordered_renderables.clear();
-    for (EntityID ent_id : EntityView(entity_mgr, m_renderable_components_mask, false)) {
-        if ( !(entity_mgr->isEntityHasComponent<Transform>(ent_id)) )
+Result<VoidResult, GameError> RenderingSystem::OnComponentAddedToEntity(const ComponentDataPayload* component_info, EntityID entity_id) {
+    if (component_info->ctag == CTAG_Renderable || component_info->ctype == typeid(Transform).hash_code())
+        m_entities_to_index.push_back(entity_id);
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> RenderingSystem::OnComponentRemovedFromEntity(const ComponentDataPayload* component_info, EntityID entity_id) {
+    if (component_info->ctag == CTAG_Renderable || component_info->ctype == typeid(Transform).hash_code()) {
+        // the component is still there, its other renderables are indexed
+        // again once it's gone
+        this->__unindexEntity(entity_id);
+        m_entities_to_index.push_back(entity_id);
+    }
+
+    return ResultOK;
+}
+
+
+Result<VoidResult, GameError> RenderingSystem::OnEntityDestroyed(EntityManager* entity_mgr, EntityID entity_id) {
+    this->__unindexEntity(entity_id);
+
+    return ResultOK;
+}
+
+
+void RenderingSystem::__unindexEntity(EntityID entity_id) {
+    auto slots_it = m_entity_renderable_slots.find(entity_id.id);
+    if (slots_it == m_entity_renderable_slots.end())
+        return;
+
+    for (uint32_t slot : slots_it->second) {
+        m_renderable_grid.remove(slot);
+        m_indexed_renderables[slot] = IndexedRenderable();
+        m_free_renderable_slots.push_back(slot);
+    }
+    m_entity_renderable_slots.erase(slots_it);
+}
+
+
+void RenderingSystem::__indexPendingEntities(EntityManager* entity_mgr) {
+    for (EntityID ent_id : m_entities_to_index) {
+        // an entity can be queued several times
+        this->__unindexEntity(ent_id);
+
+        if ( !entity_mgr->isEntityValid(ent_id) )
+            continue;
+
+        Transform* transform = entity_mgr->getEntityComponent<Transform>(ent_id);
+        if (!transform)
             continue;
 
         for (size_t cindex=0; cindex<MAX_COMPONENTS; ++cindex) {
             if (!(this->m_renderable_components_mask[cindex]))
-                continue; // skip non-script components
+                continue; // skip non-renderable components
 
-            Transform* transform = entity_mgr->getEntityComponent<Transform>(ent_id);
-            if (!transform)
+            if (!(entity_mgr->isEntityHasComponent(ent_id, cindex)))
                 continue;
 
             RenderableComponent* renderable = entity_mgr->getEntityComponentCasted<RenderableComponent>(
                     ent_id, cindex);
-
             if (!renderable)
                 continue;
 
+            // components never move in their array, the pointers stay valid
+            // until the component is removed
             renderable->transform = transform;
 
-            // visibility check
-            if (renderable->getRenderableTag() == RCTAG_Sprite) {
-                // check if sprite rect inside the screen
-                Sprite* sprite = static_cast<Sprite*>(renderable);
-                const Vector2 sprite_position__scn = Vector2(
-                        sprite->offset.x + sprite->transform->GlobalPosition().x,
-                        sprite->offset.y + sprite->transform->GlobalPosition().y
-                        );
-                const Vector2 sprite_position__cam = sceneToCamSpace(
-                        renderContext,
-                        sprite_position__scn
-                        );
-                sprite->drect.x = sprite_position__cam.x;
-                sprite->drect.y = sprite_position__cam.y;
-
-                const SDL_FRect r = sprite->drect;
-                const float cam_w = renderContext->camera_size.x;
-                const float cam_h = renderContext->camera_size.y;
-                if (
-                        !(
-                            std::max(r.x+r.w, cam_w) - std::min(r.x, 0.0f) < (cam_w+r.w)
-                            &&
-                            std::max(r.y+r.h, cam_h) - std::min(r.y, 0.0f) < (cam_h+r.h)
-                         )
-                   ) { // skip if not visible
-                    continue;
-                }
+            uint32_t slot;
+            if ( !m_free_renderable_slots.empty() ) {
+                slot = m_free_renderable_slots.back();
+                m_free_renderable_slots.pop_back();
+            } else {
+                slot = (uint32_t)m_indexed_renderables.size();
+                m_indexed_renderables.push_back(IndexedRenderable());
             }
-            else if (renderable->getRenderableTag() == RCTAG_Tile) {
-                Tile* tile = static_cast<Tile*>(renderable);
-                if (!tile)
-                    continue;
 
-                if (auto tile_map = tile->getTileMap().lock()) {
-                    const Vector2 tile_pos = tile->transform->GlobalPosition();
-                    const Vector2 tile_pos__cam = sceneToCamSpace(renderContext, tile_pos);
-                    tile->drect.x = tile_pos__cam.x;
-                    tile->drect.y = tile_pos__cam.y;
-                    tile->drect.w = tile_map->width;
-                    tile->drect.h = tile_map->height;
-                    const SDL_FRect r = tile->drect;
-
-                    const float cam_w = renderContext->camera_size.x;
-                    const float cam_h = renderContext->camera_size.y;
-
-                    if (
-                            !(
-                                std::max(r.x+r.w, cam_w) - std::min(r.x, 0.0f) < (cam_w+r.w)
-                                &&
-                                std::max(r.y+r.h, cam_h) - std::min(r.y, 0.0f) < (cam_h+r.h)
-                             )
-                       ) { // skip if not visible
-                        continue;
-                    }
+            IndexedRenderable& indexed = m_indexed_renderables[slot];
+            indexed.entity = ent_id;
+            indexed.cindex = cindex;
+            indexed.renderable = renderable;
+            indexed.tag = renderable->getRenderableTag();
+            m_entity_renderable_slots[ent_id.id].push_back(slot);
+        }
+    }
+    m_entities_to_index.clear();
+}
 
-                }
-            }
-            else if (renderable->getRenderableTag() == RCTAG_Script) {
-                // TODO: check if drawable script rect inside the screen
-                CustomRenderable* custom_renderable = static_cast<CustomRenderable*>(renderable);
 
-                if ( custom_renderable->is_always_visible ) {
-                    ordered_renderables.push_back(renderable);
+/**
+ * Whether `r`, in camera space, overlaps a camera of size `cam_size`.
+ */
+static bool isRectInCamera(const SDL_FRect& r, const Vector2& cam_size) {
+    const float cam_w = cam_size.x;
+    const float cam_h = cam_size.y;
+    return std::max(r.x+r.w, cam_w) - std::min(r.x, 0.0f) < (cam_w+r.w)
+        && std::max(r.y+r.h, cam_h) - std::min(r.y, 0.0f) < (cam_h+r.h);
+}
+
+
+Result<VoidResult, GameError> RenderingSystem::PreDraw(RenderContext* renderContext, EntityManager* entity_mgr) {
+    PIXBENCH_LOG_TRACE("RenderingSystem::PreDraw");
+    this->__indexPendingEntities(entity_mgr);
+
+    // Move the renderables in the grid, by their bounds in scene space
+    // between the last two FixedUpdate steps, so any interpolation_alpha is
+    // covered. Only renderables moving to another cell cost more than a few
+    // loads.
+    for (uint32_t slot=0; slot<m_indexed_renderables.size(); ++slot) {
+        const IndexedRenderable& indexed = m_indexed_renderables[slot];
+        if (!indexed.renderable)
+            continue;
+
+        Transform* transform = indexed.renderable->transform;
+        const Vector2 previous_position = transform->InterpolatedPosition(0.0);
+        const Vector2 position = transform->GlobalPosition();
+        SDL_FRect bounds = {
+            std::min(previous_position.x, position.x),
+            std::min(previous_position.y, position.y),
+            std::abs(position.x - previous_position.x) + indexed.renderable->drect.w,
+            std::abs(position.y - previous_position.y) + indexed.renderable->drect.h
+        };
+
+        if (indexed.tag == RCTAG_Sprite) {
+            const Sprite* sprite = static_cast<const Sprite*>(indexed.renderable);
+            bounds.x += sprite->offset.x;
+            bounds.y += sprite->offset.y;
+            m_renderable_grid.update(slot, bounds);
+        }
+        else if (indexed.tag == RCTAG_Script) {
+            const CustomRenderable* custom_renderable = static_cast<const CustomRenderable*>(indexed.renderable);
+            bounds.x += custom_renderable->offset.x;
+            bounds.y += custom_renderable->offset.y;
+            m_renderable_grid.update(slot, bounds, custom_renderable->is_always_visible);
+        }
+        else {
+            // tile maps are few and large, always check them
+            m_renderable_grid.update(slot, bounds, true);
+        }
+    }
+
+    // Only the renderables near the camera are checked
+    const SDL_FRect camera_area__scn = {
+        renderContext->camera_position.x,
+        renderContext->camera_position.y,
+        renderContext->camera_size.x,
+        renderContext->camera_size.y
+    };
+    m_visible_slots.clear();
+    m_renderable_grid.query(camera_area__scn, &m_visible_slots);
+
+    const Vector2 cam_size = renderContext->camera_size;
+    m_render_queue.clear();
+    for (uint32_t slot : m_visible_slots) {
+        RenderableComponent* renderable = m_indexed_renderables[slot].renderable;
+        uint32_t texture_id = 0;
+
+        // visibility check
+        if (m_indexed_renderables[slot].tag == RCTAG_Sprite) {
+            // check if sprite rect inside the screen
+            Sprite* sprite = static_cast<Sprite*>(renderable);
+            const Vector2 sprite_global_position = sprite->transform->InterpolatedPosition(
+                    renderContext->interpolation_alpha
+                    );
+            const Vector2 sprite_position__scn = Vector2(
+                    sprite->offset.x + sprite_global_position.x,
+                    sprite->offset.y + sprite_global_position.y
+                    );
+            const Vector2 sprite_position__cam = sceneToCamSpace(
+                    renderContext,
+                    sprite_position__scn
+                    );
+            sprite->drect.x = sprite_position__cam.x;
+            sprite->drect.y = sprite_position__cam.y;
+
+            if ( !isRectInCamera(sprite->drect, cam_size) ) // skip if not visible
+                continue;
+
+            if (sprite->texture)
+                texture_id = sprite->texture->id;
+        }
+        else if (m_indexed_renderables[slot].tag == RCTAG_Tile) {
+            Tile* tile = static_cast<Tile*>(renderable);
+
+            if (auto tile_map = tile->getTileMap().lock()) {
+                const Vector2 tile_pos = tile->transform->InterpolatedPosition(
+                        renderContext->interpolation_alpha
+                        );
+                const Vector2 tile_pos__cam = sceneToCamSpace(renderContext, tile_pos);
+                tile->drect.x = tile_pos__cam.x;
+                tile->drect.y = tile_pos__cam.y;
+                tile->drect.w = tile_map->width;
+                tile->drect.h = tile_map->height;
+
+                if ( !isRectInCamera(tile->drect, cam_size) ) // skip if not visible
                     continue;
-                }
 
+                auto atlass = tile_map->getAtlass().lock();
+                if (atlass && atlass->getTexture())
+                    texture_id = atlass->getTexture()->id;
+            }
+        }
+        else if (m_indexed_renderables[slot].tag == RCTAG_Script) {
+            CustomRenderable* custom_renderable = static_cast<CustomRenderable*>(renderable);
+
+            if ( !custom_renderable->is_always_visible ) {
+                const Vector2 render_global_position = custom_renderable->transform->InterpolatedPosition(
+                        renderContext->interpolation_alpha
+                        );
                 const Vector2 render_position__scn = Vector2(
-                        custom_renderable->offset.x + custom_renderable->transform->GlobalPosition().x,
-                        custom_renderable->offset.y + custom_renderable->transform->GlobalPosition().y
+                        custom_renderable->offset.x + render_global_position.x,
+                        custom_renderable->offset.y + render_global_position.y
                         );
                 const Vector2 render_position__cam = sceneToCamSpace(
                         renderContext,
@@ -653,64 +983,59 @@ Result<VoidResult, GameError> RenderingSystem::PreDraw(RenderContext* renderCont
                 custom_renderable->drect.x = render_position__cam.x;
                 custom_renderable->drect.y = render_position__cam.y;
 
-                const SDL_FRect r = custom_renderable->drect;
-                const float cam_w = renderContext->camera_size.x;
-                const float cam_h = renderContext->camera_size.y;
-                if (
-                        !(
-                            std::max(r.x+r.w, cam_w) - std::min(r.x, 0.0f) < (cam_w+r.w)
-                            &&
-                            std::max(r.y+r.h, cam_h) - std::min(r.y, 0.0f) < (cam_h+r.h)
-                         )
-                   ) { // skip if not visible
+                if ( !isRectInCamera(custom_renderable->drect, cam_size) ) // skip if not visible
                     continue;
-                }
             }
-
-            ordered_renderables.push_back(renderable);
         }
+
+        const IndexedRenderable& indexed = m_indexed_renderables[slot];
+        m_render_queue.push(
+                RenderQueue::makeSortKey(renderable->depth, texture_id, indexed.entity.id, indexed.cindex),
+                slot
+                );
     }
 
-    // Calculate render order by depth (higher is the closer forward)
-    std::sort(
-            ordered_renderables.begin(),
-            ordered_renderables.end(),
-            [] (const RenderableComponent* renderable_a, const RenderableComponent* renderable_b) {
-                return renderable_a->depth < renderable_b->depth;
-            }
-            );
-    std::cout << "RenderingSystem::PreDraw::END" << std::endl;
+    // Calculate render order by depth (higher is the closer forward), then
+    // texture so equal depths batch together
+    m_render_queue.sort();
+    ordered_renderables.clear();
+    for (const RenderQueueEntry& entry : m_render_queue.entries())
+        ordered_renderables.push_back(m_indexed_renderables[entry.item].renderable);
+    PIXBENCH_LOG_TRACE("RenderingSystem::PreDraw::END");
 
     return ResultOK;
 }
 
 
-Result<VoidResult, GameError> RenderingSystem::Draw(RenderContext* renderContext, EntityManager* entity_mgr) {
-    std::cout << "RenderingSystem::Draw" << std::endl;
+Result<VoidResult, GameError> RenderingSystem::RecordDraw(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) {
+    PIXBENCH_LOG_TRACE("RenderingSystem::RecordDraw");
 
     for (RenderableComponent* renderable : ordered_renderables) {
         if (renderable->getRenderableTag() == RCTAG_Sprite) {
             Sprite* sprite = static_cast<Sprite*>(renderable);
             const SDL_FRect sprite_drect__scr = camToScreenSpace(renderContext, sprite->drect);
-            bool err = SDL_RenderTextureRotated(
-                    renderContext->renderer,
-                    sprite->texture->texture,
+            snapshot->renderTextureRotated(
+                    sprite->texture,
                     &(sprite->srect), &(sprite_drect__scr),
-                    180 * sprite->transform->rotation / M_PI,
-                    nullptr,
+                    180 * sprite->transform->InterpolatedRotation(renderContext->interpolation_alpha) / M_PI,
                     sprite->flip_mode
                     );
-            if (sprite->srect.w == 0 || sprite->srect.h == 0) {
-                std::cout << "<< ERROR >> sprite->srect w & h = 0" << std::endl;
-            }
-            if (!err) {
-                std::cout << "<< ERROR >> problem in rendering sprite" << std::endl;
-                std::cout << "SDL error:" << std::endl << SDL_GetError() << std::endl;
-            }
         }
         else if (renderable->getRenderableTag() == RCTAG_Script) {
             CustomRenderable* custom_renderable = static_cast<CustomRenderable*>(renderable);
-            custom_renderable->Draw(renderContext, entity_mgr);
+            if (custom_renderable->DrawToSnapshot(snapshot, renderContext, entity_mgr))
+                continue;
+
+            if (m_is_recording_off_main_thread) {
+                if ( !m_warned_custom_renderable ) {
+                    PIXBENCH_LOG_WARNING(
+                            "CustomRenderable without DrawToSnapshot() is skipped in pipelined mode"
+                            );
+                    m_warned_custom_renderable = true;
+                }
+                continue;
+            }
+            snapshot->drawCustomRenderable(custom_renderable);
         }
         else if (renderable->getRenderableTag() == RCTAG_Tile) {
             // Find the ranges of tiles in the map to render
@@ -739,69 +1064,59 @@ Result<VoidResult, GameError> RenderingSystem::Draw(RenderContext* renderContext
                     tile_map->tile_h
                     );
 
-            // Perform for loop to draw tiles
-            // this first pass is only for drawing non animated tiles
-            SDL_FRect srect, drect;
-            drect.w = tile_map->tile_w;
-            drect.h = tile_map->tile_h;
-            drect = camToScreenSpace(renderContext, drect);     // scaling the size
-            for (int c=start_col; c<end_col; ++c) {
-                for (int r=start_row; r<end_row; ++r) {
-
-                    int tile_id = tile_map->getTileIDbyTilePosition(r, c);
-                    if (tile_id == 0)
-                        continue;
-
-                    srect = atlass->getRectByIndex(tile_id-1);
-                    const Vector2 this_tile_pos__scr = 
-                        camToScreenSpace(
-                                renderContext,
-                                Vector2(
-                                    tile->drect.x + c * tile_map->tile_w,
-                                    tile->drect.y + r * tile_map->tile_h
-                                )
+            // this first pass draws the non animated tiles, one baked
+            // chunk of quads at a time
+            const Vector2 layer_pos__scr = camToScreenSpace(renderContext, Vector2(r.x, r.y));
+            const Vector2 scale = camToScreenSpace(renderContext, Vector2(1.0f, 1.0f));
+            if (start_col < end_col && start_row < end_row) {
+                const int start_chunk_col = start_col / TILEMAP_CHUNK_SIZE;
+                const int start_chunk_row = start_row / TILEMAP_CHUNK_SIZE;
+                const int end_chunk_col = (end_col - 1) / TILEMAP_CHUNK_SIZE;
+                const int end_chunk_row = (end_row - 1) / TILEMAP_CHUNK_SIZE;
+                for (int chunk_r=start_chunk_row; chunk_r<=end_chunk_row; ++chunk_r) {
+                    for (int chunk_c=start_chunk_col; chunk_c<=end_chunk_col; ++chunk_c) {
+                        const TileMapChunk* chunk = tile_map->getBakedChunk(chunk_r, chunk_c);
+                        if (chunk->vertices.empty())
+                            continue;
+                        snapshot->renderQuads(
+                                atlass->getTexture(),
+                                chunk->vertices.data(), chunk->vertices.size(),
+                                layer_pos__scr, scale
                                 );
-                    drect.x = this_tile_pos__scr.x;
-                    drect.y = this_tile_pos__scr.y;
-
-                    SDL_RenderTexture(
-                            renderContext->renderer,
-                            atlass->getTexture()->texture,
-                            &srect, &drect
-                            );
+                    }
                 }
             }
 
             // this the second pass for Tile,
             // this one is for drawing animated tiles.
-            for (int c=start_col; c<end_col; ++c) {
-                for (int r=start_row; r<end_row; ++r) {
-                    unsigned int anim_tile_id = tile_map->getTileIDbyTilePosition(r, c);
-                    if (anim_tile_id == 0)
-                        continue;
-
-                    TileAnimation* tile_anim = tile_map->getTileAnimation(anim_tile_id);
-                    if (!tile_anim)
-                        continue;
-
-                    unsigned int tile_id = tile_anim->getCurrentFrame()->tile_id;
-                    srect = atlass->getRectByIndex(tile_id-1);
-                    drect.x = tile->drect.x + c * tile_map->tile_w;
-                    drect.y = tile->drect.y + r * tile_map->tile_h;
-
-                    // drect = camToScreenSpace(renderContext, drect);
-
-                    SDL_RenderTexture(
-                            renderContext->renderer,
-                            atlass->getTexture()->texture,
-                            &srect, &drect
-                            );
-                }
-            }
+            SDL_FRect srect, drect;
+            drect.w = tile_map->tile_w;
+            drect.h = tile_map->tile_h;
+            drect = camToScreenSpace(renderContext, drect);     // scaling the size
+            for (const AnimatedTile& animated_tile : tile_map->getAnimatedTiles()) {
+                const int c = animated_tile.index % tile_map->columns;
+                const int r = animated_tile.index / tile_map->columns;
+                if (c < start_col || c >= end_col || r < start_row || r >= end_row)
+                    continue;
+
+                if (animated_tile.animation->getTotalNumberOfFrames() == 0)
+                    continue;
+                unsigned int tile_id = animated_tile.animation->getCurrentFrame()->tile_id;
+                if (tile_id == 0)
+                    continue;
+
+                srect = atlass->getRectByIndex(tile_id-1);
+                drect.x = layer_pos__scr.x + c * tile_map->tile_w * scale.x;
+                drect.y = layer_pos__scr.y + r * tile_map->tile_h * scale.y;
 
+                snapshot->renderTexture(
+                        atlass->getTexture(),
+                        &srect, &drect
+                        );
+            }
         }
     }
-    std::cout << "RenderingSystem::Draw::END" << std::endl;
+    PIXBENCH_LOG_TRACE("RenderingSystem::Draw::END");
 
     return ResultOK;
 }
@@ -811,19 +1126,66 @@ Result<VoidResult, GameError> RenderingSystem::Draw(RenderContext* renderContext
 
 
 Result<VoidResult, GameError> AudioSystem::Initialize(Game* game, EntityManager* entity_mgr) {
-    std::cout << "AudioSystem::Initialize::BEGIN" << std::endl;
+    PIXBENCH_LOG_TRACE("AudioSystem::Initialize::BEGIN");
     // initialized states
     m_channel_states.resize(
             game->audioContext->numAvailableChannel()
             );
+    m_is_headless = game->audioContext->isHeadless();
 
-    std::cout << "AudioSystem::Initialize::END" << std::endl;
+    const SDL_AudioSpec& audio_spec = game->audioContext->audio_spec;
+    m_bytes_per_second = (double)SDL_AUDIO_FRAMESIZE(audio_spec) * audio_spec.freq;
+
+    PIXBENCH_LOG_TRACE("AudioSystem::Initialize::END");
     return ResultOK;
 }
 
 
+double AudioSystem::clipDuration(const AudioClip* clip) const {
+    if ( !clip || !clip->chunk || m_bytes_per_second <= 0.0 )
+        return 0.0;
+
+    // chunks are converted to the mixer format when loaded
+    return (double)clip->chunk->alen / m_bytes_per_second;
+}
+
+
 Result<VoidResult, GameError> AudioSystem::LateUpdate(double delta_time_s, EntityManager* entity_mgr) {
-    std::cout << "AudioSystem::LateUpdate::BEGINEN" << std::endl;
+    PIXBENCH_LOG_TRACE("AudioSystem::LateUpdate::BEGIN");
+
+    // null audio backend, acknowledge the play state changes and play
+    // clips in simulated time, so they finish as they would on a device
+    if ( m_is_headless ) {
+        for (EntityID ent_id : EntityViewByTypes<AudioPlayer>(entity_mgr)) {
+            AudioPlayer* audio_player = entity_mgr->getEntityComponent<AudioPlayer>(ent_id);
+            if ( !audio_player )
+                continue;
+
+            if ( audio_player->__isNeedSync() ) {
+                if ( !audio_player->isPlaying() )
+                    audio_player->__setIsFinished(true);
+                audio_player->__resetNeedSyncStatus();
+            }
+
+            if ( !audio_player->isPlaying() || audio_player->isPaused() )
+                continue;
+
+            const double duration = this->clipDuration(audio_player->clip.get());
+            double position = audio_player->getPosition() + delta_time_s;
+            if ( duration > 0.0 && position >= duration ) {
+                if ( audio_player->is_looping ) {
+                    position = std::fmod(position, duration);
+                } else {
+                    position = 0.0;
+                    audio_player->__setIsPlaying(false);
+                    audio_player->__setIsFinished(true);
+                }
+            }
+            audio_player->__setPosition(position);
+        }
+
+        return ResultOK;
+    }
 
     EntityID need_sync_entities[MAX_ENTITIES];
     int need_sync_entities_len = 0;
@@ -910,6 +1272,7 @@ Result<VoidResult, GameError> AudioSystem::LateUpdate(double delta_time_s, Entit
         if ( !is_channel_playing ) {
             m_channel_states[assigned_channel].is_playing = is_channel_playing;
             audio_player->__setIsPlaying(is_channel_playing);
+            audio_player->__setIsFinished(true);
             audio_player->__setAssignedChannel(-1);
         }
     }
@@ -949,7 +1312,7 @@ Result<VoidResult, GameError> AudioSystem::LateUpdate(double delta_time_s, Entit
         audio_player->__resetNeedSyncStatus();
     }
 
-    std::cout << "AudioSystem::LateUpdate::END" << std::endl;
+    PIXBENCH_LOG_TRACE("AudioSystem::LateUpdate::END");
     return ResultOK;
 }
 
@@ -1336,7 +1699,6 @@ void PhysicsSystem::__colliderCheckCollision(
 }
 
 
-SDL_Renderer* renderer = nullptr;
 Result<VoidResult, GameError> PhysicsSystem::FixedUpdate(double delta_time_s, EntityManager* entity_mgr) {
 
     this->__updateColliderObjectList(entity_mgr);
@@ -1389,8 +1751,7 @@ Result<VoidResult, GameError> PhysicsSystem::FixedUpdate(double delta_time_s, En
 }
 
 
-Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext, EntityManager* entity_mgr) {
-    renderer = renderContext->renderer;
+Result<VoidResult, GameError> PhysicsSystem::RecordDraw(RenderSnapshot* snapshot, RenderContext* renderContext, EntityManager* entity_mgr) {
 
 #ifdef PHYSICS_DEBUG_DRAW
 
@@ -1418,14 +1779,12 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                     BoxCollider* box_coll = static_cast<BoxCollider*>(coll);
                     const Vector2 coll_pos = box_coll->__transform.GlobalPosition();
                     if ( isEntityColliding(ent_id) ) {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 1.0, 0.0, 0.0, 1.0
                                 );
                     }
                     else {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 0.0, 1.0, 0.0, 1.0
                                 );
                     }
@@ -1443,8 +1802,7 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                             points[4] = { vert.x, vert.y };
                         }
                     }
-                    SDL_RenderLines(
-                            renderContext->renderer,
+                    snapshot->renderLines(
                             points,
                             5);
                     std::vector<CollisionEvent> coll_events = getEntityCollisionManifolds(ent_id);
@@ -1455,12 +1813,11 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                                     renderContext, manifold.points[i]
                                     );
 
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 0.0, 1.0, 1.0
                                     );
                             phydebDrawCross(
-                                    renderContext->renderer,
+                                    snapshot,
                                     &contact
                                     );
                         }
@@ -1473,14 +1830,12 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                     CircleCollider* circ_coll = static_cast<CircleCollider*>(coll);
                     Vector2 circ_pos = circ_coll->__transform.GlobalPosition();
                     if ( isEntityColliding(ent_id) ) {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 1.0, 0.0, 0.0, 1.0
                                 );
                     }
                     else {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 0.0, 1.0, 0.0, 1.0
                                 );
                     }
@@ -1496,9 +1851,9 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                      }
                     
                     const Vector2 _center = sceneToScreenSpace(renderContext, circ_pos);
-                    SDL_RenderPoint(renderContext->renderer, _center.x, _center.y);
-                    SDL_RenderLines(
-                            renderContext->renderer, circle_points, point_counts+1
+                    snapshot->renderPoint(_center.x, _center.y);
+                    snapshot->renderLines(
+                            circle_points, point_counts+1
                             );
 
                     // manifold
@@ -1508,20 +1863,17 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                         for (int i=0; i<manifold.point_count; ++i) {
                             Vector2 contact = sceneToScreenSpace(renderContext, manifold.points[i]);
 
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 0.0, 1.0, 1.0
                                     );
                             phydebDrawCross(
-                                    renderContext->renderer,
+                                    snapshot,
                                     &contact
                                     );
                             // normals
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 1.0, 0.5, 1.0);
-                            SDL_RenderLine(
-                                    renderContext->renderer,
+                            snapshot->renderLine(
                                     contact.x, contact.y,
                                     contact.x + manifold.normal.x*manifold.penetration_depth,
                                     contact.y + manifold.normal.y*manifold.penetration_depth
@@ -1539,14 +1891,12 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                     const Vector2 caps_p1 = caps_pos + Vector2::UP.rotated(caps_rot) * (caps_coll->length / 2.0);
                     const Vector2 caps_p2 = caps_pos + Vector2::DOWN.rotated(caps_rot) * (caps_coll->length / 2.0);
                     if ( isEntityColliding(ent_id) ) {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 1.0, 0.0, 0.0, 1.0
                                 );
                     }
                     else {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 0.0, 1.0, 0.0, 1.0
                                 );
                     }
@@ -1567,12 +1917,12 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                      }
 
                     const Vector2 _center = sceneToScreenSpace(renderContext, caps_pos);
-                    SDL_RenderPoint(renderContext->renderer, _center.x, _center.y);
-                    SDL_RenderLines(
-                            renderContext->renderer, circle_points_1, point_counts+1
+                    snapshot->renderPoint(_center.x, _center.y);
+                    snapshot->renderLines(
+                            circle_points_1, point_counts+1
                             );
-                    SDL_RenderLines(
-                            renderContext->renderer, circle_points_2, point_counts+1
+                    snapshot->renderLines(
+                            circle_points_2, point_counts+1
                             );
                     const Vector2 right_line_offset = Vector2::RIGHT.rotated(caps_rot) * caps_coll->radius;
                     const Vector2 left_line_offset = Vector2::LEFT.rotated(caps_rot) * caps_coll->radius;
@@ -1580,13 +1930,11 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                     const Vector2 right_line_p2 = sceneToScreenSpace(renderContext, caps_p2 + right_line_offset);
                     const Vector2 left_line_p1 = sceneToScreenSpace(renderContext, caps_p1 + left_line_offset);
                     const Vector2 left_line_p2 = sceneToScreenSpace(renderContext, caps_p2 + left_line_offset);
-                    SDL_RenderLine(
-                            renderContext->renderer,
+                    snapshot->renderLine(
                             right_line_p1.x, right_line_p1.y,
                             right_line_p2.x, right_line_p2.y
                             );
-                    SDL_RenderLine(
-                            renderContext->renderer,
+                    snapshot->renderLine(
                             left_line_p1.x, left_line_p1.y,
                             left_line_p2.x, left_line_p2.y
                             );
@@ -1598,20 +1946,17 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                         for (int i=0; i<manifold.point_count; ++i) {
                             Vector2 contact = sceneToScreenSpace(renderContext, manifold.points[i]);
 
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 0.0, 1.0, 1.0
                                     );
                             phydebDrawCross(
-                                    renderContext->renderer,
+                                    snapshot,
                                     &contact
                                     );
                             // normals
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 1.0, 0.5, 1.0);
-                            SDL_RenderLine(
-                                    renderContext->renderer,
+                            snapshot->renderLine(
                                     contact.x, contact.y,
                                     contact.x + manifold.normal.x*manifold.penetration_depth,
                                     contact.y + manifold.normal.y*manifold.penetration_depth
@@ -1626,14 +1971,12 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                     PolygonCollider* poly_coll = static_cast<PolygonCollider*>(coll);
                     const Vector2 coll_pos = poly_coll->__transform.GlobalPosition();
                     if ( isEntityColliding(ent_id) ) {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 1.0, 0.0, 0.0, 1.0
                                 );
                     }
                     else {
-                        SDL_SetRenderDrawColorFloat(
-                                renderContext->renderer,
+                        snapshot->setDrawColorFloat(
                                 0.0, 1.0, 0.0, 1.0
                                 );
                     }
@@ -1652,8 +1995,7 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                             points[poly_coll->__polygon.vertex_counts] = { vert.x, vert.y };
                         }
                     }
-                    SDL_RenderLines(
-                            renderContext->renderer,
+                    snapshot->renderLines(
                             points,
                             poly_coll->__polygon.vertex_counts+1);
                     // manifold
@@ -1663,20 +2005,17 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                         for (int i=0; i<manifold.point_count; ++i) {
                             Vector2 contact = sceneToScreenSpace(renderContext, manifold.points[i]);
 
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 0.0, 1.0, 1.0
                                     );
                             phydebDrawCross(
-                                    renderContext->renderer,
+                                    snapshot,
                                     &contact
                                     );
                             // normals
-                            SDL_SetRenderDrawColorFloat(
-                                    renderContext->renderer,
+                            snapshot->setDrawColorFloat(
                                     0.0, 1.0, 0.5, 1.0);
-                            SDL_RenderLine(
-                                    renderContext->renderer,
+                            snapshot->renderLine(
                                     contact.x, contact.y,
                                     contact.x + manifold.normal.x*manifold.penetration_depth,
                                     contact.y + manifold.normal.y*manifold.penetration_depth
@@ -1696,23 +2035,19 @@ Result<VoidResult, GameError> PhysicsSystem::Draw(RenderContext* renderContext,
                 coll->__bounding_radius*2,
                 coll->__bounding_radius*2
             };
-            SDL_SetRenderDrawColorFloat(
-                    renderContext->renderer,
+            snapshot->setDrawColorFloat(
                     0.0, 1.0, 0.0, 1.0
                     );
-            SDL_RenderRect(
-                    renderContext->renderer,
+            snapshot->renderRect(
                     &bbox_rect
                     );
 #endif
 
 #ifdef PHYSICS_DEBUG_DRAW_SHOW_ENTITY_ID
-            SDL_SetRenderDrawColorFloat(
-                    renderContext->renderer,
+            snapshot->setDrawColorFloat(
                     0.0, 1.0, 0.0, 1.0
                     );
-            SDL_RenderDebugText(
-                    renderContext->renderer,
+            snapshot->renderDebugText(
                     coll->__transform.GlobalPosition().x, coll->__transform.GlobalPosition().y,
                     std::string("ent id: ").append(std::to_string(coll->entity().id)).c_str()
                     );
@@ -0,0 +1,175 @@
+#include "pixbench/texture_atlas.h"
+#include "pixbench/utils/logger.h"
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_pixels.h>
+#include <algorithm>
+
+
+TextureAtlas::TextureAtlas(int page_size, int padding, SDL_ScaleMode scale_mode)
+    :
+        m_page_size(page_size),
+        m_padding(padding),
+        m_scale_mode(scale_mode)
+{ }
+
+
+TextureAtlas::~TextureAtlas() {
+    this->releaseSurfaces();
+}
+
+
+void TextureAtlas::releaseSurfaces() {
+    for (auto& image : m_images) {
+        if (image.surface)
+            SDL_DestroySurface(image.surface);
+        image.surface = nullptr;
+    }
+}
+
+
+TextureAtlasHandle TextureAtlas::addImage(const std::string& path) {
+    SDL_Surface* surface = nullptr;
+    if ( !m_is_packed ) {
+        surface = SDL_LoadBMP(path.c_str());
+        if (surface == NULL)
+            PIXBENCH_LOG_ERROR("Failed to load file {}: {}", path, SDL_GetError());
+    }
+    return this->addSurface(surface, path);
+}
+
+
+TextureAtlasHandle TextureAtlas::addSurface(SDL_Surface* surface, const std::string& name) {
+    if (m_is_packed) {
+        PIXBENCH_LOG_ERROR("Can't add {} to a TextureAtlas that is already packed", name);
+        if (surface)
+            SDL_DestroySurface(surface);
+        surface = nullptr;
+    }
+
+    AtlasImage image;
+    image.source = name;
+    image.surface = surface;
+    m_images.push_back(image);
+    return m_images.size() - 1;
+}
+
+
+void TextureAtlas::placeImages(std::vector<SDL_Point>* out__page_sizes) {
+    // tallest first, so each shelf wastes little height
+    std::vector<size_t> order;
+    for (size_t i=0; i<m_images.size(); ++i) {
+        if (m_images[i].surface)
+            order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this] (size_t a, size_t b) {
+            return m_images[a].surface->h > m_images[b].surface->h;
+            });
+
+    bool has_open_page = false;
+    size_t open_page = 0;
+    int cursor_x = 0, shelf_y = 0, shelf_h = 0;
+    for (size_t index : order) {
+        AtlasImage& image = m_images[index];
+        const int w = image.surface->w;
+        const int h = image.surface->h;
+
+        // too big to share a page
+        if (w + 2*m_padding > m_page_size || h + 2*m_padding > m_page_size) {
+            image.page = out__page_sizes->size();
+            image.rect = { 0, 0, w, h };
+            out__page_sizes->push_back({ w, h });
+            continue;
+        }
+
+        if (has_open_page && cursor_x + w + m_padding > m_page_size) {
+            // next shelf
+            shelf_y += shelf_h;
+            cursor_x = m_padding;
+            shelf_h = 0;
+        }
+        if ( !has_open_page || shelf_y + h + m_padding > m_page_size ) {
+            open_page = out__page_sizes->size();
+            out__page_sizes->push_back({ 0, 0 });
+            has_open_page = true;
+            cursor_x = m_padding;
+            shelf_y = m_padding;
+            shelf_h = 0;
+        }
+
+        image.page = open_page;
+        image.rect = { cursor_x, shelf_y, w, h };
+        cursor_x += w + m_padding;
+        shelf_h = std::max(shelf_h, h + m_padding);
+
+        // pages are only as big as what they hold
+        SDL_Point& page_size = (*out__page_sizes)[open_page];
+        page_size.x = std::max(page_size.x, cursor_x);
+        page_size.y = std::max(page_size.y, shelf_y + h + m_padding);
+    }
+}
+
+
+Result<VoidResult, GameError> TextureAtlas::pack(SDL_Renderer* renderer) {
+    if (m_is_packed)
+        return ResultError("TextureAtlas is already packed");
+    m_is_packed = true;
+
+    std::vector<SDL_Point> page_sizes;
+    this->placeImages(&page_sizes);
+
+    for (size_t page=0; page<page_sizes.size(); ++page) {
+        // headless, only the page size matters
+        if (renderer == NULL) {
+            auto page_texture = std::make_shared<Res_SDL_Texture>((SDL_Surface*)NULL, renderer, m_scale_mode);
+            page_texture->w = page_sizes[page].x;
+            page_texture->h = page_sizes[page].y;
+            m_pages.push_back(page_texture);
+            continue;
+        }
+
+        SDL_Surface* page_surface = SDL_CreateSurface(
+                page_sizes[page].x, page_sizes[page].y,
+                SDL_PIXELFORMAT_RGBA32
+                );
+        if (page_surface == NULL) {
+            this->releaseSurfaces();
+            return ResultError(std::string("Failed to create a TextureAtlas page: ") + SDL_GetError());
+        }
+
+        for (auto& image : m_images) {
+            if ( !image.surface || image.page != page )
+                continue;
+
+            // copy the pixels as they are, alpha included
+            SDL_SetSurfaceBlendMode(image.surface, SDL_BLENDMODE_NONE);
+            if ( !SDL_BlitSurface(image.surface, NULL, page_surface, &image.rect) )
+                PIXBENCH_LOG_ERROR("Failed to pack {} into a TextureAtlas page: {}", image.source, SDL_GetError());
+        }
+
+        m_pages.push_back(std::make_shared<Res_SDL_Texture>(page_surface, renderer, m_scale_mode));
+        SDL_DestroySurface(page_surface);
+    }
+
+    PIXBENCH_LOG_DEBUG("TextureAtlas packed {} images into {} pages", m_images.size(), m_pages.size());
+    this->releaseSurfaces();
+
+    return ResultOK;
+}
+
+
+TextureRegion TextureAtlas::getRegion(TextureAtlasHandle handle) const {
+    if ( !m_is_packed || handle >= m_images.size() )
+        return TextureRegion();
+
+    const AtlasImage& image = m_images[handle];
+    if (image.page >= m_pages.size() || image.rect.w == 0 || image.rect.h == 0)
+        return TextureRegion();
+
+    return TextureRegion(
+            m_pages[image.page],
+            {
+                (float)image.rect.x, (float)image.rect.y,
+                (float)image.rect.w, (float)image.rect.h
+            }
+            );
+}
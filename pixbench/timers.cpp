@@ -0,0 +1,319 @@
+#include "pixbench/timers.h"
+#include "pixbench/engine_config.h"
+#include <algorithm>
+#include <cmath>
+
+
+#define TIMER_WHEEL_SLOT_MASK ((uint64_t)TIMER_WHEEL_SLOTS - 1)
+
+
+TimerWheel::TimerWheel() {
+    std::fill(m_slot_heads, m_slot_heads + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, -1);
+}
+
+
+uint64_t TimerWheel::__delayToTicks(double delay_s) const {
+    // the top level can only look TIMER_WHEEL_SLOTS - 1 of its slots ahead
+    const uint64_t max_ticks = ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))
+        - ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * (TIMER_WHEEL_LEVELS - 1)));
+
+    const double ticks = std::ceil(delay_s / TIMER_WHEEL_TICK_S - 1e-9);
+    if ( !(ticks >= 1.0) )
+        return 1; // also catches NaN
+    if (ticks >= (double)max_ticks)
+        return max_ticks;
+    return (uint64_t)ticks;
+}
+
+
+TimerID TimerWheel::__schedule(double delay_s, double interval_s, const EntityID* entity, TimerCallback callback) {
+    int32_t index = m_free_head;
+    if (index >= 0) {
+        m_free_head = m_timers[index].slot_next;
+    } else {
+        index = (int32_t)m_timers.size();
+        m_timers.push_back(Timer());
+    }
+
+    Timer& timer = m_timers[index];
+    timer.callback = callback;
+    timer.expire_tick = m_current_tick + this->__delayToTicks(delay_s);
+    timer.interval_ticks = interval_s > 0.0 ? this->__delayToTicks(interval_s) : 0;
+    timer.sequence = m_sequence++;
+    timer.state = TIMER_SCHEDULED;
+    timer.slot_prev = -1;
+    timer.slot_next = -1;
+    timer.entity_prev = -1;
+    timer.entity_next = -1;
+    timer.has_entity = entity != nullptr;
+
+    if (entity) {
+        if (m_entity_heads.empty())
+            m_entity_heads.assign(MAX_ENTITIES, -1);
+
+        timer.entity = *entity;
+        int32_t& head = m_entity_heads[entity->id];
+        timer.entity_next = head;
+        if (head >= 0)
+            m_timers[head].entity_prev = index;
+        head = index;
+    }
+
+    this->__insert(index);
+    ++m_scheduled_count;
+
+    TimerID timer_id;
+    timer_id.index = (uint32_t)index;
+    timer_id.generation = timer.generation;
+    return timer_id;
+}
+
+
+void TimerWheel::__insert(int32_t index) {
+    // Expiries are at least a tick ahead when scheduled, only a cascade can
+    // insert one expiring on the current tick, into the level 0 slot that
+    // __advance() collects right after cascading
+    Timer& timer = m_timers[index];
+
+    // Lowest level whose slot for the expiry is still ahead of the current
+    // one, the slot is then moved down when the wheel reaches it
+    int level = 0;
+    if (timer.expire_tick - m_current_tick >= TIMER_WHEEL_SLOTS) {
+        for (level=1; level<TIMER_WHEEL_LEVELS-1; ++level) {
+            const int shift = TIMER_WHEEL_SLOT_BITS * level;
+            if ((timer.expire_tick >> shift) - (m_current_tick >> shift) < TIMER_WHEEL_SLOTS)
+                break;
+        }
+    }
+    const uint64_t slot_index = (timer.expire_tick >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+
+    timer.slot = level * TIMER_WHEEL_SLOTS + (int32_t)slot_index;
+    timer.slot_prev = -1;
+    timer.slot_next = m_slot_heads[timer.slot];
+    if (timer.slot_next >= 0)
+        m_timers[timer.slot_next].slot_prev = index;
+    m_slot_heads[timer.slot] = index;
+    ++m_wheel_count;
+}
+
+
+void TimerWheel::__unlinkSlot(int32_t index) {
+    Timer& timer = m_timers[index];
+    if (timer.slot_prev >= 0)
+        m_timers[timer.slot_prev].slot_next = timer.slot_next;
+    else
+        m_slot_heads[timer.slot] = timer.slot_next;
+    if (timer.slot_next >= 0)
+        m_timers[timer.slot_next].slot_prev = timer.slot_prev;
+
+    timer.slot = -1;
+    timer.slot_prev = -1;
+    timer.slot_next = -1;
+    --m_wheel_count;
+}
+
+
+void TimerWheel::__unlinkEntity(int32_t index) {
+    Timer& timer = m_timers[index];
+    if ( !timer.has_entity )
+        return;
+
+    if (timer.entity_prev >= 0)
+        m_timers[timer.entity_prev].entity_next = timer.entity_next;
+    else
+        m_entity_heads[timer.entity.id] = timer.entity_next;
+    if (timer.entity_next >= 0)
+        m_timers[timer.entity_next].entity_prev = timer.entity_prev;
+
+    timer.entity_prev = -1;
+    timer.entity_next = -1;
+    timer.has_entity = false;
+}
+
+
+void TimerWheel::__free(int32_t index) {
+    this->__unlinkEntity(index);
+
+    Timer& timer = m_timers[index];
+    timer.callback = nullptr;
+    timer.state = TIMER_FREE;
+    if (++timer.generation == 0)
+        timer.generation = 1;
+    timer.slot_next = m_free_head;
+    m_free_head = index;
+    --m_scheduled_count;
+}
+
+
+void TimerWheel::__cascade(int level) {
+    const uint64_t slot_index = (m_current_tick >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+    const int32_t slot = level * TIMER_WHEEL_SLOTS + (int32_t)slot_index;
+
+    int32_t index = m_slot_heads[slot];
+    m_slot_heads[slot] = -1;
+    while (index >= 0) {
+        const int32_t next = m_timers[index].slot_next;
+        --m_wheel_count;
+        this->__insert(index);
+        index = next;
+    }
+}
+
+
+bool TimerWheel::__isLive(TimerID timer) const {
+    return timer.index < m_timers.size()
+        && m_timers[timer.index].generation == timer.generation
+        && m_timers[timer.index].state != TIMER_FREE;
+}
+
+
+TimerID TimerWheel::schedule(double delay_s, TimerCallback callback) {
+    return this->__schedule(delay_s, 0.0, nullptr, callback);
+}
+
+
+TimerID TimerWheel::scheduleRepeating(double delay_s, double interval_s, TimerCallback callback) {
+    return this->__schedule(delay_s, interval_s, nullptr, callback);
+}
+
+
+TimerID TimerWheel::scheduleForEntity(EntityID entity, double delay_s, TimerCallback callback) {
+    return this->__schedule(delay_s, 0.0, &entity, callback);
+}
+
+
+TimerID TimerWheel::scheduleRepeatingForEntity(EntityID entity, double delay_s, double interval_s, TimerCallback callback) {
+    return this->__schedule(delay_s, interval_s, &entity, callback);
+}
+
+
+bool TimerWheel::cancel(TimerID timer) {
+    if ( !this->__isLive(timer) )
+        return false;
+
+    // expired timers are skipped by __advance() once freed
+    if (m_timers[timer.index].state == TIMER_SCHEDULED)
+        this->__unlinkSlot((int32_t)timer.index);
+    this->__free((int32_t)timer.index);
+    return true;
+}
+
+
+bool TimerWheel::isScheduled(TimerID timer) const {
+    return this->__isLive(timer);
+}
+
+
+void TimerWheel::__cancelEntityTimers(EntityID entity) {
+    if (entity.id >= m_entity_heads.size())
+        return;
+
+    int32_t index = m_entity_heads[entity.id];
+    while (index >= 0) {
+        const int32_t next = m_timers[index].entity_next;
+        if (m_timers[index].entity == entity) {
+            TimerID timer;
+            timer.index = (uint32_t)index;
+            timer.generation = m_timers[index].generation;
+            this->cancel(timer);
+        }
+        index = next;
+    }
+}
+
+
+Result<VoidResult, GameError> TimerWheel::__advance(double delta_time_s) {
+    m_tick_remainder_s += delta_time_s;
+    uint64_t ticks = 0;
+    if (m_tick_remainder_s >= TIMER_WHEEL_TICK_S) {
+        ticks = (uint64_t)(m_tick_remainder_s / TIMER_WHEEL_TICK_S);
+        m_tick_remainder_s -= (double)ticks * TIMER_WHEEL_TICK_S;
+    }
+
+    // Collect the expired timers
+    const size_t first_expired = m_expired.size();
+    while (ticks > 0) {
+        if (m_wheel_count == 0) {
+            m_current_tick += ticks;
+            break;
+        }
+
+        ++m_current_tick;
+        --ticks;
+
+        for (int level=1; level<TIMER_WHEEL_LEVELS; ++level) {
+            const uint64_t lower_ticks_mask = ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * level)) - 1;
+            if ((m_current_tick & lower_ticks_mask) != 0)
+                break;
+            this->__cascade(level);
+        }
+
+        const int32_t slot = (int32_t)(m_current_tick & TIMER_WHEEL_SLOT_MASK);
+        int32_t index = m_slot_heads[slot];
+        m_slot_heads[slot] = -1;
+        while (index >= 0) {
+            Timer& timer = m_timers[index];
+            const int32_t next = timer.slot_next;
+            timer.state = TIMER_EXPIRED;
+            timer.slot = -1;
+            timer.slot_prev = -1;
+            timer.slot_next = -1;
+            --m_wheel_count;
+
+            TimerID timer_id;
+            timer_id.index = (uint32_t)index;
+            timer_id.generation = timer.generation;
+            m_expired.push_back(timer_id);
+            index = next;
+        }
+    }
+
+    const std::vector<Timer>& timers = m_timers;
+    std::sort(
+            m_expired.begin() + first_expired, m_expired.end(),
+            [&timers] (const TimerID& a, const TimerID& b) {
+                const Timer& timer_a = timers[a.index];
+                const Timer& timer_b = timers[b.index];
+                if (timer_a.expire_tick != timer_b.expire_tick)
+                    return timer_a.expire_tick < timer_b.expire_tick;
+                return timer_a.sequence < timer_b.sequence;
+            });
+
+    // Fire them, callbacks may schedule or cancel timers (m_timers can grow)
+    while (m_fire_cursor < m_expired.size()) {
+        const TimerID timer_id = m_expired[m_fire_cursor++];
+        if ( !this->__isLive(timer_id) )
+            continue; // cancelled by a previous callback
+
+        const int32_t index = (int32_t)timer_id.index;
+        TimerCallback callback = std::move(m_timers[index].callback);
+        Result<VoidResult, GameError> res = callback();
+
+        if (this->__isLive(timer_id)) {
+            Timer& timer = m_timers[index];
+            if (timer.interval_ticks > 0) {
+                // skip the intervals missed during a long frame
+                timer.expire_tick += timer.interval_ticks;
+                if (timer.expire_tick <= m_current_tick) {
+                    const uint64_t missed = (m_current_tick - timer.expire_tick) / timer.interval_ticks + 1;
+                    timer.expire_tick += missed * timer.interval_ticks;
+                }
+                timer.callback = std::move(callback);
+                timer.state = TIMER_SCHEDULED;
+                this->__insert(index);
+            } else {
+                this->__free(index);
+            }
+        }
+
+        if ( !res.isOk() ) {
+            m_expired.erase(m_expired.begin(), m_expired.begin() + m_fire_cursor);
+            m_fire_cursor = 0;
+            return res;
+        }
+    }
+    m_expired.clear();
+    m_fire_cursor = 0;
+
+    return ResultOK;
+}
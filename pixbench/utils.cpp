@@ -6,8 +6,19 @@
 std::random_device g_random_device;
 std::mt19937 g_random_gen;
 std::uniform_int_distribution<uint32_t> g_random_dis;
+uint32_t g_random_seed = std::mt19937::default_seed;
 void PrepareRandomGenerator() {
-    g_random_gen = std::mt19937(g_random_device());
+    PrepareRandomGenerator(g_random_device());
+}
+
+void PrepareRandomGenerator(uint32_t seed) {
+    g_random_seed = seed;
+    g_random_gen = std::mt19937(seed);
+    g_random_dis.reset();
+}
+
+uint32_t GetRandomGeneratorSeed() {
+    return g_random_seed;
 }
 
 uint32_t GenerateRandomUInt32() {
@@ -0,0 +1,66 @@
+#include "pixbench/timers.h"
+#include "pixbench/engine_config.h"
+#include <vector>
+
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+
+/**
+ * Advance `timers` one tick at a time until `out__tick` reaches `last_tick`,
+ * callbacks read `out__tick` to know when they fired.
+ */
+static void advanceTicks(TimerWheel& timers, uint64_t* out__tick, uint64_t last_tick) {
+    while (*out__tick < last_tick) {
+        ++(*out__tick);
+        REQUIRE(timers.__advance(TIMER_WHEEL_TICK_S).isOk());
+    }
+}
+
+
+TEST_CASE("timer wheel fires on level boundaries", "[timers]") {
+    TimerWheel timers;
+    uint64_t tick = 0;
+
+    // delays landing exactly on the slots cascaded down from levels 1 to 2
+    const double delays_s[] = { 0.255, 0.256, 0.3, 0.512, 65.536 };
+    const uint64_t expected_ticks[] = { 255, 256, 300, 512, 65536 };
+    const size_t timer_count = sizeof(delays_s) / sizeof(delays_s[0]);
+
+    std::vector<uint64_t> fired_ticks(timer_count, 0);
+    for (size_t i=0; i<timer_count; ++i) {
+        uint64_t* fired_tick = &fired_ticks[i];
+        timers.schedule(delays_s[i], [fired_tick, &tick] () {
+            *fired_tick = tick;
+            return ResultOK;
+        });
+    }
+
+    // scheduled later, still expiring when its level 1 slot cascades
+    uint64_t late_fired_tick = 0;
+    advanceTicks(timers, &tick, 10);
+    timers.schedule(0.502, [&late_fired_tick, &tick] () {
+        late_fired_tick = tick;
+        return ResultOK;
+    });
+
+    // repeating on a level boundary, fires every cascade of level 1
+    std::vector<uint64_t> repeat_ticks;
+    TimerID repeating = timers.scheduleRepeating(0.246, 0.256, [&repeat_ticks, &tick] () {
+        repeat_ticks.push_back(tick);
+        return ResultOK;
+    });
+
+    advanceTicks(timers, &tick, 70000);
+
+    for (size_t i=0; i<timer_count; ++i)
+        REQUIRE(fired_ticks[i] == expected_ticks[i]);
+    REQUIRE(late_fired_tick == 512);
+
+    REQUIRE(repeat_ticks.size() >= 3);
+    for (size_t i=0; i<repeat_ticks.size(); ++i)
+        REQUIRE(repeat_ticks[i] == 256 * (i + 1));
+
+    REQUIRE(timers.cancel(repeating));
+    REQUIRE(timers.size() == 0);
+}
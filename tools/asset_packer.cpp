@@ -0,0 +1,76 @@
+/*
+ * Pixel Bench asset packer
+ *
+ * Packs the files under a directory into a single asset pack (see
+ * pixbench/asset_pack.h), to be mounted with GameConfig::asset_pack_path.
+ * Entries are named by their path relative to ROOT_DIR, so packing the
+ * executable directory keeps the "assets/player.bmp" style paths games
+ * already use.
+ *
+ * usage:
+ *   asset_packer ROOT_DIR OUT_FILE [PATTERN...]
+ *
+ * PATTERN is an SDL_GlobDirectory() pattern relative to ROOT_DIR, e.g.
+ * "assets/sprite_*.bmp", every file is packed when none is given.
+ */
+#include "pixbench/asset_pack.h"
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_stdinc.h>
+#include <iostream>
+#include <string>
+
+
+/*
+ * Add the files matching `pattern` (every file for null) under `root_dir`.
+ */
+static bool addFiles(AssetPackWriter* writer, const std::string& root_dir, const char* pattern) {
+    int count = 0;
+    char** names = SDL_GlobDirectory(root_dir.c_str(), pattern, 0, &count);
+    if ( !names ) {
+        std::cerr << "Can't list " << root_dir << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    for (int i=0; i<count; ++i) {
+        const std::string file_path = root_dir + "/" + names[i];
+        SDL_PathInfo info;
+        if ( !SDL_GetPathInfo(file_path.c_str(), &info) || info.type != SDL_PATHTYPE_FILE )
+            continue;
+        writer->addFile(names[i], file_path);
+    }
+
+    SDL_free(names);
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: asset_packer ROOT_DIR OUT_FILE [PATTERN...]" << std::endl;
+        return 2;
+    }
+
+    const std::string root_dir = argv[1];
+    const std::string out_path = argv[2];
+
+    AssetPackWriter writer;
+    if (argc == 3) {
+        if ( !addFiles(&writer, root_dir, NULL) )
+            return 1;
+    }
+    for (int i=3; i<argc; ++i) {
+        if ( !addFiles(&writer, root_dir, argv[i]) )
+            return 1;
+    }
+
+    Result<VoidResult, GameError> res = writer.write(out_path);
+    if ( !res.isOk() ) {
+        std::cerr << res.getErrResult()->err_message << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << writer.getEntryCount() << " files into " << out_path << std::endl;
+    return 0;
+}
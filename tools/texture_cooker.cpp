@@ -0,0 +1,126 @@
+/*
+ * Pixel Bench texture cooker
+ *
+ * Converts a BMP image to a cooked texture (see pixbench/cooked_texture.h),
+ * with its pixels in the renderer's layout and, optionally, the frames of a
+ * sprite sheet grid laid out like SpriteSheet does.
+ *
+ * usage:
+ *   texture_cooker IN_FILE OUT_FILE [--raw] [--format argb8888|abgr8888]
+ *                  [--frames W H [PAD_X PAD_Y [START_X START_Y]]]
+ */
+#include "pixbench/cooked_texture.h"
+#include "pixbench/renderer.h"
+#include "pixbench/resource.h"
+#include "pixbench/utils/results.h"
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_surface.h>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class CookParams {
+public:
+    std::string in_path;
+    std::string out_path;
+    CookedTextureCompression compression = CookedTextureCompression::LZ4;
+    SDL_PixelFormat pixel_format = SDL_PIXELFORMAT_ARGB8888;
+    bool has_frames = false;
+    float frame_w = 0.0f, frame_h = 0.0f;
+    float pad_x = 0.0f, pad_y = 0.0f;
+    float start_x = 0.0f, start_y = 0.0f;
+};
+
+
+bool parseArgs(int argc, char* argv[], CookParams* params) {
+    if (argc < 3)
+        return false;
+    params->in_path = argv[1];
+    params->out_path = argv[2];
+
+    for (int i = 3; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--raw") {
+            params->compression = CookedTextureCompression::NONE;
+        } else if (arg == "--format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (format == "argb8888")       params->pixel_format = SDL_PIXELFORMAT_ARGB8888;
+            else if (format == "abgr8888")  params->pixel_format = SDL_PIXELFORMAT_ABGR8888;
+            else {
+                std::cerr << "Unknown pixel format " << format << std::endl;
+                return false;
+            }
+        } else if (arg == "--frames" && i + 2 < argc) {
+            // optional values follow in pairs
+            std::vector<float> values;
+            while (i + 1 < argc && values.size() < 6 && argv[i + 1][0] != '-')
+                values.push_back((float)std::atof(argv[++i]));
+            if (values.size() < 2 || values.size() % 2 != 0) {
+                std::cerr << "--frames takes W H [PAD_X PAD_Y [START_X START_Y]]" << std::endl;
+                return false;
+            }
+            params->has_frames = true;
+            params->frame_w = values[0];
+            params->frame_h = values[1];
+            if (values.size() >= 4) {
+                params->pad_x = values[2];
+                params->pad_y = values[3];
+            }
+            if (values.size() >= 6) {
+                params->start_x = values[4];
+                params->start_y = values[5];
+            }
+        } else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    CookParams params;
+    if ( !parseArgs(argc, argv, &params) ) {
+        std::cerr << "usage: texture_cooker IN_FILE OUT_FILE [--raw] [--format argb8888|abgr8888]"
+            << " [--frames W H [PAD_X PAD_Y [START_X START_Y]]]" << std::endl;
+        return 2;
+    }
+
+    SDL_Surface* surface = SDL_LoadBMP(params.in_path.c_str());
+    if (surface == NULL) {
+        std::cerr << "Can't load " << params.in_path << ": " << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    std::vector<SDL_FRect> frames;
+    if (params.has_frames) {
+        // the same grid SpriteSheet would compute at runtime, on a texture
+        // holding the size only
+        SpriteSheet sheet(
+                std::make_shared<Res_SDL_Texture>(surface, (SDL_Renderer*)NULL),
+                params.start_x, params.start_y,
+                params.frame_w, params.frame_h,
+                params.pad_x, params.pad_y
+                );
+        for (int frame = 0; frame < sheet.sheet_count; ++frame)
+            frames.push_back(sheet.GetRectByFrameIndex(frame));
+    }
+
+    Result<VoidResult, GameError> res = CookTexture(
+            surface, frames, params.out_path,
+            params.compression, params.pixel_format
+            );
+    SDL_DestroySurface(surface);
+    if ( !res.isOk() ) {
+        std::cerr << res.getErrResult()->err_message << std::endl;
+        return 1;
+    }
+
+    std::cout << "Cooked " << params.in_path << " into " << params.out_path
+        << " with " << frames.size() << " frames" << std::endl;
+    return 0;
+}
@@ -86,7 +86,14 @@ void InitializeGame(Game* game) {
             return ResultOK;
         }
 
-        // OnEvent called everytime SDL report an event
+        // Only the event types subscribed here are passed to OnEvent,
+        // without it the script receives every SDL event
+        void SubscribeEvents(EventSubscription *subscription) override {
+            subscription->subscribe(SDL_EVENT_QUIT);
+            subscription->subscribe(SDL_EVENT_KEY_DOWN);
+        }
+
+        // OnEvent called everytime SDL report a subscribed event
         Void OnEvent(SDL_Event *event, EntityManager *entityManager, EntityID self) override {
             // Handle quit
             if (event->type == SDL_EVENT_QUIT) {